@@ -61,8 +61,11 @@ PROCESS_THREAD(at_process, ev, data)
   uint8_t plen;
   char *pch, *buf;
   struct at_cmd *a;
+  static struct process_subscriber line;
   PROCESS_BEGIN();
 
+  process_subscribe(&line, PROCESS_CURRENT(), serial_line_event_message);
+
   while(1) {
     PROCESS_WAIT_EVENT_UNTIL(ev == serial_line_event_message && data != NULL);
     buf = (char *)data;
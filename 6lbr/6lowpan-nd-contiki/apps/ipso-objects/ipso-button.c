@@ -117,11 +117,13 @@ ipso_button_init(void)
 PROCESS_THREAD(ipso_button_process, ev, data)
 {
   static struct etimer timer;
+  static struct process_subscriber button;
   int32_t time;
 
   PROCESS_BEGIN();
 
   SENSORS_ACTIVATE(button_sensor);
+  process_subscribe(&button, PROCESS_CURRENT(), sensors_event);
 
   while(1) {
     PROCESS_WAIT_EVENT();
@@ -0,0 +1,449 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+
+/**
+ * \file
+ *         Record journal on top of CFS
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "lib/crc16.h"
+#include "journal.h"
+#if JOURNAL_WITH_COFFEE
+#include "cfs/cfs-coffee.h"
+#endif /* JOURNAL_WITH_COFFEE */
+
+#include <string.h>
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+/* Last byte of every record, written with it: a record that does not
+   end with it was torn. It also keeps the last byte of a segment from
+   being zero, which Coffee would not count into the file size. */
+#define JOURNAL_COMMIT 0xa5
+
+#define NO_SEGMENT 2
+
+/* What a pass over a segment found */
+struct scan {
+  uint32_t first;      /* Sequence number of the first record */
+  uint32_t next;       /* Sequence number after the last record */
+  cfs_offset_t end;    /* Offset after the last record */
+  uint16_t records;
+  uint8_t checkpoint;  /* The segment has a checkpoint record */
+  uint8_t torn;        /* Bytes follow the last record */
+};
+
+static char segment_file[JOURNAL_NAME_LENGTH + 3];
+/*---------------------------------------------------------------------------*/
+static const char *
+segment_name(struct journal *j, uint8_t segment)
+{
+  uint8_t len;
+
+  len = strlen(j->name);
+  memcpy(segment_file, j->name, len);
+  segment_file[len] = '.';
+  segment_file[len + 1] = '0' + segment;
+  segment_file[len + 2] = '\0';
+  return segment_file;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+record_crc(const uint8_t *r, const void *data, uint8_t len)
+{
+  return crc16_data(data, len, crc16_data(r, 6, 0));
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Walk the records of a segment through the buffer of the journal,
+ * which must not hold unwritten records. With probe set, stop at the
+ * checkpoint record, otherwise pass every record to replay.
+ */
+static void
+scan(struct journal *j, int fd, struct scan *s,
+     journal_replay_callback_t replay, uint8_t probe)
+{
+  uint16_t have, off, avail, size;
+  cfs_offset_t base;
+  uint32_t seqno;
+  uint8_t *r;
+  int n;
+
+  memset(s, 0, sizeof(*s));
+  base = 0;
+  have = off = 0;
+
+  while(1) {
+    avail = have - off;
+    size = avail >= 2 ? JOURNAL_HEADER_SIZE + j->buf[off + 1] + 1 : 0;
+    if(avail < JOURNAL_HEADER_SIZE || avail < size) {
+      /* Read on behind the part of a record that is left */
+      memmove(j->buf, j->buf + off, avail);
+      base += off;
+      have = avail;
+      off = 0;
+      n = cfs_read(fd, j->buf + have, JOURNAL_BUFFER_SIZE - have);
+      if(n > 0) {
+        have += n;
+      }
+      avail = have;
+      size = avail >= 2 ? JOURNAL_HEADER_SIZE + j->buf[1] + 1 : 0;
+    }
+
+    r = j->buf + off;
+    if(avail == 0 || r[0] == 0) {
+      /* Nothing was ever written here */
+      break;
+    }
+    if(avail < JOURNAL_HEADER_SIZE || size > JOURNAL_BUFFER_SIZE ||
+       avail < size || r[size - 1] != JOURNAL_COMMIT ||
+       record_crc(r, r + JOURNAL_HEADER_SIZE, r[1]) !=
+       (r[6] | ((uint16_t)r[7] << 8))) {
+      s->torn = 1;
+      break;
+    }
+
+    seqno = r[2] | ((uint32_t)r[3] << 8) |
+      ((uint32_t)r[4] << 16) | ((uint32_t)r[5] << 24);
+    if(s->records > 0 && seqno != s->next) {
+      s->torn = 1;
+      break;
+    }
+    if(s->records == 0) {
+      s->first = seqno;
+    }
+    s->records++;
+    s->next = seqno + 1;
+    off += size;
+    s->end = base + off;
+
+    if(r[0] == JOURNAL_TYPE_CHECKPOINT) {
+      s->checkpoint = 1;
+      if(probe) {
+        break;
+      }
+    } else if(replay != NULL && !probe) {
+      replay(r[0], seqno, r + JOURNAL_HEADER_SIZE, r[1], j->ptr);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+start_segment(struct journal *j, uint8_t segment)
+{
+  const char *file;
+
+  file = segment_name(j, segment);
+  cfs_remove(file);
+#if JOURNAL_WITH_COFFEE
+  if(cfs_coffee_reserve(file, JOURNAL_SEGMENT_SIZE) < 0) {
+    j->fd = -1;
+    return -1;
+  }
+#endif /* JOURNAL_WITH_COFFEE */
+
+  j->fd = cfs_open(file, CFS_READ | CFS_WRITE | CFS_APPEND);
+  if(j->fd < 0) {
+    return -1;
+  }
+#if JOURNAL_WITH_COFFEE
+  /* Only fresh bytes are written, at most a segment of them */
+  cfs_coffee_set_io_semantics(j->fd, CFS_COFFEE_IO_FLASH_AWARE |
+                              CFS_COFFEE_IO_FIRM_SIZE);
+#endif /* JOURNAL_WITH_COFFEE */
+
+  j->segment = segment;
+  j->end = 0;
+  j->buffered = 0;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+append(struct journal *j, uint8_t type, const void *data, uint8_t len)
+{
+  uint16_t size, crc;
+  cfs_offset_t limit;
+  uint8_t *r;
+
+  size = JOURNAL_HEADER_SIZE + len + 1;
+  if(size > JOURNAL_BUFFER_SIZE) {
+    return -1;
+  }
+
+  /* A snapshot must leave room for its checkpoint record */
+  limit = JOURNAL_SEGMENT_SIZE;
+  if(j->compacting && type != JOURNAL_TYPE_CHECKPOINT) {
+    limit -= JOURNAL_HEADER_SIZE + 1;
+  }
+  if(j->end + j->buffered + size > limit) {
+    if(j->compacting || journal_checkpoint(j) < 0 ||
+       j->end + j->buffered + size > limit) {
+      return -1;
+    }
+  }
+
+  if(j->buffered + size > JOURNAL_BUFFER_SIZE && journal_flush(j) < 0) {
+    return -1;
+  }
+
+  r = j->buf + j->buffered;
+  r[0] = type;
+  r[1] = len;
+  r[2] = j->seqno;
+  r[3] = j->seqno >> 8;
+  r[4] = j->seqno >> 16;
+  r[5] = j->seqno >> 24;
+  crc = record_crc(r, data, len);
+  r[6] = crc;
+  r[7] = crc >> 8;
+  memcpy(r + JOURNAL_HEADER_SIZE, data, len);
+  r[size - 1] = JOURNAL_COMMIT;
+
+  j->buffered += size;
+  j->seqno++;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+write_checkpoint(struct journal *j)
+{
+  int ret;
+
+  j->compacting = 1;
+  ret = append(j, JOURNAL_TYPE_CHECKPOINT, NULL, 0);
+  j->compacting = 0;
+  return ret < 0 ? -1 : journal_flush(j);
+}
+/*---------------------------------------------------------------------------*/
+static void
+flush_timeout(void *ptr)
+{
+  journal_flush(ptr);
+}
+/*---------------------------------------------------------------------------*/
+int
+journal_open(struct journal *j, const char *name,
+             journal_replay_callback_t replay,
+             journal_snapshot_callback_t snapshot, void *ptr)
+{
+  struct scan s[2];
+  uint8_t i, segment;
+  int fd;
+
+  memset(j, 0, sizeof(*j));
+  strncpy(j->name, name, JOURNAL_NAME_LENGTH);
+  j->snapshot = snapshot;
+  j->ptr = ptr;
+  j->fd = -1;
+
+  for(i = 0; i < 2; i++) {
+    memset(&s[i], 0, sizeof(s[i]));
+    fd = cfs_open(segment_name(j, i), CFS_READ);
+    if(fd >= 0) {
+      scan(j, fd, &s[i], NULL, 1);
+      cfs_close(fd);
+    }
+  }
+
+  /* The newest segment that has a checkpoint, the other one is either
+     older or an interrupted compaction */
+  if(s[0].checkpoint && s[1].checkpoint) {
+    segment = (int32_t)(s[1].first - s[0].first) > 0;
+  } else if(s[0].checkpoint) {
+    segment = 0;
+  } else if(s[1].checkpoint) {
+    segment = 1;
+  } else {
+    segment = NO_SEGMENT;
+  }
+  for(i = 0; i < 2; i++) {
+    if(i != segment) {
+      cfs_remove(segment_name(j, i));
+    }
+  }
+
+  if(segment == NO_SEGMENT) {
+    PRINTF("Journal: starting %s\n", j->name);
+    if(start_segment(j, 0) < 0) {
+      return -1;
+    }
+    return write_checkpoint(j);
+  }
+
+  fd = cfs_open(segment_name(j, segment), CFS_READ);
+  if(fd < 0) {
+    return -1;
+  }
+  scan(j, fd, &s[segment], replay, 0);
+  cfs_close(fd);
+  PRINTF("Journal: replayed %u records of %s, next %lu%s\n",
+         s[segment].records, segment_name(j, segment),
+         (unsigned long)s[segment].next, s[segment].torn ? ", torn" : "");
+
+  j->segment = segment;
+  j->seqno = s[segment].next;
+  j->end = s[segment].end;
+  j->fd = cfs_open(segment_name(j, segment),
+                   CFS_READ | CFS_WRITE | CFS_APPEND);
+  if(j->fd < 0) {
+    return -1;
+  }
+#if JOURNAL_WITH_COFFEE
+  cfs_coffee_set_io_semantics(j->fd, CFS_COFFEE_IO_FLASH_AWARE |
+                              CFS_COFFEE_IO_FIRM_SIZE);
+#endif /* JOURNAL_WITH_COFFEE */
+
+  if(s[segment].torn) {
+    /* Appending behind a torn record would hide everything after it
+       from the next replay */
+    return journal_checkpoint(j);
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+journal_append(struct journal *j, uint8_t type,
+               const void *data, uint8_t len)
+{
+  if(type == 0 || type == JOURNAL_TYPE_CHECKPOINT || j->fd < 0) {
+    return -1;
+  }
+
+  if(append(j, type, data, len) < 0) {
+    return -1;
+  }
+
+  if(j->compacting) {
+    /* journal_checkpoint() writes the snapshot at once */
+    return 0;
+  }
+  if(JOURNAL_FLUSH_DELAY == 0) {
+    return journal_flush(j);
+  }
+  if(ctimer_expired(&j->flush_timer)) {
+    ctimer_set(&j->flush_timer, JOURNAL_FLUSH_DELAY, flush_timeout, j);
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+journal_flush(struct journal *j)
+{
+  uint16_t size;
+  int n;
+
+  if(!ctimer_expired(&j->flush_timer)) {
+    ctimer_stop(&j->flush_timer);
+  }
+  if(j->buffered == 0) {
+    return 0;
+  }
+
+  size = j->buffered;
+  j->buffered = 0;
+  n = -1;
+  if(cfs_seek(j->fd, j->end, CFS_SEEK_SET) == j->end) {
+    n = cfs_write(j->fd, j->buf, size);
+  }
+  if(n != size) {
+    /* Whatever made it is torn: have the next append compact the
+       journal into the other segment */
+    j->end = JOURNAL_SEGMENT_SIZE;
+    return -1;
+  }
+  j->end += n;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+journal_checkpoint(struct journal *j)
+{
+  int old_fd;
+  uint8_t old_segment;
+  cfs_offset_t old_end;
+  uint32_t old_seqno;
+
+  if(j->snapshot == NULL || j->compacting || j->fd < 0) {
+    return -1;
+  }
+
+  /* In case the compaction fails */
+  journal_flush(j);
+
+  old_fd = j->fd;
+  old_segment = j->segment;
+  old_end = j->end;
+  old_seqno = j->seqno;
+
+  if(start_segment(j, !old_segment) == 0) {
+    j->compacting = 1;
+    if(j->snapshot(j, j->ptr) == 0 && write_checkpoint(j) == 0) {
+      cfs_close(old_fd);
+      cfs_remove(segment_name(j, old_segment));
+      PRINTF("Journal: compacted %s into %lu bytes\n",
+             j->name, (unsigned long)j->end);
+      return 0;
+    }
+    j->compacting = 0;
+    cfs_close(j->fd);
+    cfs_remove(segment_name(j, j->segment));
+  }
+
+  j->fd = old_fd;
+  j->segment = old_segment;
+  j->end = old_end;
+  /* The next record must follow on the last one of the old segment,
+     or the replay takes it for torn */
+  j->seqno = old_seqno;
+  j->buffered = 0;
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+void
+journal_close(struct journal *j)
+{
+  if(j->fd >= 0) {
+    journal_flush(j);
+    cfs_close(j->fd);
+    j->fd = -1;
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+
+/**
+ * \file
+ *         Record journal on top of CFS
+ *
+ *         A journal is a sequence of small records, each with a type, a
+ *         sequence number and a CRC, that are only ever appended. They
+ *         are collected in a RAM buffer and written in one cfs_write()
+ *         when the buffer is full, JOURNAL_FLUSH_DELAY after the first
+ *         buffered record, or at journal_flush(). A record that was not
+ *         flushed is lost on a reset.
+ *
+ *         The records go to one of two segment files, <name>.0 and
+ *         <name>.1, which are reserved with cfs_coffee_reserve() so that
+ *         appends never merge a Coffee micro log. When the segment is
+ *         full, journal_checkpoint() compacts it: the snapshot callback
+ *         appends the current state to the other segment, which then
+ *         gets a checkpoint record, and the old segment is removed. A
+ *         segment without a checkpoint record is an interrupted
+ *         compaction and is ignored.
+ *
+ *         journal_open() replays the records of the last complete
+ *         segment in order, up to the first one that is torn or fails
+ *         its CRC. As the records written since the last checkpoint are
+ *         replayed on top of the snapshot, they should set state ("node
+ *         X registered until T") rather than change it ("one more").
+ */
+
+#ifndef JOURNAL_H_
+#define JOURNAL_H_
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "sys/ctimer.h"
+
+/******** Configuration *******/
+
+/* Reserve the segments with cfs_coffee_reserve(). 0 on other file
+   systems. */
+#ifdef JOURNAL_CONF_WITH_COFFEE
+#define JOURNAL_WITH_COFFEE JOURNAL_CONF_WITH_COFFEE
+#else /* JOURNAL_CONF_WITH_COFFEE */
+#define JOURNAL_WITH_COFFEE 1
+#endif /* JOURNAL_CONF_WITH_COFFEE */
+
+/* Size of a segment in bytes */
+#ifdef JOURNAL_CONF_SEGMENT_SIZE
+#define JOURNAL_SEGMENT_SIZE JOURNAL_CONF_SEGMENT_SIZE
+#else /* JOURNAL_CONF_SEGMENT_SIZE */
+#define JOURNAL_SEGMENT_SIZE 4096
+#endif /* JOURNAL_CONF_SEGMENT_SIZE */
+
+/* Size of the write buffer of a journal. A record, with its 9 bytes of
+   framing, must fit into it. */
+#ifdef JOURNAL_CONF_BUFFER_SIZE
+#define JOURNAL_BUFFER_SIZE JOURNAL_CONF_BUFFER_SIZE
+#else /* JOURNAL_CONF_BUFFER_SIZE */
+#define JOURNAL_BUFFER_SIZE 128
+#endif /* JOURNAL_CONF_BUFFER_SIZE */
+
+/* How long a record may wait in the buffer. 0 writes every record as
+   it is appended. */
+#ifdef JOURNAL_CONF_FLUSH_DELAY
+#define JOURNAL_FLUSH_DELAY JOURNAL_CONF_FLUSH_DELAY
+#else /* JOURNAL_CONF_FLUSH_DELAY */
+#define JOURNAL_FLUSH_DELAY CLOCK_SECOND
+#endif /* JOURNAL_CONF_FLUSH_DELAY */
+
+/* Longest base name; the segments add ".0" and ".1" */
+#ifdef JOURNAL_CONF_NAME_LENGTH
+#define JOURNAL_NAME_LENGTH JOURNAL_CONF_NAME_LENGTH
+#else /* JOURNAL_CONF_NAME_LENGTH */
+#define JOURNAL_NAME_LENGTH 12
+#endif /* JOURNAL_CONF_NAME_LENGTH */
+
+/* Type, length, sequence number and CRC before the data, a commit byte
+   after it */
+#define JOURNAL_HEADER_SIZE 8
+#define JOURNAL_MAX_DATA    (JOURNAL_BUFFER_SIZE - JOURNAL_HEADER_SIZE - 1)
+
+/* Record types 1 to 254 are free for the application */
+#define JOURNAL_TYPE_CHECKPOINT 0xff
+
+struct journal;
+
+/* Called by journal_open() for each record, in the order they were
+   appended */
+typedef void (*journal_replay_callback_t)(uint8_t type, uint32_t seqno,
+                                          const void *data, uint8_t len,
+                                          void *ptr);
+/* Called by journal_checkpoint() to append the whole current state with
+   journal_append(). Returns -1 if that failed. */
+typedef int (*journal_snapshot_callback_t)(struct journal *j, void *ptr);
+
+struct journal {
+  struct ctimer flush_timer;
+  journal_snapshot_callback_t snapshot;
+  void *ptr;
+  /* Sequence number of the next record */
+  uint32_t seqno;
+  /* Bytes of the current segment on storage */
+  cfs_offset_t end;
+  int fd;
+  uint16_t buffered;
+  uint8_t segment;
+  uint8_t compacting;
+  char name[JOURNAL_NAME_LENGTH + 1];
+  uint8_t buf[JOURNAL_BUFFER_SIZE];
+};
+
+/**
+ * Open a journal and replay its records.
+ *
+ * \param j The journal.
+ * \param name Base name of the segment files.
+ * \param replay Called for every record found, may be NULL.
+ * \param snapshot Called to compact the journal, may be NULL if the
+ * journal never needs to survive a full segment.
+ * \param ptr Passed to both callbacks.
+ * \return 0, or -1 if no segment could be opened or created.
+ */
+int journal_open(struct journal *j, const char *name,
+                 journal_replay_callback_t replay,
+                 journal_snapshot_callback_t snapshot, void *ptr);
+
+/**
+ * Append a record. If the segment is full, the journal is compacted
+ * first.
+ *
+ * \param type 1 to 254.
+ * \param data The record, at most JOURNAL_MAX_DATA bytes.
+ * \return 0, or -1 if the record does not fit or could not be written.
+ */
+int journal_append(struct journal *j, uint8_t type,
+                   const void *data, uint8_t len);
+
+/* Write the buffered records now. Returns 0, or -1 on a write error. */
+int journal_flush(struct journal *j);
+
+/* Compact the journal into the other segment through the snapshot
+   callback. Returns 0, or -1 if the old segment was kept. */
+int journal_checkpoint(struct journal *j);
+
+/* Flush and close the journal */
+void journal_close(struct journal *j);
+
+#endif /* JOURNAL_H_ */
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2015, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+/**
+ * \file
+ *         Orchestra: a receiver-based slotframe dedicated to unicast
+ *         6LoWPAN-ND traffic (RS/RA/NS/NA), so that address registrations
+ *         do not compete with data and broadcast in the common slotframe.
+ *           Nodes listen at a timeslot defined as hash(MAC) % ORCHESTRA_ND_PERIOD
+ *           Nodes transmit at hash(nbr.MAC) % ORCHESTRA_ND_PERIOD, for their
+ *           time source (the router they register with) and for every
+ *           neighbor they recently sent unicast ND messages to (the 6LNs
+ *           registering with them). Unused transmit links are removed after
+ *           ORCHESTRA_ND_LINK_LIFETIME.
+ */
+
+#include "contiki.h"
+#include "orchestra.h"
+#include "net/packetbuf.h"
+#include "net/ipv6/uip-icmp6.h"
+#include "sys/ctimer.h"
+#include <string.h>
+
+static uint16_t slotframe_handle = 0;
+static uint16_t channel_offset = 0;
+static struct tsch_slotframe *sf_nd;
+static struct ctimer sweep_timer;
+/* Timeslots that transmitted ND traffic since the last sweep */
+static uint8_t used_timeslots[(ORCHESTRA_ND_PERIOD + 7) / 8];
+
+/*---------------------------------------------------------------------------*/
+static uint16_t
+get_node_timeslot(const linkaddr_t *addr)
+{
+  if(addr != NULL && ORCHESTRA_ND_PERIOD > 0) {
+    return ORCHESTRA_LINKADDR_HASH(addr) % ORCHESTRA_ND_PERIOD;
+  } else {
+    return 0xffff;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_nd_packet(void)
+{
+  uint8_t icmp_type;
+
+  if(packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE) != FRAME802154_DATAFRAME
+     || packetbuf_attr(PACKETBUF_ATTR_NETWORK_ID) != UIP_PROTO_ICMP6) {
+    return 0;
+  }
+  icmp_type = packetbuf_attr(PACKETBUF_ATTR_CHANNEL) >> 8;
+  return icmp_type == ICMP6_RS || icmp_type == ICMP6_RA
+      || icmp_type == ICMP6_NS || icmp_type == ICMP6_NA;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_nd_link(const linkaddr_t *linkaddr)
+{
+  uint16_t timeslot;
+  uint8_t link_options;
+  struct tsch_link *l;
+
+  if(linkaddr == NULL || linkaddr_cmp(linkaddr, &linkaddr_null)) {
+    return;
+  }
+
+  timeslot = get_node_timeslot(linkaddr);
+  l = tsch_schedule_get_link_by_timeslot(sf_nd, timeslot);
+  if(l != NULL && (l->link_options & LINK_OPTION_TX)) {
+    /* Link already in place */
+    return;
+  }
+
+  link_options = LINK_OPTION_TX | LINK_OPTION_SHARED;
+  if(timeslot == get_node_timeslot(&linkaddr_node_addr)) {
+    /* This is also our timeslot, keep listening */
+    link_options |= LINK_OPTION_RX;
+  }
+  tsch_schedule_add_link(sf_nd, link_options, LINK_TYPE_NORMAL, &tsch_broadcast_address,
+        timeslot, channel_offset);
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_nd_link(uint16_t timeslot)
+{
+  struct tsch_link *l;
+
+  l = tsch_schedule_get_link_by_timeslot(sf_nd, timeslot);
+  if(l == NULL || !(l->link_options & LINK_OPTION_TX)) {
+    return;
+  }
+  /* Does our time source need this timeslot? */
+  if(timeslot == get_node_timeslot(&orchestra_parent_linkaddr)) {
+    return;
+  }
+
+  if(timeslot == get_node_timeslot(&linkaddr_node_addr)) {
+    /* This is our link, keep it for reception only */
+    tsch_schedule_add_link(sf_nd, LINK_OPTION_RX, LINK_TYPE_NORMAL, &tsch_broadcast_address,
+          timeslot, channel_offset);
+  } else {
+    tsch_schedule_remove_link(sf_nd, l);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+sweep(void *ptr)
+{
+  uint16_t timeslot;
+
+  for(timeslot = 0; timeslot < ORCHESTRA_ND_PERIOD; timeslot++) {
+    if(!(used_timeslots[timeslot / 8] & (1 << (timeslot % 8)))) {
+      remove_nd_link(timeslot);
+    }
+  }
+  memset(used_timeslots, 0, sizeof(used_timeslots));
+  ctimer_reset(&sweep_timer);
+}
+/*---------------------------------------------------------------------------*/
+static int
+select_packet(uint16_t *slotframe, uint16_t *timeslot)
+{
+  /* Select unicast ND packets; multicast RS/RA/NS stay in the common slotframe */
+  const linkaddr_t *dest = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+  if(is_nd_packet() && !linkaddr_cmp(dest, &linkaddr_null)) {
+    uint16_t ts = get_node_timeslot(dest);
+    add_nd_link(dest);
+    used_timeslots[ts / 8] |= 1 << (ts % 8);
+    if(slotframe != NULL) {
+      *slotframe = slotframe_handle;
+    }
+    if(timeslot != NULL) {
+      *timeslot = ts;
+    }
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+new_time_source(const struct tsch_neighbor *old, const struct tsch_neighbor *new)
+{
+  if(new != old) {
+    const linkaddr_t *old_addr = old != NULL ? &old->addr : NULL;
+    const linkaddr_t *new_addr = new != NULL ? &new->addr : NULL;
+    if(new_addr != NULL) {
+      linkaddr_copy(&orchestra_parent_linkaddr, new_addr);
+    } else {
+      linkaddr_copy(&orchestra_parent_linkaddr, &linkaddr_null);
+    }
+    if(old_addr != NULL) {
+      remove_nd_link(get_node_timeslot(old_addr));
+    }
+    add_nd_link(new_addr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(uint16_t sf_handle)
+{
+  slotframe_handle = sf_handle;
+  channel_offset = sf_handle;
+  /* Slotframe for unicast ND transmissions */
+  sf_nd = tsch_schedule_add_slotframe(slotframe_handle, ORCHESTRA_ND_PERIOD);
+  /* Rx link, dedicated to us */
+  tsch_schedule_add_link(sf_nd, LINK_OPTION_RX, LINK_TYPE_NORMAL, &tsch_broadcast_address,
+        get_node_timeslot(&linkaddr_node_addr), channel_offset);
+  ctimer_set(&sweep_timer, ORCHESTRA_ND_LINK_LIFETIME, sweep, NULL);
+}
+/*---------------------------------------------------------------------------*/
+struct orchestra_rule unicast_per_neighbor_nd = {
+  init,
+  new_time_source,
+  select_packet,
+  NULL,
+  NULL,
+};
@@ -55,6 +55,7 @@ struct orchestra_rule {
 struct orchestra_rule eb_per_time_source;
 struct orchestra_rule unicast_per_neighbor_rpl_storing;
 struct orchestra_rule unicast_per_neighbor_rpl_ns;
+struct orchestra_rule unicast_per_neighbor_nd;
 struct orchestra_rule default_common;
 
 extern linkaddr_t orchestra_parent_linkaddr;
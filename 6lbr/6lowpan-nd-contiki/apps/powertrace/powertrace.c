@@ -46,6 +46,14 @@
 #include <stdio.h>
 #include <string.h>
 
+/* 1: print one "#E" line of hex per interval instead of the P and SP
+ * lines, see tools/powertrace/parse-power-binary */
+#ifdef POWERTRACE_CONF_BINARY
+#define POWERTRACE_BINARY POWERTRACE_CONF_BINARY
+#else /* POWERTRACE_CONF_BINARY */
+#define POWERTRACE_BINARY 0
+#endif /* POWERTRACE_CONF_BINARY */
+
 struct powertrace_sniff_stats {
   struct powertrace_sniff_stats *next;
   unsigned long num_input, num_output;
@@ -57,6 +65,9 @@ struct powertrace_sniff_stats {
   uint16_t channel;
   unsigned long last_input_txtime, last_input_rxtime;
   unsigned long last_output_txtime, last_output_rxtime;
+#if POWERTRACE_BINARY
+  unsigned long last_num_input, last_num_output;
+#endif /* POWERTRACE_BINARY */
 };
 
 #define INPUT  1
@@ -69,11 +80,76 @@ LIST(stats_list);
 
 PROCESS(powertrace_process, "Periodic power output");
 /*---------------------------------------------------------------------------*/
+#if POWERTRACE_BINARY
+static void
+put_hex(unsigned long value, uint8_t len)
+{
+  static const char hex[] = "0123456789abcdef";
+
+  /* Little-endian */
+  while(len--) {
+    putchar(hex[(value >> 4) & 0x0f]);
+    putchar(hex[value & 0x0f]);
+    value >>= 8;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Header of the "#E" line: clock_time (4), node (2), seqno (2), then the
+ * cpu, lpm, transmit, listen and crypto time of the interval (4 each) */
+static void
+put_binary_header(char *str, unsigned long seqno,
+                  unsigned long cpu, unsigned long lpm,
+                  unsigned long transmit, unsigned long listen,
+                  unsigned long crypto)
+{
+  printf("%s #E", str);
+  put_hex(clock_time(), 4);
+  put_hex(linkaddr_node_addr.u8[0], 1);
+  put_hex(linkaddr_node_addr.u8[1], 1);
+  put_hex(seqno, 2);
+  put_hex(cpu, 4);
+  put_hex(lpm, 4);
+  put_hex(transmit, 4);
+  put_hex(listen, 4);
+  put_hex(crypto, 4);
+}
+/*---------------------------------------------------------------------------*/
+/* One traffic class that saw packets in the interval: proto (1), channel
+ * (2), input and output packets (2 each), then the input tx, input rx,
+ * output tx and output rx time (4 each) */
+static void
+put_binary_stats(struct powertrace_sniff_stats *s)
+{
+  if(s->num_input == s->last_num_input &&
+     s->num_output == s->last_num_output) {
+    return;
+  }
+#if NETSTACK_CONF_WITH_IPV6
+  put_hex(s->proto, 1);
+#else
+  put_hex(0, 1);
+#endif
+  put_hex(s->channel, 2);
+  put_hex(s->num_input - s->last_num_input, 2);
+  put_hex(s->num_output - s->last_num_output, 2);
+  put_hex(s->input_txtime - s->last_input_txtime, 4);
+  put_hex(s->input_rxtime - s->last_input_rxtime, 4);
+  put_hex(s->output_txtime - s->last_output_txtime, 4);
+  put_hex(s->output_rxtime - s->last_output_rxtime, 4);
+  s->last_num_input = s->num_input;
+  s->last_num_output = s->num_output;
+}
+#endif /* POWERTRACE_BINARY */
+/*---------------------------------------------------------------------------*/
 void
 powertrace_print(char *str)
 {
   static unsigned long last_cpu, last_lpm, last_transmit, last_listen;
   static unsigned long last_idle_transmit, last_idle_listen;
+#if POWERTRACE_BINARY
+  static unsigned long last_crypto;
+  unsigned long crypto;
+#endif /* POWERTRACE_BINARY */
 
   unsigned long cpu, lpm, transmit, listen;
   unsigned long all_cpu, all_lpm, all_transmit, all_listen;
@@ -109,12 +185,33 @@ powertrace_print(char *str)
   last_idle_listen = compower_idle_activity.listen;
   last_idle_transmit = compower_idle_activity.transmit;
 
+#if POWERTRACE_BINARY
+  crypto = energest_type_time(ENERGEST_TYPE_CRYPTO) - last_crypto;
+  last_crypto = energest_type_time(ENERGEST_TYPE_CRYPTO);
+#endif /* POWERTRACE_BINARY */
+
   radio = transmit + listen;
   time = cpu + lpm;
   all_time = all_cpu + all_lpm;
   all_radio = energest_type_time(ENERGEST_TYPE_LISTEN) +
     energest_type_time(ENERGEST_TYPE_TRANSMIT);
+  /* No energest on native: avoid dividing by zero below */
+  if(time == 0) {
+    time = 1;
+  }
+  if(all_time == 0) {
+    all_time = 1;
+  }
+  if(radio == 0) {
+    radio = 1;
+  }
+  if(all_radio == 0) {
+    all_radio = 1;
+  }
 
+#if POWERTRACE_BINARY
+  put_binary_header(str, seqno, cpu, lpm, transmit, listen, crypto);
+#else /* POWERTRACE_BINARY */
   printf("%s %lu P %d.%d %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu (radio %d.%02d%% / %d.%02d%% tx %d.%02d%% / %d.%02d%% listen %d.%02d%% / %d.%02d%%)\n",
          str,
          clock_time(), linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1], seqno,
@@ -132,10 +229,13 @@ powertrace_print(char *str)
          (int)((10000L * all_listen) / all_time - (100L * all_listen / all_time) * 100),
          (int)((100L * listen) / time),
          (int)((10000L * listen) / time - (100L * listen / time) * 100));
+#endif /* POWERTRACE_BINARY */
 
   for(s = list_head(stats_list); s != NULL; s = list_item_next(s)) {
 
-#if ! NETSTACK_CONF_WITH_IPV6
+#if POWERTRACE_BINARY
+    put_binary_stats(s);
+#elif ! NETSTACK_CONF_WITH_IPV6
     printf("%s %lu SP %d.%d %lu %u %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu (channel %d radio %d.%02d%% / %d.%02d%%)\n",
            str, clock_time(), linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1], seqno,
            s->channel,
@@ -188,6 +288,9 @@ powertrace_print(char *str)
     s->last_output_rxtime = s->output_rxtime;
     
   }
+#if POWERTRACE_BINARY
+  putchar('\n');
+#endif /* POWERTRACE_BINARY */
   seqno++;
 }
 /*---------------------------------------------------------------------------*/
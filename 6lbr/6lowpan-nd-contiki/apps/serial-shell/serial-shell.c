@@ -92,9 +92,12 @@ shell_exit(void)
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(serial_shell_process, ev, data)
 {
+  static struct process_subscriber line;
+
   PROCESS_BEGIN();
 
   shell_init();
+  process_subscribe(&line, PROCESS_CURRENT(), serial_line_event_message);
 
   while(1) {
     PROCESS_WAIT_EVENT_UNTIL(ev == serial_line_event_message && data != NULL);
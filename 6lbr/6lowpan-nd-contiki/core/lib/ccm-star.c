@@ -170,8 +170,25 @@ aead(const uint8_t* nonce,
   }
 }
 /*---------------------------------------------------------------------------*/
+static void
+set_context(const struct aes_128_context *context)
+{
+  aes_128_set_context(context);
+}
+/*---------------------------------------------------------------------------*/
+void
+ccm_star_set_context(const struct aes_128_context *context)
+{
+  if(CCM_STAR.set_context != NULL) {
+    CCM_STAR.set_context(context);
+  } else {
+    CCM_STAR.set_key(context->key);
+  }
+}
+/*---------------------------------------------------------------------------*/
 const struct ccm_star_driver ccm_star_driver = {
   set_key,
-  aead
+  aead,
+  set_context
 };
 /*---------------------------------------------------------------------------*/
@@ -41,6 +41,7 @@
 #define CCM_STAR_H_
 
 #include "contiki.h"
+#include "lib/aes-128.h"
 
 #ifdef CCM_STAR_CONF
 #define CCM_STAR CCM_STAR_CONF
@@ -75,8 +76,22 @@ struct ccm_star_driver {
       const uint8_t* a, uint8_t a_len,
       uint8_t *result, uint8_t mic_len,
       int forward);
+
+  /**
+   * \brief         Sets the key in use from a context initialized with
+   *                aes_128_init_context(). Optional, use
+   *                ccm_star_set_context().
+   * \param context The expanded key to use.
+   */
+  void (* set_context)(const struct aes_128_context *context);
 };
 
 extern const struct ccm_star_driver CCM_STAR;
 
+/**
+ * \brief Sets the key in use from a context, through CCM_STAR.set_key
+ *        if the driver does not take contexts.
+ */
+void ccm_star_set_context(const struct aes_128_context *context);
+
 #endif /* CCM_STAR_H_ */
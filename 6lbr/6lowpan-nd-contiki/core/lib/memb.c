@@ -53,6 +53,17 @@ memb_init(struct memb *m)
 {
   memset(m->count, 0, m->num);
   memset(m->mem, 0, m->size * m->num);
+#if MEMB_FREELIST
+  m->free = 0;
+  m->fresh = 0;
+#endif /* MEMB_FREELIST */
+#if MEMB_FREELIST || MEMB_STATS
+  m->used = 0;
+#endif /* MEMB_FREELIST || MEMB_STATS */
+#if MEMB_STATS
+  m->high_water = 0;
+  m->alloc_failed = 0;
+#endif /* MEMB_STATS */
 }
 /*---------------------------------------------------------------------------*/
 void *
@@ -60,18 +71,44 @@ memb_alloc(struct memb *m)
 {
   int i;
 
+#if MEMB_FREELIST
+  if(m->free != 0) {
+    i = m->free - 1;
+    m->free = m->next[i];
+  } else if(m->fresh < m->num) {
+    i = m->fresh++;
+  } else {
+    i = m->num;
+  }
+#else /* MEMB_FREELIST */
   for(i = 0; i < m->num; ++i) {
     if(m->count[i] == 0) {
-      /* If this block was unused, we increase the reference count to
-	 indicate that it now is used and return a pointer to the
-	 memory block. */
-      ++(m->count[i]);
-      return (void *)((char *)m->mem + (i * m->size));
+      break;
     }
   }
+#endif /* MEMB_FREELIST */
+
+  if(i < m->num) {
+    /* If this block was unused, we increase the reference count to
+       indicate that it now is used and return a pointer to the
+       memory block. */
+    ++(m->count[i]);
+#if MEMB_FREELIST || MEMB_STATS
+    ++(m->used);
+#endif /* MEMB_FREELIST || MEMB_STATS */
+#if MEMB_STATS
+    if(m->used > m->high_water) {
+      m->high_water = m->used;
+    }
+#endif /* MEMB_STATS */
+    return (void *)((char *)m->mem + (i * m->size));
+  }
 
   /* No free block was found, so we return NULL to indicate failure to
      allocate block. */
+#if MEMB_STATS
+  ++(m->alloc_failed);
+#endif /* MEMB_STATS */
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -79,25 +116,35 @@ char
 memb_free(struct memb *m, void *ptr)
 {
   int i;
-  char *ptr2;
+  unsigned long offset;
 
-  /* Walk through the list of blocks and try to find the block to
-     which the pointer "ptr" points to. */
-  ptr2 = (char *)m->mem;
-  for(i = 0; i < m->num; ++i) {
-    
-    if(ptr2 == (char *)ptr) {
-      /* We've found to block to which "ptr" points so we decrease the
-	 reference count and return the new value of it. */
-      if(m->count[i] > 0) {
-	/* Make sure that we don't deallocate free memory. */
-	--(m->count[i]);
-      }
-      return m->count[i];
+  /* Find the block to which the pointer "ptr" points to. It must
+     point to the start of one of the blocks. */
+  if(!memb_inmemb(m, ptr)) {
+    return -1;
+  }
+  offset = (unsigned long)((char *)ptr - (char *)m->mem);
+  if(offset % m->size != 0) {
+    return -1;
+  }
+  i = offset / m->size;
+
+  /* We've found to block to which "ptr" points so we decrease the
+     reference count and return the new value of it. */
+  if(m->count[i] > 0) {
+    /* Make sure that we don't deallocate free memory. */
+    --(m->count[i]);
+    if(m->count[i] == 0) {
+#if MEMB_FREELIST
+      m->next[i] = m->free;
+      m->free = i + 1;
+#endif /* MEMB_FREELIST */
+#if MEMB_FREELIST || MEMB_STATS
+      --(m->used);
+#endif /* MEMB_FREELIST || MEMB_STATS */
     }
-    ptr2 += m->size;
   }
-  return -1;
+  return m->count[i];
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -110,6 +157,9 @@ memb_inmemb(struct memb *m, void *ptr)
 int
 memb_numfree(struct memb *m)
 {
+#if MEMB_FREELIST
+  return m->num - m->used;
+#else /* MEMB_FREELIST */
   int i;
   int num_free = 0;
 
@@ -120,5 +170,6 @@ memb_numfree(struct memb *m)
   }
 
   return num_free;
+#endif /* MEMB_FREELIST */
 }
 /** @} */
@@ -86,18 +86,57 @@ MEMB(connections, struct connection, 16);
  * \param num The total number of memory chunks in the block.
  *
  */
+#ifdef MEMB_CONF_FREELIST
+#define MEMB_FREELIST MEMB_CONF_FREELIST
+#else
+#define MEMB_FREELIST 0
+#endif /* MEMB_CONF_FREELIST */
+
+#ifdef MEMB_CONF_STATS
+#define MEMB_STATS MEMB_CONF_STATS
+#else
+#define MEMB_STATS 0
+#endif /* MEMB_CONF_STATS */
+
+#if MEMB_FREELIST
+#define MEMB_FREELIST_DECLARE(name, num) \
+        static unsigned short CC_CONCAT(name,_memb_next)[num];
+#define MEMB_FREELIST_INIT(name) , CC_CONCAT(name,_memb_next)
+#else
+#define MEMB_FREELIST_DECLARE(name, num)
+#define MEMB_FREELIST_INIT(name)
+#endif /* MEMB_FREELIST */
+
 #define MEMB(name, structure, num) \
         static char CC_CONCAT(name,_memb_count)[num]; \
         static structure CC_CONCAT(name,_memb_mem)[num]; \
+        MEMB_FREELIST_DECLARE(name, num) \
         static struct memb name = {sizeof(structure), num, \
                                           CC_CONCAT(name,_memb_count), \
-                                          (void *)CC_CONCAT(name,_memb_mem)}
+                                          (void *)CC_CONCAT(name,_memb_mem) \
+                                          MEMB_FREELIST_INIT(name)}
 
 struct memb {
   unsigned short size;
   unsigned short num;
   char *count;
   void *mem;
+#if MEMB_FREELIST
+  /* Free blocks are kept on a list linked through next[], so that
+     allocation does not have to scan count[]. Blocks at index
+     "fresh" and above have never been allocated and are not on the
+     list, which lets a MEMB() work without memb_init(). */
+  unsigned short *next;
+  unsigned short free;   /* index + 1 of the first free block, 0 if none */
+  unsigned short fresh;
+#endif /* MEMB_FREELIST */
+#if MEMB_FREELIST || MEMB_STATS
+  unsigned short used;
+#endif /* MEMB_FREELIST || MEMB_STATS */
+#if MEMB_STATS
+  unsigned short high_water;
+  unsigned short alloc_failed;
+#endif /* MEMB_STATS */
 };
 
 /**
@@ -132,6 +171,24 @@ int memb_inmemb(struct memb *m, void *ptr);
 
 int  memb_numfree(struct memb *m);
 
+#if MEMB_STATS
+/**
+ * Get the highest number of blocks that have been allocated at the
+ * same time since memb_init().
+ *
+ * \param m A memory block previously declared with MEMB().
+ */
+#define memb_high_water(m)   ((m)->high_water)
+
+/**
+ * Get the number of calls to memb_alloc() that failed because the
+ * memory block was exhausted.
+ *
+ * \param m A memory block previously declared with MEMB().
+ */
+#define memb_alloc_failed(m) ((m)->alloc_failed)
+#endif /* MEMB_STATS */
+
 /** @} */
 /** @} */
 
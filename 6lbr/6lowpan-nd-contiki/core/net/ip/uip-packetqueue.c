@@ -6,8 +6,7 @@
 
 #include "net/ip/uip-packetqueue.h"
 
-#define MAX_NUM_QUEUED_PACKETS 2
-MEMB(packets_memb, struct uip_packetqueue_packet, MAX_NUM_QUEUED_PACKETS);
+MEMB(packets_memb, struct uip_packetqueue_packet, UIP_PACKETQUEUE_NUM);
 
 #define DEBUG 0
 #if DEBUG
@@ -17,15 +16,30 @@ MEMB(packets_memb, struct uip_packetqueue_packet, MAX_NUM_QUEUED_PACKETS);
 #define PRINTF(...)
 #endif
 
+/*---------------------------------------------------------------------------*/
+static void
+packet_remove(struct uip_packetqueue_packet *p)
+{
+  struct uip_packetqueue_handle *h = p->handle;
+  struct uip_packetqueue_packet **pp;
+
+  for(pp = &h->packet; *pp != NULL; pp = &(*pp)->next) {
+    if(*pp == p) {
+      *pp = p->next;
+      h->count--;
+      break;
+    }
+  }
+  memb_free(&packets_memb, p);
+}
 /*---------------------------------------------------------------------------*/
 static void
 packet_timedout(void *ptr)
 {
-  struct uip_packetqueue_handle *h = ptr;
+  struct uip_packetqueue_packet *p = ptr;
 
-  PRINTF("uip_packetqueue_free timed out %p\n", h);
-  memb_free(&packets_memb, h->packet);
-  h->packet = NULL;
+  PRINTF("uip_packetqueue_free timed out %p\n", p->handle);
+  packet_remove(p);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -33,24 +47,33 @@ uip_packetqueue_new(struct uip_packetqueue_handle *handle)
 {
   PRINTF("uip_packetqueue_new %p\n", handle);
   handle->packet = NULL;
+  handle->count = 0;
 }
 /*---------------------------------------------------------------------------*/
 struct uip_packetqueue_packet *
 uip_packetqueue_alloc(struct uip_packetqueue_handle *handle, clock_time_t lifetime)
 {
+  struct uip_packetqueue_packet *p;
+  struct uip_packetqueue_packet **pp;
+
   PRINTF("uip_packetqueue_alloc %p\n", handle);
-  if(handle->packet != NULL) {
-    PRINTF("alloced\n");
+  if(handle->count >= UIP_PACKETQUEUE_PER_NBR) {
+    PRINTF("queue full\n");
     return NULL;
   }
-  handle->packet = memb_alloc(&packets_memb);
-  if(handle->packet != NULL) {
-    ctimer_set(&handle->packet->lifetimer, lifetime,
-               packet_timedout, handle);
-  } else {
+  p = memb_alloc(&packets_memb);
+  if(p == NULL) {
     PRINTF("uip_packetqueue_alloc failed\n");
+    return NULL;
   }
-  return handle->packet;
+  p->next = NULL;
+  p->queue_buf_len = 0;
+  p->handle = handle;
+  for(pp = &handle->packet; *pp != NULL; pp = &(*pp)->next);
+  *pp = p;
+  handle->count++;
+  ctimer_set(&p->lifetimer, lifetime, packet_timedout, p);
+  return p;
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -59,8 +82,16 @@ uip_packetqueue_free(struct uip_packetqueue_handle *handle)
   PRINTF("uip_packetqueue_free %p\n", handle);
   if(handle->packet != NULL) {
     ctimer_stop(&handle->packet->lifetimer);
-    memb_free(&packets_memb, handle->packet);
-    handle->packet = NULL;
+    packet_remove(handle->packet);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_packetqueue_flush(struct uip_packetqueue_handle *handle)
+{
+  PRINTF("uip_packetqueue_flush %p\n", handle);
+  while(handle->packet != NULL) {
+    uip_packetqueue_free(handle);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -84,3 +115,9 @@ uip_packetqueue_set_buflen(struct uip_packetqueue_handle *h, uint16_t len)
   }
 }
 /*---------------------------------------------------------------------------*/
+uint8_t
+uip_packetqueue_count(struct uip_packetqueue_handle *h)
+{
+  return h->count;
+}
+/*---------------------------------------------------------------------------*/
@@ -3,33 +3,56 @@
 
 #include "sys/ctimer.h"
 
+/* Total number of packets that may be queued, shared by all neighbors */
+#ifdef UIP_CONF_PACKETQUEUE_NUM
+#define UIP_PACKETQUEUE_NUM UIP_CONF_PACKETQUEUE_NUM
+#else
+#define UIP_PACKETQUEUE_NUM 2
+#endif
+
+/* Maximum number of packets queued for a single neighbor */
+#ifdef UIP_CONF_PACKETQUEUE_PER_NBR
+#define UIP_PACKETQUEUE_PER_NBR UIP_CONF_PACKETQUEUE_PER_NBR
+#else
+#define UIP_PACKETQUEUE_PER_NBR UIP_PACKETQUEUE_NUM
+#endif
+
 struct uip_packetqueue_handle;
 
 struct uip_packetqueue_packet {
-  struct uip_ds6_queued_packet *next;
+  struct uip_packetqueue_packet *next;
   uint8_t queue_buf[UIP_BUFSIZE - UIP_LLH_LEN];
   uint16_t queue_buf_len;
   struct ctimer lifetimer;
   struct uip_packetqueue_handle *handle;
 };
 
+/* A FIFO of packets, oldest first */
 struct uip_packetqueue_handle {
   struct uip_packetqueue_packet *packet;
+  uint8_t count;
 };
 
 void uip_packetqueue_new(struct uip_packetqueue_handle *handle);
 
-
+/* Append a packet to the tail of the queue. Returns NULL if the
+   neighbor or the shared pool is full. */
 struct uip_packetqueue_packet *
 uip_packetqueue_alloc(struct uip_packetqueue_handle *handle, clock_time_t lifetime);
 
-
+/* Remove the packet at the head of the queue */
 void
 uip_packetqueue_free(struct uip_packetqueue_handle *handle);
 
+/* Remove all packets in the queue */
+void
+uip_packetqueue_flush(struct uip_packetqueue_handle *handle);
+
+/* Accessors for the packet at the head of the queue */
 uint8_t *uip_packetqueue_buf(struct uip_packetqueue_handle *h);
 uint16_t uip_packetqueue_buflen(struct uip_packetqueue_handle *h);
 void uip_packetqueue_set_buflen(struct uip_packetqueue_handle *h, uint16_t len);
 
+uint8_t uip_packetqueue_count(struct uip_packetqueue_handle *h);
 
 #endif /* UIP_PACKETQUEUE_H */
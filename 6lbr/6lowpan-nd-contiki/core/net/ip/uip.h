@@ -1511,6 +1511,13 @@ struct uip_stats {
     uip_stats_t drop;     /**< Number of dropped ND6 packets. */
     uip_stats_t recv;     /**< Number of recived ND6 packets */
     uip_stats_t sent;     /**< Number of sent ND6 packets */
+    uip_stats_t unautherr;/**< Number of NS dropped because the EUI-64
+                               of their ARO is not authorized. */
+    uip_stats_t nonceerr; /**< Number of NS dropped because of a
+                               replayed nonce. */
+    uip_stats_t autherr;  /**< Number of NS failing authentication. */
+    uip_stats_t duperr;   /**< Number of duplicate address ARO
+                               statuses sent or received. */
   } nd6;
 #endif /*NETSTACK_CONF_WITH_IPV6*/
 };
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Binary trace of the secured 6LoWPAN-ND registration
+ */
+
+#include "contiki.h"
+#include "net/ipv6/nd6-trace.h"
+#include "lib/ringbufindex.h"
+#include <stdio.h>
+#include <string.h>
+
+#if ND6_TRACE_ENABLED
+
+/* Check if ND6_TRACE_LEN is a power of two */
+#if (ND6_TRACE_LEN & (ND6_TRACE_LEN - 1)) != 0
+#error ND6_TRACE_LEN must be power of two
+#endif
+
+static struct ringbufindex trace_ringbuf;
+static struct nd6_trace_rec trace_array[ND6_TRACE_LEN];
+static uint16_t trace_dropped;
+static uint8_t initialized;
+
+#if ND6_TRACE_OUTPUT
+PROCESS(nd6_trace_process, "ND6 trace");
+
+/*---------------------------------------------------------------------------*/
+static void
+put_hex(const uint8_t *p, uint8_t len)
+{
+  static const char hex[] = "0123456789abcdef";
+
+  while(len--) {
+    putchar(hex[*p >> 4]);
+    putchar(hex[*p & 0x0f]);
+    p++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* One "#T" line per record, 32 hex digits in the order of
+ * struct nd6_trace_rec */
+static void
+put_record(const struct nd6_trace_rec *rec)
+{
+  uint8_t b[8];
+
+  b[0] = rec->time;
+  b[1] = rec->time >> 8;
+  b[2] = rec->time >> 16;
+  b[3] = rec->time >> 24;
+  b[4] = rec->arg;
+  b[5] = rec->arg >> 8;
+  b[6] = rec->event;
+  b[7] = rec->arg8;
+  putchar('#');
+  putchar('T');
+  put_hex(b, sizeof(b));
+  put_hex(rec->data, sizeof(rec->data));
+  putchar('\n');
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(nd6_trace_process, ev, data)
+{
+  static struct nd6_trace_rec rec;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+    if(trace_dropped > 0) {
+      memset(&rec, 0, sizeof(rec));
+      rec.time = clock_time();
+      rec.event = ND6_TRACE_DROPPED;
+      rec.arg = trace_dropped;
+      trace_dropped = 0;
+      put_record(&rec);
+    }
+    while(nd6_trace_read(&rec)) {
+      put_record(&rec);
+    }
+  }
+
+  PROCESS_END();
+}
+#endif /* ND6_TRACE_OUTPUT */
+/*---------------------------------------------------------------------------*/
+void
+nd6_trace_add(uint8_t event, uint8_t arg8, uint16_t arg,
+              const void *data, uint8_t len)
+{
+  struct nd6_trace_rec *rec;
+  int index;
+
+  if(!initialized) {
+    return;
+  }
+  index = ringbufindex_peek_put(&trace_ringbuf);
+  if(index == -1) {
+    trace_dropped++;
+    return;
+  }
+  rec = &trace_array[index];
+  rec->time = clock_time();
+  rec->arg = arg;
+  rec->event = event;
+  rec->arg8 = arg8;
+  if(len > sizeof(rec->data)) {
+    len = sizeof(rec->data);
+  }
+  memcpy(rec->data, data, len);
+  memset(rec->data + len, 0, sizeof(rec->data) - len);
+  ringbufindex_put(&trace_ringbuf);
+#if ND6_TRACE_OUTPUT
+  process_poll(&nd6_trace_process);
+#endif /* ND6_TRACE_OUTPUT */
+}
+/*---------------------------------------------------------------------------*/
+void
+nd6_trace_hash(uint16_t len, uint32_t ticks, const uint8_t *digest)
+{
+  uint8_t data[8];
+
+  data[0] = ticks & 0xff;
+  data[1] = (ticks >> 8) & 0xff;
+  data[2] = (ticks >> 16) & 0xff;
+  data[3] = ticks >> 24;
+  memcpy(data + 4, digest, 4);
+  nd6_trace_add(ND6_TRACE_HASH, 0, len, data, sizeof(data));
+}
+/*---------------------------------------------------------------------------*/
+int
+nd6_trace_read(struct nd6_trace_rec *rec)
+{
+  int index;
+
+  if(!initialized) {
+    return 0;
+  }
+  index = ringbufindex_peek_get(&trace_ringbuf);
+  if(index == -1) {
+    return 0;
+  }
+  memcpy(rec, &trace_array[index], sizeof(*rec));
+  ringbufindex_get(&trace_ringbuf);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+nd6_trace_init(void)
+{
+  uint8_t rtimer_second[4];
+
+  if(initialized) {
+    return;
+  }
+  ringbufindex_init(&trace_ringbuf, ND6_TRACE_LEN);
+  trace_dropped = 0;
+  initialized = 1;
+#if ND6_TRACE_OUTPUT
+  process_start(&nd6_trace_process, NULL);
+#endif /* ND6_TRACE_OUTPUT */
+  rtimer_second[0] = (uint32_t)RTIMER_SECOND & 0xff;
+  rtimer_second[1] = ((uint32_t)RTIMER_SECOND >> 8) & 0xff;
+  rtimer_second[2] = ((uint32_t)RTIMER_SECOND >> 16) & 0xff;
+  rtimer_second[3] = (uint32_t)RTIMER_SECOND >> 24;
+  nd6_trace_add(ND6_TRACE_START, sizeof(clock_time_t), CLOCK_SECOND,
+                rtimer_second, sizeof(rtimer_second));
+}
+#endif /* ND6_TRACE_ENABLED */
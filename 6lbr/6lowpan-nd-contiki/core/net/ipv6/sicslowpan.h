@@ -73,6 +73,24 @@
 #define SICSLOWPAN_COMPRESSION_HC06        2
 /** @} */
 
+/**
+ * \name ND option profile
+ *
+ * For RS, RA, NS and NA, whose code is always 0, the low byte of the
+ * PACKETBUF_ATTR_CHANNEL that powertrace sniffs carries the options the
+ * message has instead of the code.
+ * @{
+ */
+#define SICSLOWPAN_ND_PROFILE_SLLAO                 0x01
+#define SICSLOWPAN_ND_PROFILE_TLLAO                 0x02
+#define SICSLOWPAN_ND_PROFILE_PIO                   0x04
+#define SICSLOWPAN_ND_PROFILE_ARO                   0x08
+#define SICSLOWPAN_ND_PROFILE_6CO                   0x10
+#define SICSLOWPAN_ND_PROFILE_ABRO                  0x20
+#define SICSLOWPAN_ND_PROFILE_NONCE                 0x40
+#define SICSLOWPAN_ND_PROFILE_AUTH                  0x80
+/** @} */
+
 /**
  * \name 6lowpan dispatches
  * @{
@@ -52,10 +52,23 @@
 #include "net/ipv6/uip-ds6-reg.h"
 #include "net/ipv6/uip-ds6.h"
 #include "net/ip/uip-nameserver.h"
+#include "net/ip/tcpip.h"
 #include "lib/random.h"
 #include "dev/ds2411/ds2411.h"
+#include "net/ipv6/nd6-trace.h"
+#include "net/ipv6/nd6-stats.h"
+#if UIP_ND6_PAIRWISE_LLSEC
+#include "net/packetbuf.h"
+#include "net/llsec/pairwisesec/pairwisesec.h"
+#endif /* UIP_ND6_PAIRWISE_LLSEC */
 /*------------------------------------------------------------------*/
-#define DEBUG 1
+/* Debug output of the secured ND, off unless UIP_ND6_CONF_DEBUG is set;
+ * nd6-trace records the same path without printf */
+#ifdef UIP_ND6_CONF_DEBUG
+#define DEBUG UIP_ND6_CONF_DEBUG
+#else /* UIP_ND6_CONF_DEBUG */
+#define DEBUG 0
+#endif /* UIP_ND6_CONF_DEBUG */
 #include "net/ip/uip-debug.h"
 #define PRINTADDR(addr) PRINTF("%02x%02x:%02x%02x:%02x%02x:%02x%02x ", ((uint8_t *)addr)[0], ((uint8_t *)addr)[1], ((uint8_t *)addr)[2], ((uint8_t *)addr)[3], ((uint8_t *)addr)[4], ((uint8_t *)addr)[5], ((uint8_t *)addr)[6], ((uint8_t *)addr)[7])
 #if UIP_LOGGING
@@ -67,13 +80,6 @@ void uip_log(char *msg);
 #define UIP_LOG(m)
 #endif /* UIP_LOGGING == 1 */
 
-void __print__(unsigned char c, unsigned char* x, unsigned long long xlen) {
-  unsigned long long i;
-  printf("%c[%d]=", c, (int)xlen);
-  for (i = 0; i < xlen; ++i) printf("%02x", x[i]);
-  printf("\n");
-}
-
 //#if UIP_CONF_IPV6_LOWPAN_ND
 /*------------------------------------------------------------------*/
 /** @{ */
@@ -218,7 +224,11 @@ ns_input(void)
 	uip_802154_longaddr eui64;
 	uip_ds6_reg_t *reg_query;
 	uint8_t counter[6];
+	uint16_t aro_lifetime;
+	uint16_t aro_offset;
 
+	ND6_STATS_BEGIN();
+	ND6_TRACE(ND6_TRACE_NS_IN, 0, 0, ND6_TRACE_IID(&UIP_IP_BUF->srcipaddr), 8);
 	PRINTF("Received NS from ");
 	PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
 	PRINTF(" to ");
@@ -244,25 +254,39 @@ ns_input(void)
 	nd6_opt_aro = NULL;
 	nd6_opt_nonce = NULL;
 	nd6_opt_auth = NULL;
+	reg_query = NULL;
+	reg_status = UIP_ND6_ARO_SUCCESS;
+	aro_offset = 0;
 	nd6_opt_offset = UIP_ND6_NS_LEN;
 
   /* Verification of security registration related aspects  */
 	while(uip_l3_icmp_hdr_len + nd6_opt_offset < uip_len) {
 #if UIP_CONF_IPV6_CHECKS
-		if(UIP_ND6_OPT_HDR_BUF->len == 0) {
+		if(UIP_ND6_OPT_HDR_BUF->len == 0 ||
+			uip_l3_icmp_hdr_len + nd6_opt_offset + (UIP_ND6_OPT_HDR_BUF->len << 3) > uip_len) {
 			PRINTF("NS received is bad\n");
 			goto discard;
 		}
 #endif /* UIP_CONF_IPV6_CHECKS */
 		switch (UIP_ND6_OPT_HDR_BUF->type) {
 		case UIP_ND6_OPT_ARO:
+			if(aro_offset != 0) {
+				/* Only the first ARO is authenticated and registered */
+				break;
+			}
 			PRINTF("Processing ARO option in NS\n");
 			addr = uip_ds6_addr_lookup(&UIP_ND6_NS_BUF->tgtipaddr);
 			if(addr != NULL){  //only handle ARO in the NS message which send to me
 				nd6_opt_aro = UIP_ND6_OPT_ARO_BUF;
+				aro_offset = nd6_opt_offset;
 				/*step 1. Verify MAC address*/
 				memcpy(&eui64, &nd6_opt_aro->eui64, sizeof(uip_802154_longaddr));
-				if( (reg_query = uip_ds6_reg_lookup_mac(eui64)) == NULL){
+				ND6_STATS_MARK();
+				reg_query = uip_ds6_reg_lookup_mac(eui64);
+				ND6_STATS_LAP(ND6_STATS_NS_MAC);
+				if(reg_query == NULL){
+					ND6_TRACE(ND6_TRACE_ARO_UNAUTH, 0, 0, &eui64, sizeof(eui64));
+					UIP_STAT(++uip_stat.nd6.unautherr);
 					PRINTF("Unauthorized node MAC address in NS, discard ...\n");
 					goto discard;
 				}else{
@@ -270,114 +294,151 @@ ns_input(void)
 				}
 			}
 			break;
-		}
-		nd6_opt_offset += (UIP_ND6_OPT_HDR_BUF->len << 3);
-	}
-	nd6_opt_offset = UIP_ND6_NS_LEN;
-
-	while(uip_l3_icmp_hdr_len + nd6_opt_offset < uip_len) {
-		switch (UIP_ND6_OPT_HDR_BUF->type) {
 		case UIP_ND6_OPT_NONCE:
-			PRINTF("Processing NONCE option in NS\n");
 			nd6_opt_nonce = UIP_ND6_OPT_NONCE_BUF;
-			/*step 2. Verify Nonce option*/
-			if(compareArr(reg_query->counter, nd6_opt_nonce->counter, 6) < 0)
-				PRINTF("Nonce is valid in NS, continue verification ...\n");
-			else{
-				PRINTF("Nonce is invalid in NS, discard ...\n");
+			break;
+		case UIP_ND6_OPT_AUTH:
+			/* The authenticator is a full 32-byte digest */
+			if((UIP_ND6_OPT_HDR_BUF->len << 3) < 2 + 32) {
+				PRINTF("AUTH option in NS is too short, discard ...\n");
 				goto discard;
 			}
+			nd6_opt_auth = UIP_ND6_OPT_AUTH_BUF;
 			break;
+		}
+		nd6_opt_offset += (UIP_ND6_OPT_HDR_BUF->len << 3);
+	}
 
-		case UIP_ND6_OPT_AUTH:
-			PRINTF("Processing AUTH option in NS\n");
-			nd6_opt_auth = UIP_ND6_OPT_AUTH_BUF;
-			/*step 3. Verify Auth option*/
-			uip_ip6addr_t gp16;
-			memcpy(&gp16, &UIP_IP_BUF->srcipaddr, sizeof(uip_ip6addr_t));
-
-			uint16_t LT[1]={nd6_opt_aro->lifetime};
-
-			lbr_info lbrinfo;
-
-			for(prefix = uip_ds6_prefix_list;
-				prefix < uip_ds6_prefix_list + UIP_DS6_PREFIX_NB; prefix++) {
-			  if((prefix->isused) && (prefix->advertise)) {
-				  lbrinfo.pio.type = UIP_ND6_OPT_PREFIX_INFO;
-				  lbrinfo.pio.len = UIP_ND6_OPT_PREFIX_INFO_LEN / 8;
-				  lbrinfo.pio.preflen = prefix->length;
-				  lbrinfo.pio.flagsreserved1 = prefix->l_a_reserved;
-				  lbrinfo.pio.validlt = uip_htonl(prefix->vlifetime);
-				  lbrinfo.pio.preferredlt = uip_htonl(prefix->plifetime);
-				  lbrinfo.pio.reserved2 = 0;
-				uip_ipaddr_copy(&(lbrinfo.pio.prefix), &(prefix->ipaddr));
-			  }
-			}
+	/*
+	 * The NONCE and AUTH options are checked once all options are known, so
+	 * that their order in the NS does not matter and an ARO placed before them
+	 * cannot be registered without them.
+	 */
+	if(reg_query != NULL) {
+		if(nd6_opt_nonce == NULL || nd6_opt_auth == NULL) {
+			UIP_STAT(++uip_stat.nd6.autherr);
+			PRINTF("ARO without NONCE or AUTH in NS, discard ...\n");
+			goto discard;
+		}
 
-			for(context = uip_ds6_context_list;
-				context < uip_ds6_context_list + UIP_DS6_6CO_NB; context++) {
-			  if(context->state==2) { //IN_USE_COMPRESS
-				  lbrinfo.co.type = UIP_ND6_OPT_6CO;
-				  lbrinfo.co.len = UIP_ND6_OPT_6CO_LEN ;
-				  lbrinfo.co.context_len = context->length;
-				  lbrinfo.co.res1_c_cid = 16 + context->context_id; // Flag C is set to 1
-				  lbrinfo.co.valid_lifetime = uip_htons(context->vlifetime);
-				  lbrinfo.co.reserved = 0;
-				uip_ipaddr_copy(&(lbrinfo.co.prefix), &(context->prefix));
-			  }
-			}
+		/*step 2. Verify Nonce option*/
+		PRINTF("Processing NONCE option in NS\n");
+		ND6_STATS_MARK();
+		if(compareArr(reg_query->counter, nd6_opt_nonce->counter, 6) < 0) {
+			ND6_STATS_LAP(ND6_STATS_NS_NONCE);
+			ND6_TRACE(ND6_TRACE_NONCE, 1, 0, nd6_opt_nonce->counter, 6);
+			PRINTF("Nonce is valid in NS, continue verification ...\n");
+		} else{
+			ND6_TRACE(ND6_TRACE_NONCE, 0, 0, nd6_opt_nonce->counter, 6);
+			UIP_STAT(++uip_stat.nd6.nonceerr);
+			PRINTF("Nonce is invalid in NS, discard ...\n");
+			goto discard;
+		}
 
-			lbrinfo.abro.type = (uint8_t)UIP_ND6_OPT_ABRO;
-			lbrinfo.abro.len = (uint8_t) UIP_ND6_OPT_ABRO_LEN;
-			lbrinfo.abro.v_low = 0xABCD; /*v_low*/
-			lbrinfo.abro.v_high = 0x1234; /*v_high*/
-			lbrinfo.abro.valid_lifetime = 0xFFFF; /*uip_htons(lifetime)*/
-			memcpy(&(lbrinfo.abro.ipaddr), &global_fipaddr, 16);
-
-			int len = sizeof(gp16) + sizeof(eui64) + sizeof(LT) + sizeof(lbrinfo) +
-					sizeof(nd6_opt_nonce->counter) + sizeof(reg_query->key);
-
-			uint8_t m[128];
-
-			memcpy(m, &gp16, sizeof(gp16));
-			memcpy(m + sizeof(gp16), &eui64, sizeof(eui64));
-			memcpy(m + sizeof(gp16) + sizeof(eui64), LT, sizeof(LT));
-			memcpy(m + sizeof(gp16) + sizeof(eui64) + sizeof(LT), &lbrinfo, sizeof(lbrinfo));
-			memcpy(m + sizeof(gp16) + sizeof(eui64) + sizeof(LT) + sizeof(lbrinfo),
-					nd6_opt_nonce->counter, sizeof(nd6_opt_nonce->counter));
-			memcpy(m + sizeof(gp16) + sizeof(eui64) + sizeof(LT) + sizeof(lbrinfo) + sizeof(nonce_arr),
-					reg_query->key, sizeof(reg_query->key));
-
-			unsigned char h[32];
-			unsigned long long mlen = len;
-			int result = 0;
-
-			__print__('m', m, mlen);
-			printf(" -> ");
-			result |= crypto_hash(h, m, mlen);
-			__print__('h', h, CRYPTO_BYTES);
-
-			int k;
-			PRINTF("# received auth:");
-			for(k=0;k<32;k++)
-				PRINTF("%02x",nd6_opt_auth->auth[k]);
-			PRINTF("\n");
-
-			PRINTF("# calculate auth:");
-			for(k=0;k<32;k++)
-				PRINTF("%02x",h[k]);
-			PRINTF("\n");
-
-
-			if(!memcmp(nd6_opt_auth->auth, h, sizeof(h))){
-				PRINTF("Authentication passed, execute DAD next ...\n");
-			}
-			else{
-				PRINTF("Authentication failed, discard ...\n");
-				goto discard;
-			}
-		break;
+		/*step 3. Verify Auth option*/
+		PRINTF("Processing AUTH option in NS\n");
+		ND6_STATS_MARK();
+		uip_ip6addr_t gp16;
+		memcpy(&gp16, &UIP_IP_BUF->srcipaddr, sizeof(uip_ip6addr_t));
+
+		uint16_t LT[1]={nd6_opt_aro->lifetime};
+
+		lbr_info lbrinfo;
+
+		for(prefix = uip_ds6_prefix_list;
+			prefix < uip_ds6_prefix_list + UIP_DS6_PREFIX_NB; prefix++) {
+		  if((prefix->isused) && (prefix->advertise)) {
+			  lbrinfo.pio.type = UIP_ND6_OPT_PREFIX_INFO;
+			  lbrinfo.pio.len = UIP_ND6_OPT_PREFIX_INFO_LEN / 8;
+			  lbrinfo.pio.preflen = prefix->length;
+			  lbrinfo.pio.flagsreserved1 = prefix->l_a_reserved;
+			  lbrinfo.pio.validlt = uip_htonl(prefix->vlifetime);
+			  lbrinfo.pio.preferredlt = uip_htonl(prefix->plifetime);
+			  lbrinfo.pio.reserved2 = 0;
+			uip_ipaddr_copy(&(lbrinfo.pio.prefix), &(prefix->ipaddr));
+		  }
+		}
 
+		for(context = uip_ds6_context_list;
+			context < uip_ds6_context_list + UIP_DS6_6CO_NB; context++) {
+		  if(context->state==2) { //IN_USE_COMPRESS
+			  lbrinfo.co.type = UIP_ND6_OPT_6CO;
+			  lbrinfo.co.len = UIP_ND6_OPT_6CO_LEN ;
+			  lbrinfo.co.context_len = context->length;
+			  lbrinfo.co.res1_c_cid = 16 + context->context_id; // Flag C is set to 1
+			  lbrinfo.co.valid_lifetime = uip_htons(context->vlifetime);
+			  lbrinfo.co.reserved = 0;
+			uip_ipaddr_copy(&(lbrinfo.co.prefix), &(context->prefix));
+		  }
+		}
+
+		lbrinfo.abro.type = (uint8_t)UIP_ND6_OPT_ABRO;
+		lbrinfo.abro.len = (uint8_t) UIP_ND6_OPT_ABRO_LEN;
+		lbrinfo.abro.v_low = 0xABCD; /*v_low*/
+		lbrinfo.abro.v_high = 0x1234; /*v_high*/
+		lbrinfo.abro.valid_lifetime = 0xFFFF; /*uip_htons(lifetime)*/
+		memcpy(&(lbrinfo.abro.ipaddr), &global_fipaddr, 16);
+
+		int len = sizeof(gp16) + sizeof(eui64) + sizeof(LT) + sizeof(lbrinfo) +
+				sizeof(nd6_opt_nonce->counter) + sizeof(reg_query->key);
+
+		uint8_t m[128];
+
+		memcpy(m, &gp16, sizeof(gp16));
+		memcpy(m + sizeof(gp16), &eui64, sizeof(eui64));
+		memcpy(m + sizeof(gp16) + sizeof(eui64), LT, sizeof(LT));
+		memcpy(m + sizeof(gp16) + sizeof(eui64) + sizeof(LT), &lbrinfo, sizeof(lbrinfo));
+		memcpy(m + sizeof(gp16) + sizeof(eui64) + sizeof(LT) + sizeof(lbrinfo),
+				nd6_opt_nonce->counter, sizeof(nd6_opt_nonce->counter));
+		memcpy(m + sizeof(gp16) + sizeof(eui64) + sizeof(LT) + sizeof(lbrinfo) + sizeof(nonce_arr),
+				reg_query->key, sizeof(reg_query->key));
+
+		unsigned char h[32];
+		unsigned long long mlen = len;
+		int result = 0;
+#if ND6_TRACE_ENABLED
+		rtimer_clock_t hash_start;
+#endif /* ND6_TRACE_ENABLED */
+
+		ND6_STATS_LAP(ND6_STATS_NS_LBR_INFO);
+#if ND6_TRACE_ENABLED
+		hash_start = RTIMER_NOW();
+#endif /* ND6_TRACE_ENABLED */
+		ENERGEST_ON(ENERGEST_TYPE_CRYPTO);
+		result |= crypto_hash(h, m, mlen);
+		ENERGEST_OFF(ENERGEST_TYPE_CRYPTO);
+		ND6_STATS_LAP(ND6_STATS_NS_HASH);
+#if ND6_TRACE_ENABLED
+		nd6_trace_hash(mlen, (rtimer_clock_t)(RTIMER_NOW() - hash_start), h);
+#endif /* ND6_TRACE_ENABLED */
+
+		/* First bytes of the received and of the computed authenticator */
+		uint8_t auth_trace[8];
+		memcpy(auth_trace, nd6_opt_auth->auth, 4);
+		memcpy(auth_trace + 4, h, 4);
+
+		if(!memcmp(nd6_opt_auth->auth, h, sizeof(h))){
+			ND6_TRACE(ND6_TRACE_AUTH, 1, 0, auth_trace, 8);
+			PRINTF("Authentication passed, execute DAD next ...\n");
+		}
+		else{
+			ND6_TRACE(ND6_TRACE_AUTH, 0, 0, auth_trace, 8);
+			UIP_STAT(++uip_stat.nd6.autherr);
+			PRINTF("Authentication failed, discard ...\n");
+			goto discard;
+		}
+
+		/* Remember the counter, a replayed NS must not pass the nonce check */
+		memcpy(counter, nd6_opt_nonce->counter, sizeof(counter));
+	}
+	nd6_opt_offset = UIP_ND6_NS_LEN;
+
+	while(uip_l3_icmp_hdr_len + nd6_opt_offset < uip_len) {
+		switch (UIP_ND6_OPT_HDR_BUF->type) {
+		case UIP_ND6_OPT_NONCE:
+		case UIP_ND6_OPT_AUTH:
+			/* Already verified above */
+			break;
 	case UIP_ND6_OPT_SLLAO:
 		PRINTF("Processing SLLAO option in NS\n");
 		nd6_opt_llao = &uip_buf[uip_l2_l3_icmp_hdr_len + nd6_opt_offset];
@@ -420,6 +481,10 @@ ns_input(void)
 	* logic described in RfC 6775 section 6.5. for handling the ARO.      *
 	***********************************************************************/
     case UIP_ND6_OPT_ARO:
+    	if(aro_offset != 0 && nd6_opt_offset != aro_offset) {
+    		/* Not the ARO that was authenticated above */
+    		break;
+    	}
     	PRINTF("Processing ARO option in NS\n");
     	addr = uip_ds6_addr_lookup(&UIP_ND6_NS_BUF->tgtipaddr);
     	if(addr != NULL){  //only handle ARO in the NS message which send to me
@@ -439,6 +504,10 @@ ns_input(void)
 			PRINTF("ND ARO option is supported in received NS\n");
 		}
 #endif /* UIP_CONF_IPV6_CHECKS */
+		if(nd6_opt_aro == NULL) {
+			break;
+		}
+		aro_lifetime = nd6_opt_aro->lifetime;
 
 //	 /*******************************************************
 //	  * Optimization process logic of the register list     *
@@ -446,6 +515,7 @@ ns_input(void)
 		  reg = uip_ds6_reg_lookup(UIP_IP_BUF->srcipaddr, NULL);
 		  if(reg == NULL || !memcmp(&reg->mac, &eui64, UIP_802154_LONGADDR_LEN)) {
 			  PRINTF("DAD passed, update registration entries.\n");
+			  ND6_STATS_MARK();
 			  if (nd6_opt_aro->lifetime > 0) {
 				  uip_ds6_reg_update(eui64,
 						  UIP_IP_BUF->srcipaddr,
@@ -453,8 +523,16 @@ ns_input(void)
 						  REG_REGISTERED,
 						  uip_ntohs(nd6_opt_aro->lifetime),
 						  counter);
+				  ND6_STATS_LAP(ND6_STATS_NS_REG);
 //				  uip_ds6_print_reg_list();
-				  uip_ds6_print_reg_list_keyinfo();
+#if UIP_ND6_PAIRWISE_LLSEC
+				  if(nd6_opt_auth != NULL) {
+					  /* Accept the 6LN's pairwise key now, send with it once the
+					   * 6LN proved it has processed our NA */
+					  pairwisesec_set_key(packetbuf_addr(PACKETBUF_ADDR_SENDER),
+							  reg_query->key, PAIRWISESEC_KEY_PENDING);
+				  }
+#endif /* UIP_ND6_PAIRWISE_LLSEC */
 			  }else{
 				  uip_ds6_reg_update(eui64,
 						  UIP_IP_BUF->srcipaddr,
@@ -462,13 +540,17 @@ ns_input(void)
 						  REG_TO_BE_UNREGISTERED,
 						  0,
 						  counter);
-				  uip_ds6_print_reg_list_keyinfo();
+				  ND6_STATS_LAP(ND6_STATS_NS_REG);
+#if UIP_ND6_PAIRWISE_LLSEC
+				  pairwisesec_remove_key(packetbuf_addr(PACKETBUF_ADDR_SENDER));
+#endif /* UIP_ND6_PAIRWISE_LLSEC */
 			  }
 			  reg_status = UIP_ND6_ARO_SUCCESS;
 			  goto create_lowpan_na;
 		 }
 		 else if(reg != NULL && memcmp(&reg->mac, &eui64, UIP_802154_LONGADDR_LEN)){
 			 reg_status = UIP_ND6_ARO_DUPLICATE_ADDRESS;
+			 UIP_STAT(++uip_stat.nd6.duperr);
 			 goto create_lowpan_na;
 		 }
     	}
@@ -484,6 +566,11 @@ ns_input(void)
     nd6_opt_offset += (UIP_ND6_OPT_HDR_BUF->len << 3);
   }
 
+	/* No usable ARO: a plain NS, only answered for our own addresses */
+	if(uip_ds6_addr_lookup(&UIP_ND6_NS_BUF->tgtipaddr) == NULL) {
+		goto discard;
+	}
+
 /**********************************************************
  * Create NA message as describe in RFC 6775              *
  **********************************************************/
@@ -524,7 +611,7 @@ create_lowpan_na:
     UIP_IP_BUF->len[0] = 0;       /* length will not be more than 255 */
 #if UIP_CONF_ROUTER
     /**in case of ARO included */
-    if(flags == (UIP_ND6_NA_FLAG_SOLICITED | UIP_ND6_NA_FLAG_OVERRIDE | UIP_ND6_NA_FLAG_ROUTER)){
+    if(nd6_opt_aro != NULL){
     	UIP_IP_BUF->len[1] = UIP_ICMPH_LEN + UIP_ND6_NA_LEN + UIP_ND6_OPT_LLAO_LEN + (UIP_ND6_OPT_ARO_LEN<<3);
     	PRINTF("ARO supported in NA message \n");
     }
@@ -556,19 +643,11 @@ create_lowpan_na:
 	create_llao(&uip_buf[uip_l2_l3_icmp_hdr_len + UIP_ND6_NA_LEN], UIP_ND6_OPT_TLLAO);
 
 #if UIP_CONF_ROUTER
-	/**in case of ARO included */
-	if(reg_status == UIP_ND6_ARO_DUPLICATE_ADDRESS){
+	/* In case of ARO included. The TLLAO may already overwrite the options
+	 * of the NS, so the ARO is rebuilt from the copies made while parsing */
+	if(nd6_opt_aro != NULL){
 		create_aro(&uip_buf[uip_l2_l3_icmp_hdr_len + UIP_ND6_NA_LEN + UIP_ND6_OPT_LLAO_LEN],
-				uip_htons(nd6_opt_aro->lifetime), UIP_ND6_ARO_DUPLICATE_ADDRESS, &nd6_opt_aro->eui64);
-	}
-	else if(reg_status == UIP_ND6_ARO_SUCCESS){
-		create_aro(&uip_buf[uip_l2_l3_icmp_hdr_len + UIP_ND6_NA_LEN + UIP_ND6_OPT_LLAO_LEN],
-				uip_htons(nd6_opt_aro->lifetime), UIP_ND6_ARO_SUCCESS, &nd6_opt_aro->eui64);
-	}
-	else{
-		/** \todo  check for full cache */
-		create_aro(&uip_buf[uip_l2_l3_icmp_hdr_len + UIP_ND6_NA_LEN + UIP_ND6_OPT_LLAO_LEN],
-				uip_htons(nd6_opt_aro->lifetime), UIP_ND6_ARO_NCE_FULL, &nd6_opt_aro->eui64);
+				uip_htons(aro_lifetime), reg_status, &eui64);
 	}
 #endif
 
@@ -577,7 +656,7 @@ create_lowpan_na:
 
 #if UIP_CONF_ROUTER
 /**in case of ARO included */
-      if(flags==(UIP_ND6_NA_FLAG_SOLICITED | UIP_ND6_NA_FLAG_OVERRIDE |UIP_ND6_NA_FLAG_ROUTER)){
+      if(nd6_opt_aro != NULL){
         uip_len =
          UIP_IPH_LEN + UIP_ICMPH_LEN + UIP_ND6_NA_LEN + UIP_ND6_OPT_LLAO_LEN + (UIP_ND6_OPT_ARO_LEN <<3);
        PRINTF("ARO supported in NA message \n");
@@ -592,6 +671,8 @@ create_lowpan_na:
         UIP_IPH_LEN + UIP_ICMPH_LEN + UIP_ND6_NA_LEN + UIP_ND6_OPT_LLAO_LEN;
 #endif
 	UIP_STAT(++uip_stat.nd6.sent);
+	ND6_STATS_END(ND6_STATS_NS_TOTAL);
+	ND6_TRACE(ND6_TRACE_NA_OUT, reg_status, 0, ND6_TRACE_IID(&UIP_IP_BUF->destipaddr), 8);
 	PRINTF("Sending NA to ");
 	PRINT6ADDR(&UIP_IP_BUF->destipaddr);
 	PRINTF(" from ");
@@ -684,6 +765,10 @@ uip_nd6_lowpan_ns_output(uip_ipaddr_t * src, uip_ipaddr_t * dest, uip_ipaddr_t *
   UIP_ICMP_BUF->icmpchksum = ~uip_icmp6chksum();
 
   UIP_STAT(++uip_stat.nd6.sent);
+  if(aro) {
+    ND6_STATS_RTT_START(ND6_STATS_NS_NA);
+  }
+  ND6_TRACE(ND6_TRACE_NS_OUT, aro, 0, ND6_TRACE_IID(&UIP_IP_BUF->destipaddr), 8);
   PRINTF("Sending NS to ");
   PRINT6ADDR(&UIP_IP_BUF->destipaddr);
   PRINTF(" from ");
@@ -845,6 +930,12 @@ na_input(void)
 		 * process logic of ARO option in the NA message *
 		 *************************************************/
 		if(nd6_opt_aro != NULL) {
+			ND6_TRACE(ND6_TRACE_NA_IN, nd6_opt_aro->status, 0,
+					ND6_TRACE_IID(&UIP_IP_BUF->srcipaddr), 8);
+			ND6_STATS_RTT_END(ND6_STATS_NS_NA);
+			if(nd6_opt_aro->status == UIP_ND6_ARO_DUPLICATE_ADDRESS) {
+				UIP_STAT(++uip_stat.nd6.duperr);
+			}
 #if UIP_CONF_ROUTER
 //#if UIP_CONF_IPV6_LOWPAN_ND
 			reg = uip_ds6_if.registration_in_progress;
@@ -986,18 +1077,10 @@ na_input(void)
 	} // if(addr != NULL)
 
 #if UIP_CONF_IPV6_QUEUE_PKT
-	/* The nbr is now reachable, check if we had buffered a pkt for it */
-	/*if(nbr->queue_buf_len != 0) {
-		uip_len = nbr->queue_buf_len;
-		memcpy(UIP_IP_BUF, nbr->queue_buf, uip_len);
-		nbr->queue_buf_len = 0;
-		return;
-	}*/
-	if(uip_packetqueue_buflen(&nbr->packethandle) != 0) {
-		uip_len = uip_packetqueue_buflen(&nbr->packethandle);
-		memcpy(UIP_IP_BUF, uip_packetqueue_buf(&nbr->packethandle), uip_len);
-		uip_packetqueue_free(&nbr->packethandle);
-		return;
+	/* The nbr is now reachable, send the pkts we buffered for it, oldest
+	 * first */
+	if(nbr != NULL && uip_packetqueue_count(&nbr->packethandle) != 0) {
+		tcpip_ipv6_output_queued(nbr);
 	}
 #endif /*UIP_CONF_IPV6_QUEUE_PKT */
 
@@ -1014,6 +1097,7 @@ discard:
 static void
 rs_input(void)
 {
+  ND6_TRACE(ND6_TRACE_RS_IN, 0, 0, ND6_TRACE_IID(&UIP_IP_BUF->srcipaddr), 8);
   PRINTF("Received RS from ");
   PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
   PRINTF(" to ");
@@ -1225,6 +1309,7 @@ uip_nd6_lowpan_ra_output(uip_ipaddr_t * dest)
   UIP_ICMP_BUF->icmpchksum = ~uip_icmp6chksum();
 
   UIP_STAT(++uip_stat.nd6.sent);
+  ND6_TRACE(ND6_TRACE_RA_OUT, 0, 0, ND6_TRACE_IID(&UIP_IP_BUF->destipaddr), 8);
   PRINTF("Sending RA to ");
   PRINT6ADDR(&UIP_IP_BUF->destipaddr);
   PRINTF(" from ");
@@ -1272,6 +1357,8 @@ uip_nd6_lowpan_rs_output(uip_ipaddr_t* rtr_ipaddr)
   UIP_ICMP_BUF->icmpchksum = ~uip_icmp6chksum();
 
   UIP_STAT(++uip_stat.nd6.sent);
+  ND6_STATS_RTT_START(ND6_STATS_RS_RA);
+  ND6_TRACE(ND6_TRACE_RS_OUT, 0, 0, ND6_TRACE_IID(&UIP_IP_BUF->destipaddr), 8);
   PRINTF("Sending RS to ");
   PRINT6ADDR(&UIP_IP_BUF->destipaddr);
   PRINTF(" from ");
@@ -1294,6 +1381,8 @@ ra_input(void)
 {
   uip_lladdr_t lladdr_aligned;
 
+  ND6_STATS_RTT_END(ND6_STATS_RS_RA);
+  ND6_TRACE(ND6_TRACE_RA_IN, 0, 0, ND6_TRACE_IID(&UIP_IP_BUF->srcipaddr), 8);
   PRINTF("Received RA from ");
   PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
   PRINTF(" to ");
@@ -1534,10 +1623,21 @@ ra_input(void)
 //			&UIP_IP_BUF->srcipaddr,1, (uint16_t) uip_ntohs(UIP_ND6_RA_BUF->router_lifetime));
 //      PRINT6ADDR(&ipaddr);
 
+#if UIP_CONF_IPV6_QUEUE_PKT
+      /* The router, uip_buf is reused for the NS */
+      nbr = uip_ds6_nbr_lookup(&UIP_IP_BUF->srcipaddr);
+#endif /*UIP_CONF_IPV6_QUEUE_PKT */
       /* The generated address (ipaddr) is as source address of NS message */
 	  uip_nd6_lowpan_ns_output(&ipaddr, &UIP_IP_BUF->srcipaddr,
 			  &UIP_IP_BUF->srcipaddr,1, (uint16_t) uip_ntohs(UIP_ND6_RA_BUF->router_lifetime));
       tcpip_ipv6_output();
+#if UIP_CONF_IPV6_QUEUE_PKT
+      /* The NS is out, send what was queued for the router meanwhile;
+       * packets from the address being registered wait for the NA */
+      if(nbr != NULL && uip_packetqueue_count(&nbr->packethandle) != 0) {
+        tcpip_ipv6_output_queued(nbr);
+      }
+#endif /*UIP_CONF_IPV6_QUEUE_PKT */
       return;
 
     } else {
@@ -1552,18 +1652,9 @@ ra_input(void)
 
 #if UIP_CONF_IPV6_QUEUE_PKT
   /* If the nbr just became reachable (e.g. it was in NBR_INCOMPLETE state
-   * and we got a SLLAO), check if we had buffered a pkt for it */
-  /*  if((nbr != NULL) && (nbr->queue_buf_len != 0)) {
-    uip_len = nbr->queue_buf_len;
-    memcpy(UIP_IP_BUF, nbr->queue_buf, uip_len);
-    nbr->queue_buf_len = 0;
-    return;
-    }*/
-  if(nbr != NULL && uip_packetqueue_buflen(&nbr->packethandle) != 0) {
-    uip_len = uip_packetqueue_buflen(&nbr->packethandle);
-    memcpy(UIP_IP_BUF, uip_packetqueue_buf(&nbr->packethandle), uip_len);
-    uip_packetqueue_free(&nbr->packethandle);
-    return;
+   * and we got a SLLAO), send the pkts we buffered for it, oldest first */
+  if(nbr != NULL && uip_packetqueue_count(&nbr->packethandle) != 0) {
+    tcpip_ipv6_output_queued(nbr);
   }
 
 #endif /*UIP_CONF_IPV6_QUEUE_PKT */
@@ -1595,6 +1686,7 @@ UIP_ICMP6_HANDLER(ra_input_handler, ICMP6_RA, UIP_ICMP6_HANDLER_CODE_ANY,
 void
 uip_nd6_init()
 {
+  nd6_trace_init();
 
 #if UIP_ND6_SEND_NA
   /* Only handle NSs if we are prepared to send out NAs */
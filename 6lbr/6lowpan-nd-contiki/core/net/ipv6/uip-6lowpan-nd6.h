@@ -229,6 +229,13 @@
 #else
 #define UIP_ND6_NS_NONCE               UIP_CONF_ND6_NS_NONCE
 #endif
+
+/* Derive pairwise link keys (pairwisesec) from authenticated registrations */
+#ifndef UIP_CONF_ND6_PAIRWISE_LLSEC
+#define UIP_ND6_PAIRWISE_LLSEC			0
+#else
+#define UIP_ND6_PAIRWISE_LLSEC         UIP_CONF_ND6_PAIRWISE_LLSEC
+#endif
 /** @} */
 
 /** \name ND6 option types */
@@ -282,7 +289,7 @@
 #define UIP_ND6_OPT_ABRO_LEN	       3
 //add
 #define UIP_ND6_OPT_NONCE_LEN	       1
-#define UIP_ND6_OPT_AUTH_LEN	       3
+#define UIP_ND6_OPT_AUTH_LEN	       5
 
 /* Length of TLLAO and SLLAO options, it is L2 dependant */
 #if UIP_CONF_LL_802154
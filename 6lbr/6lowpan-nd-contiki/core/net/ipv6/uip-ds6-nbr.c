@@ -129,7 +129,7 @@ uip_ds6_nbr_rm(uip_ds6_nbr_t *nbr)
 {
   if(nbr != NULL) {
 #if UIP_CONF_IPV6_QUEUE_PKT
-    uip_packetqueue_free(&nbr->packethandle);
+    uip_packetqueue_flush(&nbr->packethandle);
 #endif /* UIP_CONF_IPV6_QUEUE_PKT */
     NEIGHBOR_STATE_CHANGED(nbr);
     return nbr_table_remove(ds6_neighbors, nbr);
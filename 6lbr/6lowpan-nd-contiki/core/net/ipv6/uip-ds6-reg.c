@@ -51,9 +51,14 @@
 #include "net/ipv6/multicast/uip-mcast6.h"
 #include "net/ip/uip-packetqueue.h"
 #include "net/ipv6/uip-ds6-reg.h"
+#include "net/ipv6/nd6-trace.h"
 
 //#define DEBUG DEBUG_NONE
-#define DEBUG DEBUG_PRINT
+#ifdef UIP_ND6_CONF_DEBUG
+#define DEBUG UIP_ND6_CONF_DEBUG
+#else /* UIP_ND6_CONF_DEBUG */
+#define DEBUG DEBUG_NONE
+#endif /* UIP_ND6_CONF_DEBUG */
 #define PRINTADDR(addr) PRINTF("%02x:%02x:%02x:%02x:%02x:%02x:%02x:%02x ", ((uint8_t *)addr)[0], ((uint8_t *)addr)[1], ((uint8_t *)addr)[2], ((uint8_t *)addr)[3], ((uint8_t *)addr)[4], ((uint8_t *)addr)[5], ((uint8_t *)addr)[6], ((uint8_t *)addr)[7])
 #include "net/ip/uip-debug.h"
 uip_ds6_reg_t uip_ds6_reg_list[UIP_DS6_REG_LIST_SIZE];      /**< Registrations list */
@@ -147,7 +152,10 @@ uip_ds6_reg_add(uip_ip6addr_t addr, uip_ds6_defrt_t* defrt, uint8_t state, uint1
 		} else {
 			stimer_set(&candidate->reg_lifetime, lifetime);
 		}
-		defrt->registrations++;
+		if(defrt != NULL) {
+			defrt->registrations++;
+		}
+		ND6_TRACE(ND6_TRACE_REG, state, lifetime, &candidate->mac, 8);
 
 		memcpy(&candidate->counter, counter, 6);
 		memcpy(&candidate->key, key, 16);
@@ -165,7 +173,11 @@ uip_ds6_reg_add(uip_ip6addr_t addr, uip_ds6_defrt_t* defrt, uint8_t state, uint1
 void
 uip_ds6_reg_rm(uip_ds6_reg_t* reg){
 
-        reg->defrt->registrations--;
+        ND6_TRACE(ND6_TRACE_REG_RM, 0, 0, &reg->mac, 8);
+
+        if(reg->defrt != NULL) {
+                reg->defrt->registrations--;
+        }
         reg->isused = 0;
 
 }
@@ -412,7 +424,10 @@ uip_ds6_reg_update(uip_802154_longaddr mac, uip_ip6addr_t addr, uip_ds6_defrt_t*
 	} else {
 		stimer_set(&candidate->reg_lifetime, lifetime);
 	}
-	defrt->registrations++;
+	if(defrt != NULL) {
+		defrt->registrations++;
+	}
+	ND6_TRACE(ND6_TRACE_REG, state, lifetime, &mac, 8);
 
 	memcpy(&candidate->counter, counter, 6);
 //	memcpy(&candidate->key, key, 16);
@@ -59,7 +59,11 @@
 #include "dev/ds2411/ds2411.h"
 
 //#define DEBUG DEBUG_NONE
-#define DEBUG DEBUG_PRINT
+#ifdef UIP_ND6_CONF_DEBUG
+#define DEBUG UIP_ND6_CONF_DEBUG
+#else /* UIP_ND6_CONF_DEBUG */
+#define DEBUG DEBUG_NONE
+#endif /* UIP_ND6_CONF_DEBUG */
 //#define PRINTMACADDR(addr) PRINTF("%02x:%02x:%02x:%02x:%02x:%02x:%02x:%02x ", ((uint8_t *)addr)[0], ((uint8_t *)addr)[1], ((uint8_t *)addr)[2], ((uint8_t *)addr)[3], ((uint8_t *)addr)[4], ((uint8_t *)addr)[5], ((uint8_t *)addr)[6], ((uint8_t *)addr)[7])
 
 #include "net/ip/uip-debug.h"
@@ -174,6 +178,31 @@ uip_ds6_init(void)
   }
 #endif
 
+#ifdef AUTH_SIM_NODE_NUM
+  /* Simulated 6LNs sharing AUTH_SIM_KEY; Cooja derives the DS2411 ID
+   * of sky mote n as 00:12:74:n:00:n:n:n, and native nodes above 255
+   * also carry the high byte of n (see set_serial_id() there) */
+  uint8_t auth_sim_key[16] = AUTH_SIM_KEY;
+  uip_ds6_reg_t *sim_reg;
+  for(i=0;i<AUTH_SIM_NODE_NUM;i++){
+	  uint16_t id = AUTH_SIM_FIRST_ID + i;
+	  uint8_t lo = id & 0xff;
+	  uint8_t hi = id >> 8;
+	  uint8_t sim_mac[8] = {0x00, 0x12, 0x74, lo, hi, lo, lo ^ hi, lo};
+	  memcpy(&mac64, sim_mac, sizeof(uip_802154_longaddr));
+	  sim_reg = uip_ds6_reg_lookup_mac(mac64);
+	  if(sim_reg != NULL) {
+		  /* Also in AUTH_MAC_LIST, but it runs the 6LN firmware here */
+		  memcpy(sim_reg->key, auth_sim_key, sizeof(sim_reg->key));
+		  continue;
+	  }
+	  memset(&ipaddr, 0, sizeof(ipaddr));
+	  uip_ds6_reg_add(ipaddr, NULL, REG_TO_BE_UNREGISTERED, 0, mac64,
+						counter, auth_sim_key);
+  }
+  PRINTF("# %u simulated nodes authorized\n", AUTH_SIM_NODE_NUM);
+#endif
+
 //#ifdef AUTH_KEY_LIST
 //  uint8_t auth_key_list[2][16] = AUTH_KEY_LIST;
 //  PRINTF("#KEY list of authorized node\n");
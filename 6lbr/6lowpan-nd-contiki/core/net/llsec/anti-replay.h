@@ -47,9 +47,33 @@
 
 #include "contiki.h"
 
+/*
+ * Number of frame counters below the highest one seen that may still
+ * arrive late, e.g., after being reordered by CSMA retransmissions or
+ * TSCH queues. 0 restores the strict "greater than last" check.
+ */
+#ifdef ANTI_REPLAY_CONF_WINDOW
+#define ANTI_REPLAY_WINDOW ANTI_REPLAY_CONF_WINDOW
+#else /* ANTI_REPLAY_CONF_WINDOW */
+#define ANTI_REPLAY_WINDOW 32
+#endif /* ANTI_REPLAY_CONF_WINDOW */
+
+#if ANTI_REPLAY_WINDOW == 64
+typedef uint64_t anti_replay_window_t;
+#elif ANTI_REPLAY_WINDOW == 32
+typedef uint32_t anti_replay_window_t;
+#elif ANTI_REPLAY_WINDOW
+#error "ANTI_REPLAY_CONF_WINDOW must be 0, 32, or 64"
+#endif
+
 struct anti_replay_info {
   uint32_t last_broadcast_counter;
   uint32_t last_unicast_counter;
+#if ANTI_REPLAY_WINDOW
+  /* bit i is set <-> last counter - i was received */
+  anti_replay_window_t broadcast_window;
+  anti_replay_window_t unicast_window;
+#endif /* ANTI_REPLAY_WINDOW */
 };
 
 /**
@@ -71,6 +95,9 @@ void anti_replay_init_info(struct anti_replay_info *info);
 /**
  * \brief               Checks if received frame was replayed
  * \param info          Anti-replay information about the sender
+ *
+ *                      Frames up to ANTI_REPLAY_WINDOW - 1 counters older
+ *                      than the newest one are accepted once each.
  * \retval 0            <-> received frame was not replayed
  */
 int anti_replay_was_replayed(struct anti_replay_info *info);
@@ -94,6 +94,7 @@ extern const struct framer DECORATED_FRAMER;
 
 /* network-wide CCM* key */
 static uint8_t key[16] = NONCORESEC_KEY;
+static struct aes_128_context key_context;
 NBR_TABLE(struct anti_replay_info, anti_replay_table);
 
 /*---------------------------------------------------------------------------*/
@@ -111,6 +112,8 @@ aead(uint8_t hdrlen, int forward)
   uint8_t *mic;
   
   ccm_star_packetbuf_set_nonce(nonce, forward);
+  /* Other users of AES_128 may have changed the current key */
+  ccm_star_set_context(&key_context);
   totlen = packetbuf_totlen();
   a = packetbuf_hdrptr();
 #if WITH_ENCRYPTION
@@ -253,7 +256,7 @@ length(void)
 static void
 init(void)
 {
-  CCM_STAR.set_key(key);
+  aes_128_init_context(&key_context, key);
   nbr_table_register(anti_replay_table, NULL);
 }
 /*---------------------------------------------------------------------------*/
@@ -0,0 +1,438 @@
+/*
+ * Copyright (c) 2014, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         802.15.4 security implementation, which uses pairwise keys
+ *         derived from 6LoWPAN-ND registration keys
+ */
+
+/**
+ * \addtogroup pairwisesec
+ * @{
+ */
+
+#include "net/llsec/pairwisesec/pairwisesec.h"
+#include "net/llsec/anti-replay.h"
+#include "net/llsec/llsec802154.h"
+#include "net/llsec/ccm-star-packetbuf.h"
+#include "net/mac/frame802154.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/nbr-table.h"
+#include "net/linkaddr.h"
+#include "lib/aes-128.h"
+#include "lib/ccm-star.h"
+#include <string.h>
+
+#ifdef PAIRWISESEC_CONF_DECORATED_FRAMER
+#define DECORATED_FRAMER PAIRWISESEC_CONF_DECORATED_FRAMER
+#else /* PAIRWISESEC_CONF_DECORATED_FRAMER */
+#define DECORATED_FRAMER framer_802154
+#endif /* PAIRWISESEC_CONF_DECORATED_FRAMER */
+
+extern const struct framer DECORATED_FRAMER;
+
+#ifdef PAIRWISESEC_CONF_SEC_LVL
+#define SEC_LVL         PAIRWISESEC_CONF_SEC_LVL
+#else /* PAIRWISESEC_CONF_SEC_LVL */
+#define SEC_LVL         2
+#endif /* PAIRWISESEC_CONF_SEC_LVL */
+
+#define WITH_ENCRYPTION (SEC_LVL & (1 << 2))
+#define MIC_LEN         LLSEC802154_MIC_LEN(SEC_LVL)
+
+#ifdef PAIRWISESEC_CONF_NETWORK_KEY
+#define PAIRWISESEC_NETWORK_KEY PAIRWISESEC_CONF_NETWORK_KEY
+#else /* PAIRWISESEC_CONF_NETWORK_KEY */
+#define PAIRWISESEC_NETWORK_KEY { 0x00 , 0x01 , 0x02 , 0x03 , \
+                                  0x04 , 0x05 , 0x06 , 0x07 , \
+                                  0x08 , 0x09 , 0x0A , 0x0B , \
+                                  0x0C , 0x0D , 0x0E , 0x0F }
+#endif /* PAIRWISESEC_CONF_NETWORK_KEY */
+
+/* Key indices carried in the auxiliary security header */
+#define NETWORK_KEY_INDEX  1
+#define PAIRWISE_KEY_INDEX 2
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else /* DEBUG */
+#define PRINTF(...)
+#endif /* DEBUG */
+
+#if LLSEC802154_USES_AUX_HEADER && SEC_LVL && LLSEC802154_USES_FRAME_COUNTER \
+    && LLSEC802154_USES_EXPLICIT_KEYS
+
+#if LINKADDR_SIZE > 8
+#error "pairwisesec: link-layer addresses must not exceed 8 bytes"
+#endif
+
+struct pairwisesec_nbr {
+  struct anti_replay_info anti_replay;
+  /* expanded once when the key is derived, reused for every frame */
+  struct aes_128_context pairwise_context;
+  uint8_t key_state;
+};
+
+/* network-wide CCM* key */
+static uint8_t network_key[16] = PAIRWISESEC_NETWORK_KEY;
+static struct aes_128_context network_context;
+NBR_TABLE(struct pairwisesec_nbr, pairwisesec_table);
+
+/*---------------------------------------------------------------------------*/
+/*
+ * K_pair = AES-128(K_reg, lower address || higher address). Ordering the
+ * addresses lets both ends of the link arrive at the same key. The
+ * addresses are public, so K_pair is no more private than K_reg: 6LNs
+ * that share a registration key share all of their link keys too.
+ */
+static void
+derive_key(uint8_t *pairwise_key, const linkaddr_t *peer,
+    const uint8_t *reg_key)
+{
+  const linkaddr_t *lower;
+  const linkaddr_t *higher;
+
+  if(memcmp(peer, &linkaddr_node_addr, LINKADDR_SIZE) < 0) {
+    lower = peer;
+    higher = &linkaddr_node_addr;
+  } else {
+    lower = &linkaddr_node_addr;
+    higher = peer;
+  }
+
+  memset(pairwise_key, 0, 16);
+  memcpy(pairwise_key, lower, LINKADDR_SIZE);
+  memcpy(pairwise_key + 8, higher, LINKADDR_SIZE);
+  AES_128.set_key(reg_key);
+  AES_128.encrypt(pairwise_key);
+}
+/*---------------------------------------------------------------------------*/
+int
+pairwisesec_set_key(const linkaddr_t *peer, const uint8_t *reg_key,
+    uint8_t state)
+{
+  struct pairwisesec_nbr *nbr;
+  uint8_t pairwise_key[16];
+
+  nbr = nbr_table_get_from_lladdr(pairwisesec_table, peer);
+  if(!nbr) {
+    PRINTF("pairwisesec: no anti-replay state for peer\n");
+    return 0;
+  }
+
+  derive_key(pairwise_key, peer, reg_key);
+  if(nbr->key_state != PAIRWISESEC_KEY_NONE
+      && !memcmp(nbr->pairwise_context.key, pairwise_key, 16)) {
+    /* a re-registration must not demote a key already in use */
+    if(state > nbr->key_state) {
+      nbr->key_state = state;
+    }
+    return 1;
+  }
+
+  aes_128_init_context(&nbr->pairwise_context, pairwise_key);
+  nbr->key_state = state;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+pairwisesec_remove_key(const linkaddr_t *peer)
+{
+  struct pairwisesec_nbr *nbr;
+
+  nbr = nbr_table_get_from_lladdr(pairwisesec_table, peer);
+  if(nbr) {
+    memset(&nbr->pairwise_context, 0, sizeof(nbr->pairwise_context));
+    nbr->key_state = PAIRWISESEC_KEY_NONE;
+  }
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+pairwisesec_key_state(const linkaddr_t *peer)
+{
+  struct pairwisesec_nbr *nbr;
+
+  nbr = nbr_table_get_from_lladdr(pairwisesec_table, peer);
+  return nbr ? nbr->key_state : PAIRWISESEC_KEY_NONE;
+}
+/*---------------------------------------------------------------------------*/
+static int
+aead(uint8_t hdrlen, int forward, const struct aes_128_context *context)
+{
+  uint8_t totlen;
+  uint8_t nonce[CCM_STAR_NONCE_LENGTH];
+  uint8_t *m;
+  uint8_t m_len;
+  uint8_t *a;
+  uint8_t a_len;
+  uint8_t *result;
+  uint8_t generated_mic[MIC_LEN];
+  uint8_t *mic;
+
+  ccm_star_packetbuf_set_nonce(nonce, forward);
+  /* Other users of AES_128 may have changed the current key */
+  ccm_star_set_context(context);
+  totlen = packetbuf_totlen();
+  a = packetbuf_hdrptr();
+#if WITH_ENCRYPTION
+  a_len = hdrlen;
+  m = a + a_len;
+  m_len = totlen - hdrlen;
+#else /* WITH_ENCRYPTION */
+  a_len = totlen;
+  m = NULL;
+  m_len = 0;
+#endif /* WITH_ENCRYPTION */
+
+  mic = a + totlen;
+  result = forward ? mic : generated_mic;
+
+  CCM_STAR.aead(nonce,
+      m, m_len,
+      a, a_len,
+      result, MIC_LEN,
+      forward);
+
+  if(forward) {
+    packetbuf_set_datalen(packetbuf_datalen() + MIC_LEN);
+    return 1;
+  } else {
+    return (memcmp(generated_mic, mic, MIC_LEN) == 0);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Selects the key for an outgoing frame. ND and RPL control frames keep
+ * using the network-wide key so that a neighbor that lost its pairwise
+ * keys, e.g., after a reboot, can still register again.
+ */
+static uint8_t
+select_key_index(void)
+{
+  if(packetbuf_holds_broadcast()
+      || packetbuf_attr(PACKETBUF_ATTR_PRIORITY) == PACKETBUF_ATTR_PRIORITY_CONTROL) {
+    return NETWORK_KEY_INDEX;
+  }
+  if(pairwisesec_key_state(packetbuf_addr(PACKETBUF_ADDR_RECEIVER))
+      == PAIRWISESEC_KEY_ACTIVE) {
+    return PAIRWISE_KEY_INDEX;
+  }
+  return NETWORK_KEY_INDEX;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_security_header(void)
+{
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_TYPE, FRAME802154_DATAFRAME);
+  packetbuf_set_attr(PACKETBUF_ATTR_SECURITY_LEVEL, SEC_LVL);
+  packetbuf_set_attr(PACKETBUF_ATTR_KEY_ID_MODE, FRAME802154_1_BYTE_KEY_ID_MODE);
+  packetbuf_set_attr(PACKETBUF_ATTR_KEY_INDEX, select_key_index());
+}
+/*---------------------------------------------------------------------------*/
+static void
+send(mac_callback_t sent, void *ptr)
+{
+  add_security_header();
+  anti_replay_set_counter();
+  NETSTACK_MAC.send(sent, ptr);
+}
+/*---------------------------------------------------------------------------*/
+static int
+create(void)
+{
+  int result;
+  const struct aes_128_context *context;
+  struct pairwisesec_nbr *nbr;
+
+  context = &network_context;
+  if(packetbuf_attr(PACKETBUF_ATTR_KEY_INDEX) == PAIRWISE_KEY_INDEX) {
+    nbr = nbr_table_get_from_lladdr(pairwisesec_table,
+        packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+    if(!nbr || nbr->key_state == PAIRWISESEC_KEY_NONE) {
+      /* the key was removed while the frame was queued */
+      PRINTF("pairwisesec: pairwise key vanished\n");
+      return FRAMER_FAILED;
+    }
+    context = &nbr->pairwise_context;
+  }
+
+  result = DECORATED_FRAMER.create();
+  if(result == FRAMER_FAILED) {
+    return result;
+  }
+
+  aead(result, 1, context);
+
+  return result;
+}
+/*---------------------------------------------------------------------------*/
+static int
+parse(void)
+{
+  int result;
+  const linkaddr_t *sender;
+  struct pairwisesec_nbr *nbr;
+  uint8_t key_index;
+  const struct aes_128_context *context;
+
+  result = DECORATED_FRAMER.parse();
+  if(result == FRAMER_FAILED) {
+    return result;
+  }
+
+  if(packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL) != SEC_LVL) {
+    PRINTF("pairwisesec: received frame with wrong security level\n");
+    return FRAMER_FAILED;
+  }
+  if(packetbuf_attr(PACKETBUF_ATTR_KEY_ID_MODE) != FRAME802154_1_BYTE_KEY_ID_MODE) {
+    PRINTF("pairwisesec: received frame with wrong key id mode\n");
+    return FRAMER_FAILED;
+  }
+  sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+  if(linkaddr_cmp(sender, &linkaddr_node_addr)) {
+    PRINTF("pairwisesec: frame from ourselves\n");
+    return FRAMER_FAILED;
+  }
+
+  nbr = nbr_table_get_from_lladdr(pairwisesec_table, sender);
+  key_index = packetbuf_attr(PACKETBUF_ATTR_KEY_INDEX);
+  if(key_index == NETWORK_KEY_INDEX) {
+    context = &network_context;
+  } else if(key_index == PAIRWISE_KEY_INDEX
+      && !packetbuf_holds_broadcast()
+      && nbr && nbr->key_state != PAIRWISESEC_KEY_NONE) {
+    context = &nbr->pairwise_context;
+  } else {
+    PRINTF("pairwisesec: no key for index %u\n", key_index);
+    return FRAMER_FAILED;
+  }
+
+  packetbuf_set_datalen(packetbuf_datalen() - MIC_LEN);
+
+  if(!aead(result, 0, context)) {
+    PRINTF("pairwisesec: received unauthentic frame %lu\n",
+        anti_replay_get_counter());
+    return FRAMER_FAILED;
+  }
+
+  if(!nbr) {
+    nbr = nbr_table_add_lladdr(pairwisesec_table, sender, NBR_TABLE_REASON_LLSEC, NULL);
+    if(!nbr) {
+      PRINTF("pairwisesec: could not get nbr_table_item\n");
+      return FRAMER_FAILED;
+    }
+
+    /* Locked for the same reasons as in noncoresec */
+    if(!nbr_table_lock(pairwisesec_table, nbr)) {
+      nbr_table_remove(pairwisesec_table, nbr);
+      PRINTF("pairwisesec: could not lock\n");
+      return FRAMER_FAILED;
+    }
+
+    anti_replay_init_info(&nbr->anti_replay);
+    nbr->key_state = PAIRWISESEC_KEY_NONE;
+  } else {
+    if(anti_replay_was_replayed(&nbr->anti_replay)) {
+      PRINTF("pairwisesec: received replayed frame %lu\n",
+          anti_replay_get_counter());
+      return FRAMER_FAILED;
+    }
+    if(key_index == PAIRWISE_KEY_INDEX) {
+      /* the peer proved that it derived the same key */
+      nbr->key_state = PAIRWISESEC_KEY_ACTIVE;
+    }
+  }
+
+  return result;
+}
+/*---------------------------------------------------------------------------*/
+static void
+input(void)
+{
+  NETSTACK_NETWORK.input();
+}
+/*---------------------------------------------------------------------------*/
+static int
+length(void)
+{
+  add_security_header();
+  return DECORATED_FRAMER.length() + MIC_LEN;
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(void)
+{
+  aes_128_init_context(&network_context, network_key);
+  nbr_table_register(pairwisesec_table, NULL);
+}
+/*---------------------------------------------------------------------------*/
+const struct llsec_driver pairwisesec_driver = {
+  "pairwisesec",
+  init,
+  send,
+  input
+};
+/*---------------------------------------------------------------------------*/
+const struct framer pairwisesec_framer = {
+  length,
+  create,
+  parse
+};
+/*---------------------------------------------------------------------------*/
+#else /* LLSEC802154_USES_AUX_HEADER && SEC_LVL && LLSEC802154_USES_FRAME_COUNTER && LLSEC802154_USES_EXPLICIT_KEYS */
+
+/* Keep the ND hooks linkable when pairwisesec is not the LLSEC driver */
+int
+pairwisesec_set_key(const linkaddr_t *peer, const uint8_t *reg_key,
+    uint8_t state)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+pairwisesec_remove_key(const linkaddr_t *peer)
+{
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+pairwisesec_key_state(const linkaddr_t *peer)
+{
+  return PAIRWISESEC_KEY_NONE;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* LLSEC802154_USES_AUX_HEADER && SEC_LVL && LLSEC802154_USES_FRAME_COUNTER && LLSEC802154_USES_EXPLICIT_KEYS */
+
+/** @} */
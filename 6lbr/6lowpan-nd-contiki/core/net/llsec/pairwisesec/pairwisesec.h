@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2014, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         802.15.4 security implementation, which uses pairwise keys
+ *         derived from 6LoWPAN-ND registration keys
+ */
+
+/**
+ * \addtogroup llsec
+ * @{
+ */
+
+/**
+ * \defgroup pairwisesec LLSEC driver using pairwise registration keys
+ *
+ * Works like noncoresec, but unicast frames to a registered neighbor
+ * are protected with a link key derived from the 16-byte key shared
+ * during the authenticated 6LoWPAN-ND registration. Broadcast frames
+ * and frames to unregistered neighbors use the network-wide key.
+ *
+ * The link key is derived from the registration key and the two link
+ * addresses only. It is pairwise only if every 6LN has its own
+ * registration key. Nodes built with the same key can compute each
+ * other's link keys.
+ *
+ * @{
+ */
+
+#ifndef PAIRWISESEC_H_
+#define PAIRWISESEC_H_
+
+#include "net/llsec/llsec.h"
+#include "net/linkaddr.h"
+
+/** No pairwise key has been derived for the neighbor */
+#define PAIRWISESEC_KEY_NONE    0
+/** The pairwise key is accepted on reception only */
+#define PAIRWISESEC_KEY_PENDING 1
+/** The pairwise key is used for both reception and transmission */
+#define PAIRWISESEC_KEY_ACTIVE  2
+
+/**
+ * \brief          Derives the pairwise key shared with a neighbor
+ * \param peer     Link-layer address of the neighbor
+ * \param reg_key  16-byte key of the neighbor's ND registration
+ * \param state    PAIRWISESEC_KEY_PENDING or PAIRWISESEC_KEY_ACTIVE
+ * \retval 0       <-> the neighbor is not known to the LLSEC layer yet
+ *
+ *                 A pending key becomes active as soon as the neighbor
+ *                 sends a frame protected with it. The side that
+ *                 confirms a registration installs a pending key so
+ *                 that its confirmation still uses the network-wide key.
+ */
+int pairwisesec_set_key(const linkaddr_t *peer, const uint8_t *reg_key,
+    uint8_t state);
+
+/**
+ * \brief          Forgets the pairwise key shared with a neighbor
+ */
+void pairwisesec_remove_key(const linkaddr_t *peer);
+
+/**
+ * \brief          Returns the PAIRWISESEC_KEY_* state for a neighbor
+ */
+uint8_t pairwisesec_key_state(const linkaddr_t *peer);
+
+extern const struct llsec_driver pairwisesec_driver;
+extern const struct framer pairwisesec_framer;
+
+#endif /* PAIRWISESEC_H_ */
+
+/** @} */
+/** @} */
@@ -44,6 +44,22 @@
 #include "net/mac/mac.h"
 #include "dev/radio.h"
 
+#ifdef CSMA_CONF_STATS
+#define CSMA_STATS CSMA_CONF_STATS
+#else /* CSMA_CONF_STATS */
+#define CSMA_STATS 1
+#endif /* CSMA_CONF_STATS */
+
+#if CSMA_STATS
+struct csma_stats {
+  uint16_t queue_alloc_failed;  /* No neighbor queue could be allocated */
+  uint16_t packet_alloc_failed; /* No packet, metadata or queuebuf left */
+  uint16_t queue_full;          /* Neighbor queue or data share full */
+  uint16_t evicted;             /* Packets dropped with a reclaimed queue */
+};
+extern struct csma_stats csma_stats;
+#endif /* CSMA_STATS */
+
 extern const struct mac_driver csma_driver;
 
 const struct mac_driver *csma_init(const struct mac_driver *r);
@@ -53,6 +53,25 @@ typedef enum {
   PHASE_DEFERRED,
 } phase_status_t;
 
+#ifdef PHASE_CONF_STATS
+#define PHASE_STATS PHASE_CONF_STATS
+#else /* PHASE_CONF_STATS */
+#define PHASE_STATS 1
+#endif /* PHASE_CONF_STATS */
+
+#if PHASE_STATS
+struct phase_stats {
+  uint16_t hits;     /* Unicasts to a neighbor with known phase */
+  uint16_t misses;   /* Unicasts without known phase (full strobe) */
+  uint16_t evicted;  /* Phases replaced by the phase of another neighbor */
+  uint16_t dropped;  /* Phases dropped after repeated missing ACKs */
+  uint32_t strobe_time_saved; /* rtimer ticks of strobing saved by hits */
+};
+extern struct phase_stats phase_stats;
+
+void phase_stats_strobe(rtimer_clock_t cycle_time, rtimer_clock_t strobe_time);
+#endif /* PHASE_STATS */
+
 
 void phase_init(void);
 phase_status_t phase_wait(const linkaddr_t *neighbor,
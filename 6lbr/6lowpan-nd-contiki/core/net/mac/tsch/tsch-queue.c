@@ -77,6 +77,189 @@ LIST(neighbor_list);
 struct tsch_neighbor *n_broadcast;
 struct tsch_neighbor *n_eb;
 
+#if TSCH_QUEUE_HASH_SIZE
+#if TSCH_QUEUE_HASH_SIZE & (TSCH_QUEUE_HASH_SIZE - 1)
+#error TSCH_QUEUE_CONF_HASH_SIZE must be power of two
+#endif
+/* The neighbors, chained by the hash of their link-layer address */
+static struct tsch_neighbor *hash_buckets[TSCH_QUEUE_HASH_SIZE];
+#endif /* TSCH_QUEUE_HASH_SIZE */
+
+/* Unicast neighbors without Tx link, with packets and with an expired
+ * backoff: the candidates for tsch_queue_get_unicast_packet_for_any.
+ * The ready list and the backoff list are only modified from the slot
+ * operation, or while holding the TSCH lock. Entries that are no longer
+ * ready are removed lazily, when walking the list. */
+#define TSCH_QUEUE_IN_READY   0x01
+#define TSCH_QUEUE_IN_BACKOFF 0x02
+static struct tsch_neighbor *ready_head;
+static struct tsch_neighbor *ready_tail;
+/* Neighbors with non-zero backoff window */
+static struct tsch_neighbor *backoff_head;
+
+/* Neighbors that got a packet from process context, to be inserted into
+ * the ready list by the slot operation. Lock-free as the per-neighbor
+ * queues (put is atomic). When full, the whole neighbor list is scanned. */
+#define READY_RING_SIZE 8
+static struct tsch_neighbor *ready_ring_array[READY_RING_SIZE];
+static struct ringbufindex ready_ring;
+static volatile uint8_t ready_ring_overflow;
+
+/*---------------------------------------------------------------------------*/
+#if TSCH_QUEUE_HASH_SIZE
+static struct tsch_neighbor **
+hash_bucket(const linkaddr_t *addr)
+{
+  uint8_t h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = (h << 1 | h >> 7) ^ addr->u8[i];
+  }
+  return &hash_buckets[h & (TSCH_QUEUE_HASH_SIZE - 1)];
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_add(struct tsch_neighbor *n)
+{
+  struct tsch_neighbor **bucket = hash_bucket(&n->addr);
+  n->hash_next = *bucket;
+  *bucket = n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_remove(struct tsch_neighbor *n)
+{
+  struct tsch_neighbor **p;
+
+  for(p = hash_bucket(&n->addr); *p != NULL; p = &(*p)->hash_next) {
+    if(*p == n) {
+      *p = n->hash_next;
+      return;
+    }
+  }
+}
+#else /* TSCH_QUEUE_HASH_SIZE */
+#define hash_add(n)
+#define hash_remove(n)
+#endif /* TSCH_QUEUE_HASH_SIZE */
+/*---------------------------------------------------------------------------*/
+/* May the neighbor be picked by tsch_queue_get_unicast_packet_for_any
+ * over a shared link? */
+static int
+nbr_is_ready(const struct tsch_neighbor *n)
+{
+  return !n->is_broadcast && n->tx_links_count == 0
+      && n->backoff_window == 0 && !ringbufindex_empty(&n->tx_ringbuf);
+}
+/*---------------------------------------------------------------------------*/
+/* Append a neighbor to the ready list if it is ready and not there yet */
+static void
+ready_list_add(struct tsch_neighbor *n)
+{
+  if(!(n->in_lists & TSCH_QUEUE_IN_READY) && nbr_is_ready(n)) {
+    n->ready_next = NULL;
+    if(ready_tail != NULL) {
+      ready_tail->ready_next = n;
+    } else {
+      ready_head = n;
+    }
+    ready_tail = n;
+    n->in_lists |= TSCH_QUEUE_IN_READY;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Unlink a neighbor from the ready list, prev being its predecessor */
+static void
+ready_list_unlink(struct tsch_neighbor *n, struct tsch_neighbor *prev)
+{
+  if(prev != NULL) {
+    prev->ready_next = n->ready_next;
+  } else {
+    ready_head = n->ready_next;
+  }
+  if(ready_tail == n) {
+    ready_tail = prev;
+  }
+  n->in_lists &= ~TSCH_QUEUE_IN_READY;
+}
+/*---------------------------------------------------------------------------*/
+/* Unlink a neighbor from the backoff list, prev being its predecessor */
+static void
+backoff_list_unlink(struct tsch_neighbor *n, struct tsch_neighbor *prev)
+{
+  if(prev != NULL) {
+    prev->backoff_next = n->backoff_next;
+  } else {
+    backoff_head = n->backoff_next;
+  }
+  n->in_lists &= ~TSCH_QUEUE_IN_BACKOFF;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a neighbor from both the ready and the backoff list */
+static void
+ready_lists_remove(struct tsch_neighbor *n)
+{
+  struct tsch_neighbor *curr;
+  struct tsch_neighbor *prev;
+
+  for(prev = NULL, curr = ready_head; curr != NULL; prev = curr, curr = curr->ready_next) {
+    if(curr == n) {
+      ready_list_unlink(n, prev);
+      break;
+    }
+  }
+  for(prev = NULL, curr = backoff_head; curr != NULL; prev = curr, curr = curr->backoff_next) {
+    if(curr == n) {
+      backoff_list_unlink(n, prev);
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Hand a neighbor over to the slot operation for insertion in the ready list.
+ * Called from process context only */
+static void
+ready_list_signal(struct tsch_neighbor *n)
+{
+  int16_t put_index;
+
+  if(!n->ready_pending && !(n->in_lists & TSCH_QUEUE_IN_READY)) {
+    put_index = ringbufindex_peek_put(&ready_ring);
+    if(put_index != -1) {
+      n->ready_pending = 1;
+      ready_ring_array[put_index] = n;
+      ringbufindex_put(&ready_ring);
+    } else {
+      ready_ring_overflow = 1;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Move the neighbors signaled from process context to the ready list.
+ * Called from the slot operation or while holding the TSCH lock */
+static void
+ready_list_sync(void)
+{
+  int16_t get_index;
+
+  while((get_index = ringbufindex_peek_get(&ready_ring)) != -1) {
+    struct tsch_neighbor *n = ready_ring_array[get_index];
+    ringbufindex_get(&ready_ring);
+    n->ready_pending = 0;
+    ready_list_add(n);
+  }
+  if(ready_ring_overflow) {
+    struct tsch_neighbor *n = list_head(neighbor_list);
+    ready_ring_overflow = 0;
+    while(n != NULL) {
+      ready_list_add(n);
+      n = list_item_next(n);
+    }
+  }
+}
+
 /*---------------------------------------------------------------------------*/
 /* Add a TSCH neighbor */
 struct tsch_neighbor *
@@ -99,6 +282,7 @@ tsch_queue_add_nbr(const linkaddr_t *addr)
         tsch_queue_backoff_reset(n);
         /* Add neighbor to the list */
         list_add(neighbor_list, n);
+        hash_add(n);
       }
       tsch_release_lock();
     }
@@ -111,6 +295,15 @@ struct tsch_neighbor *
 tsch_queue_get_nbr(const linkaddr_t *addr)
 {
   if(!tsch_is_locked()) {
+#if TSCH_QUEUE_HASH_SIZE
+    struct tsch_neighbor *n = *hash_bucket(addr);
+    while(n != NULL) {
+      if(linkaddr_cmp(&n->addr, addr)) {
+        return n;
+      }
+      n = n->hash_next;
+    }
+#else /* TSCH_QUEUE_HASH_SIZE */
     struct tsch_neighbor *n = list_head(neighbor_list);
     while(n != NULL) {
       if(linkaddr_cmp(&n->addr, addr)) {
@@ -118,6 +311,7 @@ tsch_queue_get_nbr(const linkaddr_t *addr)
       }
       n = list_item_next(n);
     }
+#endif /* TSCH_QUEUE_HASH_SIZE */
   }
   return NULL;
 }
@@ -214,6 +408,10 @@ tsch_queue_remove_nbr(struct tsch_neighbor *n)
 
       /* Remove neighbor from list */
       list_remove(neighbor_list, n);
+      hash_remove(n);
+      /* The neighbor may still be waiting in the ready ring */
+      ready_list_sync();
+      ready_lists_remove(n);
 
       tsch_release_lock();
 
@@ -253,6 +451,9 @@ tsch_queue_add_packet(const linkaddr_t *addr, mac_callback_t sent, void *ptr)
             /* Add to ringbuf (actual add committed through atomic operation) */
             n->tx_array[put_index] = p;
             ringbufindex_put(&n->tx_ringbuf);
+            if(!n->is_broadcast && n->tx_links_count == 0) {
+              ready_list_signal(n);
+            }
             return p;
           } else {
             memb_free(&packet_memb, p);
@@ -396,8 +597,35 @@ struct tsch_packet *
 tsch_queue_get_unicast_packet_for_any(struct tsch_neighbor **n, struct tsch_link *link)
 {
   if(!tsch_is_locked()) {
-    struct tsch_neighbor *curr_nbr = list_head(neighbor_list);
+    struct tsch_neighbor *curr_nbr;
     struct tsch_packet *p = NULL;
+
+    if(link != NULL && link->link_options & LINK_OPTION_SHARED) {
+      /* Shared link: only neighbors with expired backoff may send,
+       * look them up in the ready list */
+      struct tsch_neighbor *prev_nbr = NULL;
+      ready_list_sync();
+      curr_nbr = ready_head;
+      while(curr_nbr != NULL) {
+        struct tsch_neighbor *next_nbr = curr_nbr->ready_next;
+        if(!nbr_is_ready(curr_nbr)) {
+          ready_list_unlink(curr_nbr, prev_nbr);
+        } else {
+          p = tsch_queue_get_packet_for_nbr(curr_nbr, link);
+          if(p != NULL) {
+            if(n != NULL) {
+              *n = curr_nbr;
+            }
+            return p;
+          }
+          prev_nbr = curr_nbr;
+        }
+        curr_nbr = next_nbr;
+      }
+      return NULL;
+    }
+
+    curr_nbr = list_head(neighbor_list);
     while(curr_nbr != NULL) {
       if(!curr_nbr->is_broadcast && curr_nbr->tx_links_count == 0) {
         /* Only look up for non-broadcast neighbors we do not have a tx link to */
@@ -422,12 +650,14 @@ tsch_queue_backoff_expired(const struct tsch_neighbor *n)
   return n->backoff_window == 0;
 }
 /*---------------------------------------------------------------------------*/
-/* Reset neighbor backoff */
+/* Reset neighbor backoff. With packets in the queue, this must be called
+ * from the slot operation, as it may move the neighbor to the ready list */
 void
 tsch_queue_backoff_reset(struct tsch_neighbor *n)
 {
   n->backoff_window = 0;
   n->backoff_exponent = TSCH_MAC_MIN_BE;
+  ready_list_add(n);
 }
 /*---------------------------------------------------------------------------*/
 /* Increment backoff exponent, pick a new window */
@@ -443,6 +673,11 @@ tsch_queue_backoff_inc(struct tsch_neighbor *n)
   /* Add one to the window as we will decrement it at the end of the current slot
    * through tsch_queue_update_all_backoff_windows */
   n->backoff_window++;
+  if(!(n->in_lists & TSCH_QUEUE_IN_BACKOFF)) {
+    n->backoff_next = backoff_head;
+    backoff_head = n;
+    n->in_lists |= TSCH_QUEUE_IN_BACKOFF;
+  }
 }
 /*---------------------------------------------------------------------------*/
 /* Decrement backoff window for all queues directed at dest_addr */
@@ -451,18 +686,38 @@ tsch_queue_update_all_backoff_windows(const linkaddr_t *dest_addr)
 {
   if(!tsch_is_locked()) {
     int is_broadcast = linkaddr_cmp(dest_addr, &tsch_broadcast_address);
-    struct tsch_neighbor *n = list_head(neighbor_list);
+    struct tsch_neighbor *prev = NULL;
+    struct tsch_neighbor *n = backoff_head;
+    /* Only the queues in backoff state are in the backoff list */
     while(n != NULL) {
-      if(n->backoff_window != 0 /* Is the queue in backoff state? */
+      struct tsch_neighbor *next_n = n->backoff_next;
+      if(n->backoff_window != 0
          && ((n->tx_links_count == 0 && is_broadcast)
              || (n->tx_links_count > 0 && linkaddr_cmp(dest_addr, &n->addr)))) {
         n->backoff_window--;
       }
-      n = list_item_next(n);
+      if(n->backoff_window == 0) {
+        /* Backoff expired (or was reset) */
+        backoff_list_unlink(n, prev);
+        ready_list_add(n);
+      } else {
+        prev = n;
+      }
+      n = next_n;
     }
   }
 }
 /*---------------------------------------------------------------------------*/
+/* Re-evaluate whether the neighbor may send over shared links */
+void
+tsch_queue_update_nbr_ready(struct tsch_neighbor *n)
+{
+  if(n != NULL && !tsch_is_locked() && !n->is_broadcast
+     && n->tx_links_count == 0 && !ringbufindex_empty(&n->tx_ringbuf)) {
+    ready_list_signal(n);
+  }
+}
+/*---------------------------------------------------------------------------*/
 /* Initialize TSCH queue module */
 void
 tsch_queue_init(void)
@@ -470,6 +725,13 @@ tsch_queue_init(void)
   list_init(neighbor_list);
   memb_init(&neighbor_memb);
   memb_init(&packet_memb);
+#if TSCH_QUEUE_HASH_SIZE
+  memset(hash_buckets, 0, sizeof(hash_buckets));
+#endif /* TSCH_QUEUE_HASH_SIZE */
+  ready_head = ready_tail = NULL;
+  backoff_head = NULL;
+  ringbufindex_init(&ready_ring, READY_RING_SIZE);
+  ready_ring_overflow = 0;
   /* Add virtual EB and the broadcast neighbors */
   n_eb = tsch_queue_add_nbr(&tsch_eb_address);
   n_broadcast = tsch_queue_add_nbr(&tsch_broadcast_address);
@@ -69,6 +69,24 @@ static aes_key keys[] = {
   TSCH_SECURITY_K2
 };
 #define N_KEYS (sizeof(keys) / sizeof(aes_key))
+/* The keys with their key schedules, expanded on first use */
+static struct aes_128_context key_contexts[N_KEYS];
+static uint8_t key_contexts_ready;
+
+/*---------------------------------------------------------------------------*/
+static void
+tsch_security_set_key(uint8_t key_index)
+{
+  int i;
+
+  if(!key_contexts_ready) {
+    for(i = 0; i < N_KEYS; i++) {
+      aes_128_init_context(&key_contexts[i], keys[i]);
+    }
+    key_contexts_ready = 1;
+  }
+  ccm_star_set_context(&key_contexts[key_index - 1]);
+}
 
 /*---------------------------------------------------------------------------*/
 static void
@@ -188,7 +206,7 @@ tsch_security_secure_frame(uint8_t *hdr, uint8_t *outbuf,
     memcpy(outbuf, hdr, a_len + m_len);
   }
 
-  CCM_STAR.set_key(keys[key_index - 1]);
+  tsch_security_set_key(key_index);
 
   CCM_STAR.aead(nonce,
                 outbuf + a_len, m_len,
@@ -246,7 +264,7 @@ tsch_security_parse_frame(const uint8_t *hdr, int hdrlen, int datalen,
     m_len = 0;
   }
 
-  CCM_STAR.set_key(keys[key_index - 1]);
+  tsch_security_set_key(key_index);
 
   CCM_STAR.aead(nonce,
                 (uint8_t *)hdr + a_len, m_len,
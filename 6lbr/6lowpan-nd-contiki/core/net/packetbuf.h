@@ -228,6 +228,9 @@ struct packetbuf_addr {
 #define PACKETBUF_ATTR_PACKET_TYPE_STREAM_END 3
 #define PACKETBUF_ATTR_PACKET_TYPE_TIMESTAMP 4
 
+#define PACKETBUF_ATTR_PRIORITY_DATA         0
+#define PACKETBUF_ATTR_PRIORITY_CONTROL      1
+
 enum {
   PACKETBUF_ATTR_NONE,
 
@@ -244,6 +247,7 @@ enum {
   PACKETBUF_ATTR_MAC_SEQNO,
   PACKETBUF_ATTR_MAC_ACK,
   PACKETBUF_ATTR_IS_CREATED_AND_SECURED,
+  PACKETBUF_ATTR_PRIORITY,
 #if TSCH_WITH_LINK_SELECTOR
   PACKETBUF_ATTR_TSCH_SLOTFRAME,
   PACKETBUF_ATTR_TSCH_TIMESLOT,
@@ -64,6 +64,10 @@ enum energest_type {
 
   ENERGEST_TYPE_SERIAL,
 
+  /* CPU time spent in crypto_hash() for the ND authenticator, also
+     counted in ENERGEST_TYPE_CPU */
+  ENERGEST_TYPE_CRYPTO,
+
   ENERGEST_TYPE_MAX
 };
 
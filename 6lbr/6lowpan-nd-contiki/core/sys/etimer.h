@@ -65,6 +65,18 @@
 #include "sys/timer.h"
 #include "sys/process.h"
 
+/**
+ * Selects the timer backend. With ETIMER_CONF_WHEEL, pending timers
+ * are kept in a hierarchical timing wheel, so that setting and
+ * stopping a timer take constant time. Otherwise they are kept on a
+ * single list.
+ */
+#ifdef ETIMER_CONF_WHEEL
+#define ETIMER_WHEEL ETIMER_CONF_WHEEL
+#else
+#define ETIMER_WHEEL 0
+#endif
+
 /**
  * A timer.
  *
@@ -77,6 +89,10 @@ struct etimer {
   struct timer timer;
   struct etimer *next;
   struct process *p;
+#if ETIMER_WHEEL
+  struct etimer **pprev;
+  uintptr_t link_check;
+#endif /* ETIMER_WHEEL */
 };
 
 /**
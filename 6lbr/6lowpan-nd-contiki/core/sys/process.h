@@ -88,6 +88,41 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/* Size of the queue of PROCESS_PRIO_HIGH events. 0 leaves a single
+   queue, as without priorities. */
+#ifndef PROCESS_CONF_NUMEVENTS_HIGH
+#define PROCESS_CONF_NUMEVENTS_HIGH 8
+#endif /* PROCESS_CONF_NUMEVENTS_HIGH */
+
+/* 1: a process that called process_subscribe() only gets the broadcast
+   events it subscribed to, the others still get all of them. 0: every
+   process gets every broadcast event, as they always did. */
+#ifndef PROCESS_CONF_BROADCAST_SUBSCRIBE
+#define PROCESS_CONF_BROADCAST_SUBSCRIBE 0
+#endif /* PROCESS_CONF_BROADCAST_SUBSCRIBE */
+
+/**
+ * \name Event priorities
+ *
+ * An event posted with process_post() gets the priority of the process
+ * it is posted to, broadcast events get PROCESS_PRIO_NORMAL. Each
+ * priority has its own queue and process_run() always delivers the
+ * oldest event of the highest priority first. When the queue of a
+ * priority is full, the event goes to the queue below it, and so do the
+ * following events of the same process until it has been delivered, so
+ * that a process still gets its events in the order they were posted.
+ * @{
+ */
+#define PROCESS_PRIO_NORMAL           0
+#define PROCESS_PRIO_HIGH             1
+
+#if PROCESS_CONF_NUMEVENTS_HIGH > 0
+#define PROCESS_PRIO_LEVELS           2
+#else
+#define PROCESS_PRIO_LEVELS           1
+#endif
+/** @} */
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -322,7 +357,29 @@ struct process {
 #endif
   PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
   struct pt pt;
-  unsigned char state, needspoll;
+  unsigned char state, needspoll, prio;
+  /* Events waiting in a queue below the one of prio */
+  unsigned char spilled;
+  /* Number of process_subscribe() calls in effect */
+  unsigned char subscriptions;
+};
+
+/**
+ * A subscription of a process to a broadcast event, see
+ * process_subscribe().
+ */
+struct process_subscriber {
+  struct process_subscriber *next;
+  struct process *p;
+  process_event_t ev;
+};
+
+/** Occupancy of the event queue of one priority */
+struct process_queue_stats {
+  /** Largest number of events the queue held at once */
+  process_num_events_t maxevents;
+  /** Events that did not fit into the queue */
+  unsigned short overflows;
 };
 
 /**
@@ -377,6 +434,39 @@ CCIF int process_post(struct process *p, process_event_t ev, process_data_t data
 CCIF void process_post_synch(struct process *p,
 			     process_event_t ev, process_data_t data);
 
+/**
+ * Set the priority of the events posted to a process.
+ *
+ * \param p The process.
+ *
+ * \param prio PROCESS_PRIO_NORMAL or PROCESS_PRIO_HIGH.
+ */
+void process_set_prio(struct process *p, unsigned char prio);
+
+/**
+ * Subscribe a process to a broadcast event.
+ *
+ * With PROCESS_CONF_BROADCAST_SUBSCRIBE, a process that subscribed to
+ * any broadcast event only gets the broadcast events it subscribed to;
+ * processes that never subscribed still get all of them. The
+ * subscription ends when the process exits or with
+ * process_unsubscribe(). Without it, subscribing has no effect.
+ *
+ * \param s A subscription structure, which must stay allocated while
+ * the subscription lasts.
+ *
+ * \param p The process.
+ *
+ * \param ev The broadcast event.
+ */
+void process_subscribe(struct process_subscriber *s, struct process *p,
+                       process_event_t ev);
+
+/**
+ * End a subscription made with process_subscribe().
+ */
+void process_unsubscribe(struct process_subscriber *s);
+
 /**
  * \brief      Cause a process to exit
  * \param p    The process that is to be exited
@@ -519,6 +609,13 @@ CCIF int process_is_running(struct process *p);
  */
 int process_nevents(void);
 
+#if PROCESS_CONF_STATS
+/**
+ * Occupancy of the event queues, indexed by priority.
+ */
+extern struct process_queue_stats process_queue_stats[PROCESS_PRIO_LEVELS];
+#endif /* PROCESS_CONF_STATS */
+
 /** @} */
 
 CCIF extern struct process *process_list;
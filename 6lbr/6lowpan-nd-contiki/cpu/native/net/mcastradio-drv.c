@@ -0,0 +1,501 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Simulated 802.15.4 radio medium on a local UDP multicast group.
+ *
+ *         Each frame is sent as one datagram to the group, prefixed with
+ *         the channel and the NATIVE_NODE_ID of the sender. Every node
+ *         receives every datagram and drops it according to the
+ *         packet reception ratio of the link from the sender, taken
+ *         from MCASTRADIO_LOSS or from a MCASTRADIO_TOPOLOGY file.
+ */
+
+#include "contiki.h"
+#include "contiki-conf.h"
+
+#if NETSTACK_CONF_WITH_IPV6 && !defined(__CYGWIN__)
+
+#include "mcastradio-drv.h"
+
+#include "net/packetbuf.h"
+#include "net/netstack.h"
+#include "lib/random.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+/* Multicast group and UDP port shared by all nodes of one network.
+   Overridden by MCASTRADIO_GROUP and MCASTRADIO_PORT, so that several
+   networks can run side by side. */
+#ifdef MCASTRADIO_CONF_GROUP
+#define MCASTRADIO_GROUP MCASTRADIO_CONF_GROUP
+#else
+#define MCASTRADIO_GROUP "239.255.21.54"
+#endif
+
+#ifdef MCASTRADIO_CONF_PORT
+#define MCASTRADIO_PORT MCASTRADIO_CONF_PORT
+#else
+#define MCASTRADIO_PORT 21554
+#endif
+
+/* Local interface the group is joined on (MCASTRADIO_IF). The loopback
+   interface keeps the medium on this host. */
+#ifdef MCASTRADIO_CONF_IF
+#define MCASTRADIO_IF MCASTRADIO_CONF_IF
+#else
+#define MCASTRADIO_IF "127.0.0.1"
+#endif
+
+/* Number of frames handed to the RDC per main loop round */
+#ifdef MCASTRADIO_CONF_RX_BURST
+#define RX_BURST MCASTRADIO_CONF_RX_BURST
+#else
+#define RX_BURST 8
+#endif
+
+#ifdef RF_CHANNEL
+#define DEFAULT_CHANNEL RF_CHANNEL
+#else
+#define DEFAULT_CHANNEL 26
+#endif
+
+#define MAX_PACKET_SIZE 127
+
+/* Datagram header: magic, channel, sender node id, sender pid. The pid
+   filters the copy of our own frames that the group loops back. */
+#define HDR_MAGIC 0xa5
+#define HDR_LEN   8
+
+/* Packet reception ratios are kept in 1/1000 */
+#define PRR_MAX 1000
+
+static int sockfd = -1;
+static struct sockaddr_in group_addr;
+static uint16_t my_id;
+static uint32_t my_pid;
+static uint8_t channel = DEFAULT_CHANNEL;
+static uint8_t radio_is_on;
+
+static uint8_t txbuf[HDR_LEN + MAX_PACKET_SIZE];
+static int buflen;
+
+/* PRR of the links towards this node, indexed by the sender's node id.
+   NULL: all links share default_prr. */
+static uint16_t *rx_prr;
+static uint16_t default_prr = PRR_MAX;
+
+/*---------------------------------------------------------------------------*/
+static uint16_t
+prr_from_ratio(double prr)
+{
+  if(prr < 0) {
+    prr = 0;
+  } else if(prr > 1) {
+    prr = 1;
+  }
+  return (uint16_t)(prr * PRR_MAX + 0.5);
+}
+/*---------------------------------------------------------------------------*/
+/* Reads "<src> <dst> <prr>" lines, prr in [0, 1]. '*' as src or dst
+   matches every node. Links that are not listed do not exist. */
+static int
+load_topology(const char *path)
+{
+  FILE *f;
+  char line[128];
+  char src[16], dst[16], prr[16];
+  unsigned long id;
+  int lineno = 0;
+
+  f = fopen(path, "r");
+  if(f == NULL) {
+    perror("mcastradio topology");
+    return 0;
+  }
+  rx_prr = calloc(0x10000, sizeof(uint16_t));
+  if(rx_prr == NULL) {
+    fclose(f);
+    return 0;
+  }
+  while(fgets(line, sizeof(line), f) != NULL) {
+    lineno++;
+    if(line[0] == '#' || line[0] == '\n') {
+      continue;
+    }
+    if(sscanf(line, "%15s %15s %15s", src, dst, prr) != 3) {
+      fprintf(stderr, "mcastradio: %s:%d: expected <src> <dst> <prr>\n",
+              path, lineno);
+      continue;
+    }
+    if(strcmp(dst, "*") != 0 && strtoul(dst, NULL, 0) != my_id) {
+      continue;
+    }
+    if(strcmp(src, "*") == 0) {
+      for(id = 0; id < 0x10000; id++) {
+        rx_prr[id] = prr_from_ratio(atof(prr));
+      }
+    } else {
+      id = strtoul(src, NULL, 0);
+      if(id < 0x10000) {
+        rx_prr[id] = prr_from_ratio(atof(prr));
+      }
+    }
+  }
+  fclose(f);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_fd(fd_set *rset, fd_set *wset)
+{
+  uint8_t buf[HDR_LEN + MAX_PACKET_SIZE];
+  uint16_t sender;
+  uint16_t prr;
+  int bytes;
+  int i;
+
+  if(!FD_ISSET(sockfd, rset)) {
+    return;
+  }
+  /* Datagrams left in the socket are picked up in the next round */
+  for(i = 0; i < RX_BURST; i++) {
+    bytes = recv(sockfd, buf, sizeof(buf), MSG_DONTWAIT);
+    if(bytes < 0) {
+      if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        perror("mcastradio recv()");
+      }
+      return;
+    }
+    if(bytes <= HDR_LEN || buf[0] != HDR_MAGIC) {
+      continue;
+    }
+    sender = (buf[2] << 8) | buf[3];
+    if(memcmp(&buf[4], &my_pid, sizeof(my_pid)) == 0 && sender == my_id) {
+      /* Our own frame */
+      continue;
+    }
+    if(!radio_is_on || buf[1] != channel) {
+      continue;
+    }
+    prr = rx_prr != NULL ? rx_prr[sender] : default_prr;
+    if(prr < PRR_MAX && random_rand() % PRR_MAX >= prr) {
+      continue;
+    }
+    PRINTF("mcastradio: %d bytes from %u\n", bytes - HDR_LEN, sender);
+    packetbuf_clear();
+    memcpy(packetbuf_dataptr(), &buf[HDR_LEN], bytes - HDR_LEN);
+    packetbuf_set_datalen(bytes - HDR_LEN);
+    NETSTACK_RDC.input();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+set_fd(fd_set *rset, fd_set *wset)
+{
+  FD_SET(sockfd, rset);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static const struct select_callback mcastradio_sock_callback = { set_fd, handle_fd };
+/*---------------------------------------------------------------------------*/
+static int
+init(void)
+{
+  struct sockaddr_in addr;
+  struct ip_mreq mreq;
+  struct in_addr ifaddr;
+  const char *env;
+  unsigned char loop = 1;
+  unsigned char ttl = 1;
+  int one = 1;
+  int rcvbuf = 1 << 20;
+
+  env = getenv("NATIVE_NODE_ID");
+  my_id = env != NULL ? strtoul(env, NULL, 0) : 0;
+  my_pid = getpid();
+
+  env = getenv("MCASTRADIO_LOSS");
+  if(env != NULL) {
+    /* Loss in percent on every link */
+    default_prr = PRR_MAX - prr_from_ratio(atof(env) / 100);
+  }
+  env = getenv("MCASTRADIO_TOPOLOGY");
+  if(env != NULL && !load_topology(env)) {
+    return 1;
+  }
+
+  memset(&group_addr, 0, sizeof(group_addr));
+  group_addr.sin_family = AF_INET;
+  env = getenv("MCASTRADIO_PORT");
+  group_addr.sin_port = htons(env != NULL ? atoi(env) : MCASTRADIO_PORT);
+  env = getenv("MCASTRADIO_GROUP");
+  if(inet_pton(AF_INET, env != NULL ? env : MCASTRADIO_GROUP,
+               &group_addr.sin_addr) != 1) {
+    fprintf(stderr, "mcastradio: bad multicast group\n");
+    return 1;
+  }
+  env = getenv("MCASTRADIO_IF");
+  if(inet_pton(AF_INET, env != NULL ? env : MCASTRADIO_IF, &ifaddr) != 1) {
+    fprintf(stderr, "mcastradio: bad interface address\n");
+    return 1;
+  }
+
+  sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+  if(sockfd < 0) {
+    perror("mcastradio socket()");
+    return 1;
+  }
+  setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  /* Hundreds of nodes may send in the same main loop round */
+  setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+  /* Bind to the group, not to INADDR_ANY, to only see the medium */
+  addr = group_addr;
+  if(bind(sockfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    perror("mcastradio bind()");
+    goto fail;
+  }
+  mreq.imr_multiaddr = group_addr.sin_addr;
+  mreq.imr_interface = ifaddr;
+  if(setsockopt(sockfd, IPPROTO_IP, IP_ADD_MEMBERSHIP,
+                &mreq, sizeof(mreq)) < 0) {
+    perror("mcastradio IP_ADD_MEMBERSHIP");
+    goto fail;
+  }
+  if(setsockopt(sockfd, IPPROTO_IP, IP_MULTICAST_IF,
+                &ifaddr, sizeof(ifaddr)) < 0 ||
+     setsockopt(sockfd, IPPROTO_IP, IP_MULTICAST_LOOP,
+                &loop, sizeof(loop)) < 0 ||
+     setsockopt(sockfd, IPPROTO_IP, IP_MULTICAST_TTL,
+                &ttl, sizeof(ttl)) < 0) {
+    perror("mcastradio setsockopt()");
+    goto fail;
+  }
+
+  select_set_callback(sockfd, &mcastradio_sock_callback);
+  printf("mcastradio: node %u on %s:%u\n", my_id,
+         inet_ntoa(group_addr.sin_addr), ntohs(group_addr.sin_port));
+  return 0;
+
+fail:
+  close(sockfd);
+  sockfd = -1;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+prepare(const void *payload, unsigned short payload_len)
+{
+  if(payload_len > MAX_PACKET_SIZE) {
+    return 1;
+  }
+  txbuf[0] = HDR_MAGIC;
+  txbuf[1] = channel;
+  txbuf[2] = my_id >> 8;
+  txbuf[3] = my_id & 0xff;
+  memcpy(&txbuf[4], &my_pid, sizeof(my_pid));
+  memcpy(&txbuf[HDR_LEN], payload, payload_len);
+  buflen = payload_len;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+transmit(unsigned short transmit_len)
+{
+  int ret;
+
+  if(sockfd < 0 || buflen == 0) {
+    return RADIO_TX_ERR;
+  }
+  ret = sendto(sockfd, txbuf, HDR_LEN + buflen, MSG_DONTWAIT,
+               (struct sockaddr *)&group_addr, sizeof(group_addr));
+  if(ret < 0) {
+    perror("mcastradio sendto()");
+    return RADIO_TX_ERR;
+  }
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+my_send(const void *payload, unsigned short payload_len)
+{
+  if(prepare(payload, payload_len)) {
+    return RADIO_TX_ERR;
+  }
+  return transmit(payload_len);
+}
+/*---------------------------------------------------------------------------*/
+static int
+my_read(void *buf, unsigned short buf_len)
+{
+  /* Frames are pushed to the RDC from handle_fd() */
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+channel_clear(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+receiving_packet(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+pending_packet(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+on(void)
+{
+  radio_is_on = 1;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+off(void)
+{
+  /* Keep the socket; frames that arrive while off are dropped */
+  radio_is_on = 0;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+get_value(radio_param_t param, radio_value_t *value)
+{
+  if(value == NULL) {
+    return RADIO_RESULT_INVALID_VALUE;
+  }
+  switch(param) {
+  case RADIO_PARAM_POWER_MODE:
+    *value = radio_is_on ? RADIO_POWER_MODE_ON : RADIO_POWER_MODE_OFF;
+    return RADIO_RESULT_OK;
+  case RADIO_PARAM_CHANNEL:
+    *value = channel;
+    return RADIO_RESULT_OK;
+  case RADIO_PARAM_RX_MODE:
+  case RADIO_PARAM_TX_MODE:
+    *value = 0;
+    return RADIO_RESULT_OK;
+  case RADIO_CONST_CHANNEL_MIN:
+    *value = 11;
+    return RADIO_RESULT_OK;
+  case RADIO_CONST_CHANNEL_MAX:
+    *value = 26;
+    return RADIO_RESULT_OK;
+  default:
+    return RADIO_RESULT_NOT_SUPPORTED;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+set_value(radio_param_t param, radio_value_t value)
+{
+  switch(param) {
+  case RADIO_PARAM_POWER_MODE:
+    if(value == RADIO_POWER_MODE_ON) {
+      on();
+    } else if(value == RADIO_POWER_MODE_OFF) {
+      off();
+    } else {
+      return RADIO_RESULT_INVALID_VALUE;
+    }
+    return RADIO_RESULT_OK;
+  case RADIO_PARAM_CHANNEL:
+    if(value < 11 || value > 26) {
+      return RADIO_RESULT_INVALID_VALUE;
+    }
+    channel = value;
+    return RADIO_RESULT_OK;
+  case RADIO_PARAM_RX_MODE:
+  case RADIO_PARAM_TX_MODE:
+    return RADIO_RESULT_OK;
+  default:
+    return RADIO_RESULT_NOT_SUPPORTED;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+get_object(radio_param_t param, void *dest, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+set_object(radio_param_t param, const void *src, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+const struct radio_driver mcastradio_driver =
+{
+  init,
+  prepare,
+  transmit,
+  my_send,
+  my_read,
+  channel_clear,
+  receiving_packet,
+  pending_packet,
+  on,
+  off,
+  get_value,
+  set_value,
+  get_object,
+  set_object
+};
+/*---------------------------------------------------------------------------*/
+#endif /* NETSTACK_CONF_WITH_IPV6 && !defined(__CYGWIN__) */
@@ -45,6 +45,13 @@
 #define BUF ((struct uip_eth_hdr *)&uip_buf[0])
 #define IPBUF ((struct uip_tcpip_hdr *)&uip_buf[UIP_LLH_LEN])
 
+/* Number of frames handed to the stack per poll of the driver process */
+#ifdef TAPDEV_CONF_RX_BURST
+#define TAPDEV_RX_BURST TAPDEV_CONF_RX_BURST
+#else
+#define TAPDEV_RX_BURST 8
+#endif
+
 PROCESS(tapdev_process, "TAP driver");
 
 /*---------------------------------------------------------------------------*/
@@ -59,10 +66,8 @@ tapdev_output(void)
 #endif
 /*---------------------------------------------------------------------------*/
 static void
-pollhandler(void)
+input_frame(void)
 {
-  uip_len = tapdev_poll();
-
   if(uip_len > 0) {
 #if NETSTACK_CONF_WITH_IPV6
     if(BUF->type == uip_htons(UIP_ETHTYPE_IPV6)) {
@@ -88,6 +93,23 @@ pollhandler(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+static void
+pollhandler(void)
+{
+  int i;
+
+  /* Drain the device in bursts */
+  for(i = 0; i < TAPDEV_RX_BURST; i++) {
+    uip_len = tapdev_poll();
+    if(uip_len == 0) {
+      return;
+    }
+    input_frame();
+  }
+  /* There may be more: continue once other processes had their turn */
+  process_poll(&tapdev_process);
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(tapdev_process, ev, data)
 {
   PROCESS_POLLHANDLER(pollhandler());
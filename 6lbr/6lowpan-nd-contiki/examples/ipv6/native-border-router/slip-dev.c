@@ -283,6 +283,8 @@ serial_input(FILE *inslip)
 unsigned char slip_buf[2048];
 int slip_end, slip_begin, slip_packet_end, slip_packet_count;
 static struct timer send_delay_timer;
+/* wakes up the main loop when the delay is over */
+static struct ctimer send_delay_wakeup;
 /* delay between slip packets */
 static clock_time_t send_delay = SEND_DELAY;
 /*---------------------------------------------------------------------------*/
@@ -346,6 +348,7 @@ slip_flushbuf(int fd)
         /* a delay between slip packets to avoid losing data */
         if(send_delay > 0) {
           timer_set(&send_delay_timer, send_delay);
+          ctimer_set(&send_delay_wakeup, send_delay, NULL, NULL);
         }
       }
     }
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2006, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Micro-benchmark of memb_alloc()/memb_free() against pool size
+ */
+
+#include "contiki.h"
+#include "lib/memb.h"
+
+#include <stdio.h>
+
+#ifdef MEMB_BENCHMARK_CONF_ROUNDS
+#define ROUNDS MEMB_BENCHMARK_CONF_ROUNDS
+#else
+#define ROUNDS 200000UL
+#endif
+
+struct block {
+  uint8_t data[32];
+};
+
+MEMB(pool_8, struct block, 8);
+MEMB(pool_32, struct block, 32);
+MEMB(pool_128, struct block, 128);
+MEMB(pool_512, struct block, 512);
+MEMB(pool_2048, struct block, 2048);
+
+static struct memb *pools[] = {
+  &pool_8, &pool_32, &pool_128, &pool_512, &pool_2048
+};
+/*---------------------------------------------------------------------------*/
+static void
+run(struct memb *m)
+{
+  unsigned long i;
+  clock_time_t start, ticks;
+  void *last = NULL;
+
+  memb_init(m);
+
+  /* Leave only the last block free */
+  for(i = 0; i < m->num; i++) {
+    last = memb_alloc(m);
+  }
+  memb_free(m, last);
+
+  start = clock_time();
+  for(i = 0; i < ROUNDS; i++) {
+    memb_free(m, memb_alloc(m));
+  }
+  ticks = clock_time() - start;
+
+  printf("pool %4u blocks: %lu alloc/free pairs in %lu ticks, %lu ns/pair",
+         m->num, (unsigned long)ROUNDS, (unsigned long)ticks,
+         (unsigned long)((unsigned long long)ticks * 1000000000ULL /
+                         CLOCK_SECOND / ROUNDS));
+#if MEMB_STATS
+  printf(", high water %u, failed %u",
+         memb_high_water(m), memb_alloc_failed(m));
+#endif /* MEMB_STATS */
+  printf("\n");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(memb_benchmark_process, "memb benchmark");
+AUTOSTART_PROCESSES(&memb_benchmark_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(memb_benchmark_process, ev, data)
+{
+  static int i;
+
+  PROCESS_BEGIN();
+
+  printf("memb benchmark, free list %s\n", MEMB_FREELIST ? "on" : "off");
+
+  for(i = 0; i < sizeof(pools) / sizeof(pools[0]); i++) {
+    run(pools[i]);
+    PROCESS_PAUSE();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
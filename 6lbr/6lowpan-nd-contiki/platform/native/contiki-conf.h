@@ -44,6 +44,27 @@ struct select_callback {
 };
 int select_set_callback(int fd, const struct select_callback *callback);
 
+/* Readiness callbacks: called from the main loop only when the file
+   descriptor is ready for one of the requested events. */
+#define SELECT_FD_READ  0x01
+#define SELECT_FD_WRITE 0x02
+typedef void (* select_fd_callback_t)(int fd, int events, void *ptr);
+int select_register_fd(int fd, int events, select_fd_callback_t callback,
+                       void *ptr);
+int select_set_events(int fd, int events);
+void select_unregister_fd(int fd);
+/* Wake up the main loop, safe to call from a signal handler */
+void select_wakeup(void);
+
+/* Sleep in epoll until the next event timer or fd event (Linux only) */
+#ifndef NATIVE_CONF_EPOLL
+#if defined(__linux__) || defined(__linux)
+#define NATIVE_CONF_EPOLL 1
+#else
+#define NATIVE_CONF_EPOLL 0
+#endif
+#endif /* NATIVE_CONF_EPOLL */
+
 #define CC_CONF_REGISTER_ARGS          1
 #define CC_CONF_FUNCTION_POINTER_ARGS  1
 #define CC_CONF_VA_ARGS                1
@@ -56,6 +77,21 @@ int select_set_callback(int fd, const struct select_callback *callback);
 #define CCIF
 #define CLIF
 
+/* Large pools on the native border router: use the O(1) allocator */
+#ifndef MEMB_CONF_FREELIST
+#define MEMB_CONF_FREELIST 1
+#endif
+
+/* Table-driven software AES for link-layer security */
+#ifndef AES_128_CONF_TTABLE
+#define AES_128_CONF_TTABLE 1
+#endif
+
+/* Many concurrent timers on the native border router: use the wheel */
+#ifndef ETIMER_CONF_WHEEL
+#define ETIMER_CONF_WHEEL 1
+#endif
+
 /* These names are deprecated, use C99 names. */
 typedef uint8_t   u8_t;
 typedef uint16_t u16_t;
@@ -121,6 +157,9 @@ typedef unsigned short uip_stats_t;
 #ifndef NBR_TABLE_CONF_MAX_NEIGHBORS
 #define NBR_TABLE_CONF_MAX_NEIGHBORS     30
 #endif /* NBR_TABLE_CONF_MAX_NEIGHBORS */
+#ifndef NBR_TABLE_CONF_HASH_SIZE
+#define NBR_TABLE_CONF_HASH_SIZE         16
+#endif /* NBR_TABLE_CONF_HASH_SIZE */
 #ifndef UIP_CONF_MAX_ROUTES
 #define UIP_CONF_MAX_ROUTES   30
 #endif /* UIP_CONF_MAX_ROUTES */
@@ -43,16 +43,25 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/select.h>
 #include <errno.h>
 
+#include "contiki.h"
+
+#if NATIVE_CONF_EPOLL
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#endif /* NATIVE_CONF_EPOLL */
+
 #ifdef __CYGWIN__
 #include "net/wpcap-drv.h"
 #endif /* __CYGWIN__ */
 
-#include "contiki.h"
 #include "net/netstack.h"
 
 #include "ctk/ctk.h"
@@ -71,6 +80,7 @@
 #endif /* NETSTACK_CONF_WITH_IPV6 */
 
 #include "net/rime/rime.h"
+#include "lib/random.h"
 
 #ifdef SELECT_CONF_MAX
 #define SELECT_MAX SELECT_CONF_MAX
@@ -81,9 +91,33 @@
 static const struct select_callback *select_callback[SELECT_MAX];
 static int select_max = 0;
 
+static struct select_fd {
+  select_fd_callback_t callback;
+  void *ptr;
+  int events;
+} select_fd[SELECT_MAX];
+
+#if NATIVE_CONF_EPOLL
+#define EPOLL_MAX_EVENTS (SELECT_MAX + 2)
+
+static int epoll_fd = -1;
+static int timer_fd = -1;
+static int wakeup_fd = -1;
+/* Events currently registered with epoll, per file descriptor */
+static int epoll_registered[SELECT_MAX];
+/* Regular files cannot be polled with epoll, they are always ready */
+static char epoll_always_ready[SELECT_MAX];
+/* Expiration time the timer fd is currently armed for */
+static clock_time_t timer_armed;
+static char timer_is_armed;
+#endif /* NATIVE_CONF_EPOLL */
+
 SENSORS(&pir_sensor, &vib_sensor, &button_sensor);
 
 static uint8_t serial_id[] = {0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08};
+/* EUI-64 the 6LoWPAN-ND code registers with, as the DS2411 provides it
+   on sky motes */
+unsigned char ds2411_id[8];
 #if !NETSTACK_CONF_WITH_IPV6
 static uint16_t node_id = 0x0102;
 #endif /* !NETSTACK_CONF_WITH_IPV6 */
@@ -109,7 +143,7 @@ select_set_callback(int fd, const struct select_callback *callback)
     } else {
       select_max = 0;
       for(i = SELECT_MAX - 1; i > 0; i--) {
-        if(select_callback[i] != NULL) {
+        if(select_callback[i] != NULL || select_fd[i].callback != NULL) {
           select_max = i;
           break;
         }
@@ -120,25 +154,388 @@ select_set_callback(int fd, const struct select_callback *callback)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
-static int
-stdin_set_fd(fd_set *rset, fd_set *wset)
+int
+select_register_fd(int fd, int events, select_fd_callback_t callback,
+                   void *ptr)
 {
-  FD_SET(STDIN_FILENO, rset);
+  if(fd < 0 || fd >= SELECT_MAX || callback == NULL) {
+    return 0;
+  }
+  select_fd[fd].callback = callback;
+  select_fd[fd].ptr = ptr;
+  select_fd[fd].events = events;
+  if(fd > select_max) {
+    select_max = fd;
+  }
   return 1;
 }
+/*---------------------------------------------------------------------------*/
+int
+select_set_events(int fd, int events)
+{
+  if(fd < 0 || fd >= SELECT_MAX || select_fd[fd].callback == NULL) {
+    return 0;
+  }
+  select_fd[fd].events = events;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+select_unregister_fd(int fd)
+{
+  if(fd >= 0 && fd < SELECT_MAX) {
+    select_fd[fd].callback = NULL;
+    select_fd[fd].events = 0;
+    /* Recompute the fd max */
+    select_set_callback(fd, select_callback[fd]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+select_wakeup(void)
+{
+#if NATIVE_CONF_EPOLL
+  uint64_t one = 1;
+
+  if(wakeup_fd >= 0) {
+    if(write(wakeup_fd, &one, sizeof(one)) < 0) {
+      /* The counter is already set, the loop will wake up anyway */
+    }
+  }
+#endif /* NATIVE_CONF_EPOLL */
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Milliseconds until the next event timer expires, 0 if there is
+ * work left to do, and -1 if nothing is scheduled.
+ */
+static int
+next_timeout(int busy)
+{
+  clock_time_t now;
+  clock_time_t next;
+
+  if(busy) {
+    return 0;
+  }
+  if(!etimer_pending()) {
+    return -1;
+  }
+  now = clock_time();
+  next = etimer_next_expiration_time();
+  next -= now;
+  if(next == 0 || next > ((clock_time_t)~0) / 2) {
+    /* Already expired */
+    return 0;
+  }
+  if(next > 0x7fffffffUL / 1000) {
+    return 0x7fffffff;
+  }
+  /* Round up, waking up early would only spin */
+  return (next * 1000 + CLOCK_SECOND - 1) / CLOCK_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+#if NATIVE_CONF_EPOLL
+static void
+epoll_sync(int fd, int events)
+{
+  struct epoll_event ev;
+  int op;
+
+  if(events == epoll_registered[fd]) {
+    return;
+  }
+
+  memset(&ev, 0, sizeof(ev));
+  ev.data.fd = fd;
+  if(events & SELECT_FD_READ) {
+    ev.events |= EPOLLIN;
+  }
+  if(events & SELECT_FD_WRITE) {
+    ev.events |= EPOLLOUT;
+  }
+
+  if(events == 0) {
+    op = EPOLL_CTL_DEL;
+  } else if(epoll_registered[fd] == 0) {
+    op = EPOLL_CTL_ADD;
+  } else {
+    op = EPOLL_CTL_MOD;
+  }
+
+  epoll_always_ready[fd] = 0;
+  if(epoll_ctl(epoll_fd, op, fd, &ev) < 0) {
+    /* A closed fd silently leaves the epoll set: add it again */
+    if(op == EPOLL_CTL_MOD && errno == ENOENT) {
+      epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+    } else if(op == EPOLL_CTL_ADD && errno == EPERM) {
+      epoll_always_ready[fd] = 1;
+    } else if(op != EPOLL_CTL_DEL) {
+      perror("epoll_ctl");
+    }
+  }
+  epoll_registered[fd] = events;
+}
+/*---------------------------------------------------------------------------*/
+static void
+epoll_add_internal(int fd)
+{
+  struct epoll_event ev;
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = fd;
+  if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+    perror("epoll_ctl");
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+epoll_init(void)
+{
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if(epoll_fd < 0 || timer_fd < 0 || wakeup_fd < 0) {
+    perror("epoll_init");
+    exit(1);
+  }
+  epoll_add_internal(timer_fd);
+  epoll_add_internal(wakeup_fd);
+}
+/*---------------------------------------------------------------------------*/
+static void
+arm_timer(int timeout)
+{
+  struct itimerspec its;
+  clock_time_t next;
+
+  /* Leave the timer fd alone if the deadline has not moved */
+  next = etimer_next_expiration_time();
+  if(timeout > 0 && timer_is_armed && timer_armed == next) {
+    return;
+  }
+  if(timeout <= 0 && !timer_is_armed) {
+    return;
+  }
+
+  memset(&its, 0, sizeof(its));
+  if(timeout > 0) {
+    its.it_value.tv_sec = timeout / 1000;
+    its.it_value.tv_nsec = (timeout % 1000) * 1000000L;
+  }
+  timerfd_settime(timer_fd, 0, &its, NULL);
+  timer_armed = next;
+  timer_is_armed = timeout > 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+select_poll(int busy)
+{
+  struct epoll_event events[EPOLL_MAX_EVENTS];
+  int ready[SELECT_MAX];
+  fd_set fdr;
+  fd_set fdw;
+  fd_set ready_fdr;
+  fd_set ready_fdw;
+  uint64_t count;
+  int legacy_ready;
+  int timeout;
+  int retval;
+  int i;
+
+  /* Collect the interest of the select callbacks */
+  FD_ZERO(&fdr);
+  FD_ZERO(&fdw);
+  for(i = 0; i <= select_max; i++) {
+    if(select_callback[i] != NULL) {
+      select_callback[i]->set_fd(&fdr, &fdw);
+    }
+  }
+  for(i = 0; i < SELECT_MAX; i++) {
+    int ev = select_fd[i].callback != NULL ? select_fd[i].events : 0;
+    if(FD_ISSET(i, &fdr)) {
+      ev |= SELECT_FD_READ;
+    }
+    if(FD_ISSET(i, &fdw)) {
+      ev |= SELECT_FD_WRITE;
+    }
+    epoll_sync(i, ev);
+    ready[i] = epoll_always_ready[i] ? ev : 0;
+    if(ready[i]) {
+      busy = 1;
+    }
+  }
+
+  timeout = next_timeout(busy);
+  arm_timer(timeout);
+
+  retval = epoll_wait(epoll_fd, events, EPOLL_MAX_EVENTS,
+                      timeout > 0 ? -1 : timeout);
+  if(retval < 0) {
+    if(errno != EINTR) {
+      perror("epoll_wait");
+    }
+    retval = 0;
+  }
+
+  for(i = 0; i < retval; i++) {
+    int fd = events[i].data.fd;
+
+    if(fd == timer_fd || fd == wakeup_fd) {
+      if(fd == timer_fd) {
+        timer_is_armed = 0;
+      }
+      if(read(fd, &count, sizeof(count)) < 0) {
+        /* Nothing to read, the event was already consumed */
+      }
+    } else if(fd >= 0 && fd < SELECT_MAX) {
+      if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        ready[fd] |= SELECT_FD_READ;
+      }
+      if(events[i].events & (EPOLLOUT | EPOLLERR)) {
+        ready[fd] |= SELECT_FD_WRITE;
+      }
+    }
+  }
+
+  /* Dispatch: readiness callbacks first, then the select callbacks
+     with the fd sets they asked for */
+  FD_ZERO(&ready_fdr);
+  FD_ZERO(&ready_fdw);
+  legacy_ready = 0;
+  for(i = 0; i < SELECT_MAX; i++) {
+    int ev;
+
+    if(ready[i] == 0) {
+      continue;
+    }
+    ev = ready[i] & select_fd[i].events;
+    if(select_fd[i].callback != NULL && ev != 0) {
+      select_fd[i].callback(i, ev, select_fd[i].ptr);
+    }
+    if((ready[i] & SELECT_FD_READ) && FD_ISSET(i, &fdr)) {
+      FD_SET(i, &ready_fdr);
+      legacy_ready = 1;
+    }
+    if((ready[i] & SELECT_FD_WRITE) && FD_ISSET(i, &fdw)) {
+      FD_SET(i, &ready_fdw);
+      legacy_ready = 1;
+    }
+  }
+
+  if(legacy_ready) {
+    for(i = 0; i <= select_max; i++) {
+      if(select_callback[i] != NULL) {
+        select_callback[i]->handle_fd(&ready_fdr, &ready_fdw);
+      }
+    }
+  }
+}
+#else /* NATIVE_CONF_EPOLL */
+static void
+select_poll(int busy)
+{
+  fd_set fdr;
+  fd_set fdw;
+  int maxfd;
+  int i;
+  int retval;
+  int timeout;
+  struct timeval tv;
+
+  timeout = next_timeout(busy);
+  tv.tv_sec = timeout / 1000;
+  tv.tv_usec = (timeout % 1000) * 1000;
+
+  FD_ZERO(&fdr);
+  FD_ZERO(&fdw);
+  maxfd = 0;
+  for(i = 0; i <= select_max; i++) {
+    if(select_callback[i] != NULL && select_callback[i]->set_fd(&fdr, &fdw)) {
+      maxfd = i;
+    }
+    if(select_fd[i].callback != NULL) {
+      if(select_fd[i].events & SELECT_FD_READ) {
+        FD_SET(i, &fdr);
+      }
+      if(select_fd[i].events & SELECT_FD_WRITE) {
+        FD_SET(i, &fdw);
+      }
+      maxfd = i;
+    }
+  }
+
+  retval = select(maxfd + 1, &fdr, &fdw, NULL, timeout < 0 ? NULL : &tv);
+  if(retval < 0) {
+    if(errno != EINTR) {
+      perror("select");
+    }
+  } else if(retval > 0) {
+    /* timeout => retval == 0 */
+    for(i = 0; i <= maxfd; i++) {
+      if(select_fd[i].callback != NULL) {
+        int ev = 0;
+        if((select_fd[i].events & SELECT_FD_READ) && FD_ISSET(i, &fdr)) {
+          ev |= SELECT_FD_READ;
+        }
+        if((select_fd[i].events & SELECT_FD_WRITE) && FD_ISSET(i, &fdw)) {
+          ev |= SELECT_FD_WRITE;
+        }
+        if(ev) {
+          select_fd[i].callback(i, ev, select_fd[i].ptr);
+        }
+      }
+      if(select_callback[i] != NULL) {
+        select_callback[i]->handle_fd(&fdr, &fdw);
+      }
+    }
+  }
+}
+#endif /* NATIVE_CONF_EPOLL */
+/*---------------------------------------------------------------------------*/
 static void
-stdin_handle_fd(fd_set *rset, fd_set *wset)
+stdin_handle_fd(int fd, int events, void *ptr)
 {
   char c;
-  if(FD_ISSET(STDIN_FILENO, rset)) {
-    if(read(STDIN_FILENO, &c, 1) > 0) {
-      serial_line_input_byte(c);
+  if(read(fd, &c, 1) > 0) {
+    serial_line_input_byte(c);
+  } else {
+    /* End of input: stop polling stdin */
+    select_unregister_fd(fd);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Several native nodes can share one simulated radio medium (see
+   mcastradio-drv.c). NATIVE_NODE_ID=n gives the node the address Cooja
+   gives to sky mote n, 00:12:74:n:00:n:n:n for n < 256. Above that, the
+   high byte of n goes into bytes 4 and 6 (xored with the low byte), so
+   that the short address taken from bytes 6 and 7 stays unique. */
+static void
+set_serial_id(void)
+{
+  const char *env;
+  unsigned long id;
+
+  env = getenv("NATIVE_NODE_ID");
+  if(env != NULL) {
+    id = strtoul(env, NULL, 0);
+    if(id > 0 && id <= 0xffff) {
+      serial_id[0] = 0x00;
+      serial_id[1] = 0x12;
+      serial_id[2] = 0x74;
+      serial_id[3] = id & 0xff;
+      serial_id[4] = id >> 8;
+      serial_id[5] = id & 0xff;
+      serial_id[6] = (id & 0xff) ^ (id >> 8);
+      serial_id[7] = id & 0xff;
+      random_init(id);
+    } else {
+      fprintf(stderr, "Ignoring NATIVE_NODE_ID %s\n", env);
     }
   }
+  memcpy(ds2411_id, serial_id, sizeof(ds2411_id));
 }
-const static struct select_callback stdin_fd = {
-  stdin_set_fd, stdin_handle_fd
-};
 /*---------------------------------------------------------------------------*/
 static void
 set_rime_addr(void)
@@ -148,7 +545,14 @@ set_rime_addr(void)
 
   memset(&addr, 0, sizeof(linkaddr_t));
 #if NETSTACK_CONF_WITH_IPV6
-  memcpy(addr.u8, serial_id, sizeof(addr.u8));
+  if(sizeof(addr.u8) < sizeof(serial_id)) {
+    /* Short addresses are taken from the end of the EUI-64, as on sky */
+    for(i = 0; i < sizeof(linkaddr_t); ++i) {
+      addr.u8[i] = serial_id[7 - i];
+    }
+  } else {
+    memcpy(addr.u8, serial_id, sizeof(addr.u8));
+  }
 #else
   if(node_id == 0) {
     for(i = 0; i < sizeof(linkaddr_t); ++i) {
@@ -210,6 +614,7 @@ main(int argc, char **argv)
   process_start(&ctk_process, NULL);
 #endif
 
+  set_serial_id();
   set_rime_addr();
 
   netstack_init();
@@ -218,7 +623,7 @@ main(int argc, char **argv)
 #if NETSTACK_CONF_WITH_IPV6
   queuebuf_init();
 
-  memcpy(&uip_lladdr.addr, serial_id, sizeof(uip_lladdr.addr));
+  memcpy(&uip_lladdr.addr, &linkaddr_node_addr, sizeof(uip_lladdr.addr));
 
   process_start(&tcpip_process, NULL);
 #ifdef __CYGWIN__
@@ -249,42 +654,18 @@ main(int argc, char **argv)
   /* Make standard output unbuffered. */
   setvbuf(stdout, (char *)NULL, _IONBF, 0);
 
-  select_set_callback(STDIN_FILENO, &stdin_fd);
+#if NATIVE_CONF_EPOLL
+  epoll_init();
+#endif /* NATIVE_CONF_EPOLL */
+
+  select_register_fd(STDIN_FILENO, SELECT_FD_READ, stdin_handle_fd, NULL);
   while(1) {
-    fd_set fdr;
-    fd_set fdw;
-    int maxfd;
-    int i;
     int retval;
-    struct timeval tv;
 
     retval = process_run();
 
-    tv.tv_sec = 0;
-    tv.tv_usec = retval ? 1 : 1000;
-
-    FD_ZERO(&fdr);
-    FD_ZERO(&fdw);
-    maxfd = 0;
-    for(i = 0; i <= select_max; i++) {
-      if(select_callback[i] != NULL && select_callback[i]->set_fd(&fdr, &fdw)) {
-        maxfd = i;
-      }
-    }
-
-    retval = select(maxfd + 1, &fdr, &fdw, NULL, &tv);
-    if(retval < 0) {
-      if(errno != EINTR) {
-        perror("select");
-      }
-    } else if(retval > 0) {
-      /* timeout => retval == 0 */
-      for(i = 0; i <= maxfd; i++) {
-        if(select_callback[i] != NULL) {
-          select_callback[i]->handle_fd(&fdr, &fdw);
-        }
-      }
-    }
+    /* Sleep until the next timer expires or a file descriptor is ready */
+    select_poll(retval);
 
     etimer_request_poll();
 
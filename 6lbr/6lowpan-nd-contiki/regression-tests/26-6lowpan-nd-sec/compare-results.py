@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+#
+# Compare two results.csv of the scaling simulations, typically one from
+# the parent commit and one from the change under test.
+#
+# Usage: compare-results.py [--tolerance 0.1] baseline.csv new.csv
+#
+# Rows are matched on the node count. For each metric that should not go
+# up, a value more than the tolerance (relative) above the baseline is a
+# regression, and so is a node count where fewer 6LNs registered. Prints a
+# table of both runs and exits with 1 if anything regressed.
+
+import argparse
+import csv
+import sys
+
+# Lower is better for all of these
+METRICS = ["all_registered_ms", "ns_sent", "ns_retx", "rs_sent",
+           "lbr_auth_fail", "lbr_cpu_ms", "lbr_cpu_permil",
+           "lbr_radio_permil", "node_energy_mean_mj", "node_energy_max_mj"]
+
+def load(path):
+    rows = {}
+    with open(path) as f:
+        for row in csv.DictReader(f):
+            # With several seeds per node count, keep the worst run
+            n = int(row["nodes"])
+            if n not in rows or int(row["registered"]) < int(rows[n]["registered"]):
+                rows[n] = row
+    return rows
+
+def regressed(old, new, tolerance):
+    if old < 0 or new < 0:
+        # -1: not everyone registered, handled with the registered column,
+        # or not measured (CPU, radio and energy of native runs)
+        return False
+    return new > old * (1 + tolerance) and new - old >= 1
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--tolerance", type=float, default=0.1)
+    parser.add_argument("baseline")
+    parser.add_argument("new")
+    args = parser.parse_args()
+
+    base = load(args.baseline)
+    new = load(args.new)
+    failed = False
+
+    for n in sorted(set(base) | set(new)):
+        if n not in base or n not in new:
+            print("%d nodes: only in %s" %
+                  (n, args.baseline if n in base else args.new))
+            continue
+        b, c = base[n], new[n]
+        print("%d nodes (%s -> %s)" % (n, b["commit"], c["commit"]))
+        if int(c["registered"]) < int(b["registered"]):
+            print("  %-20s %10s %10s  REGRESSION" %
+                  ("registered", b["registered"], c["registered"]))
+            failed = True
+        for m in METRICS:
+            old, cur = float(b[m]), float(c[m])
+            mark = ""
+            if regressed(old, cur, args.tolerance):
+                mark = "  REGRESSION"
+                failed = True
+            print("  %-20s %10s %10s%s" % (m, b[m], c[m], mark))
+
+    sys.exit(1 if failed else 0)
+
+if __name__ == "__main__":
+    main()
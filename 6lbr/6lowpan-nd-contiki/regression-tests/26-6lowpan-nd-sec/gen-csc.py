@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+#
+# Generate the scaling simulations of the secured registration: one 6LBR
+# (sky mote 1, ../../../lbr.c) in the middle and N 6LNs (sky motes 2..N+1,
+# ../../../../6ln/ln1.c) around it, all in range of the 6LBR.
+#
+# Usage: gen-csc.py [N ...]
+#
+# Without arguments it rewrites the committed 01-nd-sec-5n.csc and
+# 02-nd-sec-10n.csc. The 6LNs sit on a sunflower spiral, so the layout
+# only depends on N and the files do not change between runs. Beyond
+# MAX_NODES the registrations of the 6LBR no longer fit in sky RAM, those
+# node counts run natively with run-native.py.
+
+import math
+import sys
+
+NODES = [5, 10]
+MAX_NODES = 10
+
+LBR_X = 50.0
+LBR_Y = 50.0
+# Well inside the UDGM transmitting range: every 6LN hears the 6LBR
+RADIUS = 40.0
+TX_RANGE = 50.0
+INTERFERENCE_RANGE = 100.0
+
+INTERFACES = """\
+      <moteinterface>org.contikios.cooja.interfaces.Position</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.RimeAddress</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.IPAddress</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.Mote2MoteRelations</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.MoteAttributes</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspClock</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspMoteID</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.SkyButton</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.SkyFlash</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.SkyCoffeeFilesystem</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.Msp802154Radio</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspSerial</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.SkyLED</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspDebugOutput</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.SkyTemperature</moteinterface>
+"""
+
+HEADER = """\
+<?xml version="1.0" encoding="UTF-8"?>
+<!-- Generated by gen-csc.py, do not edit -->
+<simconf>
+  <project EXPORT="discard">[APPS_DIR]/mrm</project>
+  <project EXPORT="discard">[APPS_DIR]/mspsim</project>
+  <project EXPORT="discard">[APPS_DIR]/avrora</project>
+  <project EXPORT="discard">[APPS_DIR]/serial_socket</project>
+  <project EXPORT="discard">[APPS_DIR]/powertracker</project>
+  <simulation>
+    <title>Secured 6LoWPAN-ND registration, 1 6LBR and {n} 6LNs</title>
+    <randomseed>123456</randomseed>
+    <motedelay_us>1000000</motedelay_us>
+    <radiomedium>
+      org.contikios.cooja.radiomediums.UDGM
+      <transmitting_range>{tx_range:.1f}</transmitting_range>
+      <interference_range>{interference_range:.1f}</interference_range>
+      <success_ratio_tx>1.0</success_ratio_tx>
+      <success_ratio_rx>1.0</success_ratio_rx>
+    </radiomedium>
+    <events>
+      <logoutput>40000</logoutput>
+    </events>
+    <motetype>
+      org.contikios.cooja.mspmote.SkyMoteType
+      <identifier>sky1</identifier>
+      <description>6lbr</description>
+      <source EXPORT="discard">[CONFIG_DIR]/../../../lbr.c</source>
+      <commands EXPORT="discard">make clean TARGET=sky
+make lbr.sky TARGET=sky MAKE_WITH_TRACE_OUTPUT=1 SIM_NODES={n}</commands>
+      <firmware EXPORT="copy">[CONFIG_DIR]/../../../lbr.sky</firmware>
+{interfaces}    </motetype>
+    <motetype>
+      org.contikios.cooja.mspmote.SkyMoteType
+      <identifier>sky2</identifier>
+      <description>6ln</description>
+      <source EXPORT="discard">[CONFIG_DIR]/../../../../6ln/ln1.c</source>
+      <commands EXPORT="discard">make clean TARGET=sky
+make ln1.sky TARGET=sky MAKE_WITH_TRACE_OUTPUT=1</commands>
+      <firmware EXPORT="copy">[CONFIG_DIR]/../../../../6ln/ln1.sky</firmware>
+{interfaces}    </motetype>
+"""
+
+MOTE = """\
+    <mote>
+      <breakpoints />
+      <interface_config>
+        org.contikios.cooja.interfaces.Position
+        <x>{x:.2f}</x>
+        <y>{y:.2f}</y>
+        <z>0.0</z>
+      </interface_config>
+      <interface_config>
+        org.contikios.cooja.mspmote.interfaces.MspClock
+        <deviation>1.0</deviation>
+      </interface_config>
+      <interface_config>
+        org.contikios.cooja.mspmote.interfaces.MspMoteID
+        <id>{id}</id>
+      </interface_config>
+      <motetype_identifier>{type}</motetype_identifier>
+    </mote>
+"""
+
+FOOTER = """\
+  </simulation>
+  <plugin>
+    org.contikios.cooja.plugins.SimControl
+    <width>280</width>
+    <z>0</z>
+    <height>160</height>
+    <location_x>400</location_x>
+    <location_y>0</location_y>
+  </plugin>
+  <plugin>
+    org.contikios.cooja.plugins.ScriptRunner
+    <plugin_config>
+      <scriptfile>[CONFIG_DIR]/js/nd-sec-scaling.js</scriptfile>
+      <active>true</active>
+    </plugin_config>
+    <width>600</width>
+    <z>1</z>
+    <height>700</height>
+    <location_x>0</location_x>
+    <location_y>160</location_y>
+  </plugin>
+</simconf>
+"""
+
+def positions(n):
+    # Sunflower spiral: equal area per node, no two nodes on top of each other
+    golden_angle = math.pi * (3 - math.sqrt(5))
+    for i in range(n):
+        r = RADIUS * math.sqrt((i + 0.5) / n)
+        a = i * golden_angle
+        yield LBR_X + r * math.cos(a), LBR_Y + r * math.sin(a)
+
+def simulation(n):
+    out = [HEADER.format(n=n, tx_range=TX_RANGE,
+                         interference_range=INTERFERENCE_RANGE,
+                         interfaces=INTERFACES)]
+    out.append(MOTE.format(x=LBR_X, y=LBR_Y, id=1, type="sky1"))
+    for i, (x, y) in enumerate(positions(n)):
+        out.append(MOTE.format(x=x, y=y, id=i + 2, type="sky2"))
+    out.append(FOOTER)
+    return "".join(out)
+
+def main():
+    nodes = [int(a) for a in sys.argv[1:]] or NODES
+    for i, n in enumerate(nodes):
+        if n < 1 or n > MAX_NODES:
+            sys.exit("gen-csc.py: %d 6LNs do not fit in a sky 6LBR, "
+                     "use run-native.py" % n)
+        name = "%02d-nd-sec-%dn.csc" % (i + 1, n)
+        with open(name, "w") as f:
+            f.write(simulation(n))
+        print(name)
+
+if __name__ == "__main__":
+    main()
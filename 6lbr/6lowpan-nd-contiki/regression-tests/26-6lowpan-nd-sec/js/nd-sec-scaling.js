@@ -0,0 +1,142 @@
+/*
+ * Secured registration of N 6LNs around one 6LBR (mote 1).
+ *
+ * Counts from the nd6-trace records ("#T" lines) and the nd6-stats
+ * counters ("ND6stats ... N" lines) of the motes, which are printed
+ * whatever the debug level of the ND code. Passes when every 6LN has
+ * received an NA with ARO status 0 and the 6LBR rejected no NS on the
+ * way. Either way, one line
+ *
+ *   CSV nodes,seed,registered,all_registered_ms,ns_sent,ns_retx,rs_sent,
+ *       lbr_auth_fail,lbr_cpu_ms,lbr_cpu_permil,lbr_radio_permil,
+ *       node_energy_mean_mj,node_energy_max_mj
+ *
+ * goes to the test log for the Makefile to collect. The counters stop when
+ * the last 6LN registers; CPU and energy come from the last powertrace
+ * line of each mote before that.
+ */
+TIMEOUT(3600000, log.log("only " + done + "/" + nodes + " 6LNs registered\n"); csv(-1); log.testFailed(); );
+
+/* Tmote Sky: rtimer ticks per second, supply voltage, current draw in mA */
+RTIMER_SECOND = 32768;
+VOLTAGE = 3.0;
+CURRENT_CPU = 1.8;
+CURRENT_LPM = 0.0545;
+CURRENT_TX = 17.7;
+CURRENT_LISTEN = 20.0;
+
+nodes = sim.getMotesCount() - 1;
+registered = new Array();
+done = 0;
+ns_sent = 0;
+rs_sent = 0;
+auth_fail = 0;
+/* NS the 6LBR rejected according to its trace, and to its counters */
+trace_rejected = 0;
+stats_rejected = 0;
+/* Per mote: [all_cpu, all_lpm, all_transmit, all_listen] */
+power = new Array();
+
+/* Events of core/net/ipv6/nd6-trace.h */
+TRACE_DROPPED = 0x01;
+TRACE_RS_OUT = 0x03;
+TRACE_NS_OUT = 0x07;
+TRACE_NA_IN = 0x08;
+TRACE_ARO_UNAUTH = 0x0a;
+TRACE_NONCE = 0x0b;
+TRACE_AUTH = 0x0d;
+
+/* [event, arg8] of a "#T" line: the hex dump of time (4), arg (2), event
+ * and arg8, followed by the data */
+function trace(line) {
+  var i = line.indexOf("#T");
+  if(i < 0 || line.length < i + 18) {
+    return null;
+  }
+  return [parseInt(line.substr(i + 14, 2), 16),
+          parseInt(line.substr(i + 16, 2), 16)];
+}
+
+/* Energy of a mote since boot, in mJ */
+function energy(p) {
+  return (p[0] * CURRENT_CPU + p[1] * CURRENT_LPM +
+          p[2] * CURRENT_TX + p[3] * CURRENT_LISTEN) * VOLTAGE / RTIMER_SECOND;
+}
+
+function permil(part, p) {
+  var total = p[0] + p[1];
+  return total > 0 ? Math.round(1000 * part / total) : 0;
+}
+
+function csv(all_registered_ms) {
+  var lbr = power[1] != undefined ? power[1] : [0, 0, 0, 0];
+  var sum = 0;
+  var max = 0;
+  var count = 0;
+  for(var i = 2; i <= nodes + 1; i++) {
+    if(power[i] != undefined) {
+      var e = energy(power[i]);
+      sum += e;
+      max = Math.max(max, e);
+      count++;
+    }
+  }
+  log.log("CSV " + [nodes, sim.getRandomSeed(), done, all_registered_ms,
+                    ns_sent, ns_sent - done, rs_sent, auth_fail,
+                    Math.round(1000 * lbr[0] / RTIMER_SECOND),
+                    permil(lbr[0], lbr), permil(lbr[2] + lbr[3], lbr),
+                    (count > 0 ? sum / count : 0).toFixed(3),
+                    max.toFixed(3)].join(",") + "\n");
+}
+
+while(true) {
+  YIELD();
+  line = String(msg);
+  rec = trace(line);
+  fields = line.split(/\s+/);
+
+  if(id == 1) {
+    if(rec != null) {
+      if(rec[0] == TRACE_ARO_UNAUTH ||
+         ((rec[0] == TRACE_NONCE || rec[0] == TRACE_AUTH) && rec[1] == 0)) {
+        trace_rejected++;
+        log.log("6LBR rejected an NS at " + (time / 1000) + " ms: " + line + "\n");
+      } else if(rec[0] == TRACE_DROPPED) {
+        log.log("6LBR trace lost records at " + (time / 1000) + " ms\n");
+      }
+    }
+    /* "ND6stats <clock> N <addr> recv sent drop unautherr nonceerr autherr duperr" */
+    if(fields[0] == "ND6stats" && fields[2] == "N" && fields.length >= 11) {
+      stats_rejected = parseInt(fields[7]) + parseInt(fields[8]) +
+        parseInt(fields[9]);
+    }
+    auth_fail = Math.max(trace_rejected, stats_rejected);
+  } else if(rec != null && registered[id] == undefined) {
+    if(rec[0] == TRACE_NS_OUT) {
+      ns_sent++;
+    } else if(rec[0] == TRACE_RS_OUT) {
+      rs_sent++;
+    } else if(rec[0] == TRACE_NA_IN && rec[1] == 0) {
+      registered[id] = time;
+      done++;
+      log.log("mote " + id + " registered at " + (time / 1000) + " ms\n");
+      if(done == nodes) {
+        log.log("RESULT nd-sec: " + nodes + " 6LNs registered after " +
+                (time / 1000) + " ms\n");
+        csv(Math.round(time / 1000));
+        if(auth_fail > 0) {
+          log.testFailed();
+        } else {
+          log.testOK();
+        }
+      }
+    }
+  }
+
+  /* "<clock> P <addr> <seqno> <all_cpu> <all_lpm> <all_transmit> <all_listen> ..." */
+  p = fields.indexOf("P");
+  if(p >= 0 && fields.length > p + 6) {
+    power[id] = [parseInt(fields[p + 3]), parseInt(fields[p + 4]),
+                 parseInt(fields[p + 5]), parseInt(fields[p + 6])];
+  }
+}
@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+#
+# Run the scaling of the secured registration with more 6LNs than a sky
+# 6LBR can register: one 6LBR (../../../lbr.c, node 1) and N 6LNs
+# (../../../../6ln/ln1.c, nodes 2..N+1) as native processes on the UDP
+# multicast radio medium, see cpu/native/net/README-MCASTRADIO.md.
+#
+# Usage: run-native.py [--timeout 600] [--no-build] N [N ...]
+#
+# For each N, prints the same CSV line as js/nd-sec-scaling.js, counted
+# from the nd6-trace records and the nd6-stats counters of the nodes.
+# all_registered_ms is wall-clock time since the 6LBR started, the seed is
+# -1 (the run is not repeatable) and the CPU, radio and energy columns are
+# -1 (no powertrace on native). Exits with 1 if a run failed.
+
+import argparse
+import os
+import random
+import selectors
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+LBR_DIR = os.path.normpath(os.path.join(HERE, "../../.."))
+LN_DIR = os.path.normpath(os.path.join(HERE, "../../../../6ln"))
+MAKE_ARGS = ["TARGET=native", "MAKE_WITH_MCASTRADIO=1", "MAKE_WITH_TRACE_OUTPUT=1"]
+
+# Events of core/net/ipv6/nd6-trace.h
+TRACE_DROPPED = 0x01
+TRACE_RS_OUT = 0x03
+TRACE_NS_OUT = 0x07
+TRACE_NA_IN = 0x08
+TRACE_ARO_UNAUTH = 0x0a
+TRACE_NONCE = 0x0b
+TRACE_AUTH = 0x0d
+
+def trace(line):
+    # "#T" and the hex dump of time (4), arg (2), event and arg8
+    i = line.find("#T")
+    if i < 0 or len(line) < i + 18:
+        return None
+    try:
+        return int(line[i + 14:i + 16], 16), int(line[i + 16:i + 18], 16)
+    except ValueError:
+        return None
+
+def stats_rejected(line):
+    # "ND6stats <clock> N <addr> recv sent drop unautherr nonceerr autherr duperr"
+    fields = line.split()
+    if len(fields) < 11 or fields[0] != "ND6stats" or fields[2] != "N":
+        return None
+    return sum(int(f) for f in fields[7:10])
+
+def clean(directory, target):
+    # Not "make clean", that also removes the committed sky build
+    shutil.rmtree(os.path.join(directory, "obj_native"), ignore_errors=True)
+    for f in [target, "contiki-native.a", "contiki-native.map"]:
+        if os.path.exists(os.path.join(directory, f)):
+            os.remove(os.path.join(directory, f))
+
+def build(directory, target, extra, out):
+    clean(directory, target)
+    with open(out + ".log", "w") as log:
+        status = subprocess.call(["make", "-C", directory] + MAKE_ARGS +
+                                 extra + [target], stdout=log, stderr=log)
+    if status == 0:
+        shutil.copy(os.path.join(directory, target), out)
+    clean(directory, target)
+    if status != 0:
+        sys.exit("run-native.py: %s failed, see %s.log" % (target, out))
+
+def run(n, lbr, ln, timeout, work):
+    env = dict(os.environ, MCASTRADIO_PORT=str(random.randint(20000, 40000)))
+    sel = selectors.DefaultSelector()
+    procs = []
+
+    def start(binary, node_id):
+        # Each node in its own directory, for its CFS files (the 6LN
+        # keeps its nonce counter there)
+        cwd = os.path.join(work, "node-%d" % node_id)
+        shutil.rmtree(cwd, ignore_errors=True)
+        os.makedirs(cwd)
+        p = subprocess.Popen([binary], stdout=subprocess.PIPE,
+                             stderr=subprocess.STDOUT, cwd=cwd,
+                             env=dict(env, NATIVE_NODE_ID=str(node_id)))
+        procs.append(p)
+        sel.register(p.stdout, selectors.EVENT_READ, (node_id, bytearray()))
+
+    started = time.monotonic()
+    start(lbr, 1)
+    for node_id in range(2, n + 2):
+        start(ln, node_id)
+
+    registered = set()
+    all_registered_ms = -1
+    ns_sent = rs_sent = 0
+    trace_rejected = stats = 0
+    try:
+        while time.monotonic() - started < timeout and procs[0].poll() is None:
+            for key, _ in sel.select(timeout=1):
+                node_id, buf = key.data
+                data = os.read(key.fileobj.fileno(), 4096)
+                if not data:
+                    sel.unregister(key.fileobj)
+                    continue
+                buf += data
+                while b"\n" in buf:
+                    raw, _, rest = buf.partition(b"\n")
+                    buf[:] = rest
+                    line = raw.decode("ascii", "replace")
+                    rec = trace(line)
+                    if node_id == 1:
+                        if rec is None:
+                            rejected = stats_rejected(line)
+                            if rejected is not None:
+                                stats = rejected
+                        elif (rec[0] == TRACE_ARO_UNAUTH or
+                              (rec[0] in (TRACE_NONCE, TRACE_AUTH) and
+                               rec[1] == 0)):
+                            trace_rejected += 1
+                        elif rec[0] == TRACE_DROPPED:
+                            print("6LBR trace lost records", file=sys.stderr)
+                    elif rec is not None and node_id not in registered:
+                        if rec[0] == TRACE_NS_OUT:
+                            ns_sent += 1
+                        elif rec[0] == TRACE_RS_OUT:
+                            rs_sent += 1
+                        elif rec[0] == TRACE_NA_IN and rec[1] == 0:
+                            registered.add(node_id)
+            if len(registered) == n:
+                all_registered_ms = round(1000 * (time.monotonic() - started))
+                break
+    finally:
+        for p in procs:
+            p.kill()
+            p.wait()
+
+    auth_fail = max(trace_rejected, stats)
+    print("%d/%d 6LNs registered, %d NS rejected" %
+          (len(registered), n, auth_fail), file=sys.stderr)
+    print("CSV " + ",".join(str(v) for v in [
+        n, -1, len(registered), all_registered_ms, ns_sent,
+        ns_sent - len(registered), rs_sent, auth_fail,
+        -1, -1, -1, -1, -1]))
+    return len(registered) == n and auth_fail == 0
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--timeout", type=float, default=600,
+                        help="seconds to wait for all 6LNs to register")
+    parser.add_argument("--no-build", action="store_true",
+                        help="use lbr.native and ln1.native from a previous run")
+    parser.add_argument("nodes", type=int, nargs="+")
+    args = parser.parse_args()
+
+    work = os.path.join(tempfile.gettempdir(), "nd-sec-native")
+    os.makedirs(work, exist_ok=True)
+    ln = os.path.join(work, "ln1.native")
+    if not args.no_build:
+        build(LN_DIR, "ln1.native", [], ln)
+
+    ok = True
+    for n in args.nodes:
+        lbr = os.path.join(work, "lbr-%d.native" % n)
+        if not args.no_build:
+            build(LBR_DIR, "lbr.native", ["SIM_NODES=%d" % n], lbr)
+        ok = run(n, lbr, ln, args.timeout, work) and ok
+    sys.exit(0 if ok else 1)
+
+if __name__ == "__main__":
+    main()
@@ -64,24 +64,62 @@
 speed_t b_rate = BAUDRATE;
 
 int verbose = 1;
-const char *ipaddr;
-const char *netmask;
-int slipfd = 0;
-uint16_t basedelay=0,delaymsec=0;
-uint32_t startsec,startmsec,delaystartsec,delaystartmsec;
+uint16_t basedelay=0;
 int timestamp = 0, flowcontrol=0, showprogress=0, flowcontrol_xonxoff=0;
 
+/* Serial lines, and tun interfaces, served by one process */
+#define MAX_PORTS 8
+
+/* Largest packet read from a tun or a serial line */
+#define PACKET_SIZE 2000
+/* Bytes taken from a serial line per read() */
+#define SERIAL_READ_SIZE 4096
+/* Encoded packets waiting for a serial line. It holds several, so that
+   all packets the tun has ready go out in one write(). */
+#define SLIP_OUT_SIZE 16384
+/* Worst case encoding of a packet */
+#define SLIP_OUT_MAX (2 * PACKET_SIZE + 1)
+
+struct tun {
+  int fd;
+  char dev[1024];
+  const char *ipaddr;
+};
+
+struct port {
+  int fd;
+  const char *siodev;		/* NULL for a TCP connection */
+  struct tun *tun;
+
+  /* Packet being received */
+  unsigned char inbuf[PACKET_SIZE];
+  int inbufptr;
+  unsigned char esc;		/* The last byte was SLIP_ESC */
+  unsigned char dropping;	/* Too large, skip to the next SLIP_END */
+
+  /* Encoded packets being sent */
+  unsigned char outbuf[SLIP_OUT_SIZE];
+  int out_begin, out_end;
+
+  /* -d: nothing from the tun until delaymsec after delaystart */
+  uint16_t delaymsec;
+  uint32_t delaystartsec, delaystartmsec;
+};
+
+struct port ports[MAX_PORTS];
+int nports;
+struct tun tuns[MAX_PORTS];
+int ntuns;
+
 int ssystem(const char *fmt, ...)
      __attribute__((__format__ (__printf__, 1, 2)));
-void write_to_serial(int outfd, void *inbuf, int len);
+void write_to_serial(struct port *p, const unsigned char *inbuf, int len);
 
-void slip_send(int fd, unsigned char c);
-void slip_send_char(int fd, unsigned char c);
+void slip_send(struct port *p, unsigned char c);
+void slip_send_char(struct port *p, unsigned char c);
 
 #define PROGRESS(s) if(showprogress) fprintf(stderr, s)
 
-char tundev[1024] = { "" };
-
 /* IPv6 required minimum MTU */
 #define MIN_DEVMTU 1500
 int devmtu = MIN_DEVMTU;
@@ -164,271 +202,412 @@ is_sensible_string(const unsigned char *s, int len)
   return 1;
 }
 
-/*
- * Read from serial, when we have a packet write it to tun. No output
- * buffering, input buffered by stdio.
- */
+/* What a byte on a serial line is to the decoder, 0 for data */
+#define SLIP_IN_END 1
+#define SLIP_IN_ESC 2
+unsigned char slip_in_class[256];
+
+/* What a byte of a packet is escaped to on a serial line, 0 if it is
+   sent as it is */
+unsigned char slip_out_esc[256];
+
 void
-serial_to_tun(FILE *inslip, int outfd)
+slip_tables_init(void)
 {
-  static union {
-    unsigned char inbuf[2000];
-  } uip;
-  static int inbufptr = 0;
-  int ret,i;
-  unsigned char c;
+  slip_in_class[SLIP_END] = SLIP_IN_END;
+  slip_in_class[SLIP_ESC] = SLIP_IN_ESC;
 
-#ifdef linux
-  ret = fread(&c, 1, 1, inslip);
-  if(ret == -1 || ret == 0) err(1, "serial_to_tun: read");
-  goto after_fread;
-#endif
+  slip_out_esc[SLIP_END] = SLIP_ESC_END;
+  slip_out_esc[SLIP_ESC] = SLIP_ESC_ESC;
+  if(flowcontrol_xonxoff) {
+    slip_out_esc[XON] = SLIP_ESC_XON;
+    slip_out_esc[XOFF] = SLIP_ESC_XOFF;
+  }
+}
 
- read_more:
-  if(inbufptr >= sizeof(uip.inbuf)) {
-     if(timestamp) stamptime();
-     fprintf(stderr, "*** dropping large %d byte packet\n",inbufptr);
-	 inbufptr = 0;
+/* Print where the output that follows came from, if there is a choice */
+void
+port_label(struct port *p)
+{
+  if(nports > 1) {
+    printf("[%s] ", p->siodev != NULL ? p->siodev : "tcp");
   }
-  ret = fread(&c, 1, 1, inslip);
-#ifdef linux
- after_fread:
-#endif
-  if(ret == -1) {
-    err(1, "serial_to_tun: read");
+}
+
+/*
+ * With one tun for several ports: the port each address was last seen
+ * behind, so that packets for it go to that port only. Direct mapped
+ * on the interface identifier, a miss sends the packet to all ports.
+ */
+#define ROUTE_SIZE 256
+struct route {
+  unsigned char addr[16];
+  struct port *port;
+};
+struct route routes[ROUTE_SIZE];
+
+struct route *
+route_entry(const unsigned char *addr)
+{
+  unsigned h;
+  int i;
+
+  for(h = 0, i = 8; i < 16; i++) {
+    h = h * 31 + addr[i];
   }
-  if(ret == 0) {
-    clearerr(inslip);
+  return &routes[h % ROUTE_SIZE];
+}
+
+void
+route_learn(struct port *p, const unsigned char *pkt, int len)
+{
+  struct route *r;
+
+  if(len < 40 || (pkt[0] >> 4) != 6) {
     return;
   }
-  PROGRESS(".");
-  switch(c) {
-  case SLIP_END:
-    if(inbufptr > 0) {
-      if(uip.inbuf[0] == '!') {
-	if(uip.inbuf[1] == 'M') {
-	  /* Read gateway MAC address and autoconfigure tap0 interface */
-	  char macs[24];
-	  int i, pos;
-	  for(i = 0, pos = 0; i < 16; i++) {
-	    macs[pos++] = uip.inbuf[2 + i];
-	    if((i & 1) == 1 && i < 14) {
-	      macs[pos++] = ':';
-	    }
-	  }
-          if(timestamp) stamptime();
-	  macs[pos] = '\0';
-//	  printf("*** Gateway's MAC address: %s\n", macs);
-	  fprintf(stderr,"*** Gateway's MAC address: %s\n", macs);
-          if (timestamp) stamptime();
-	  ssystem("ifconfig %s down", tundev);
-          if (timestamp) stamptime();
-	  ssystem("ifconfig %s hw ether %s", tundev, &macs[6]);
-          if (timestamp) stamptime();
-	  ssystem("ifconfig %s up", tundev);
+  r = route_entry(pkt + 8);
+  memcpy(r->addr, pkt + 8, 16);
+  r->port = p;
+}
+
+struct port *
+route_lookup(const unsigned char *pkt, int len)
+{
+  struct route *r;
+
+  if(len < 40 || (pkt[0] >> 4) != 6 || pkt[24] == 0xff) {
+    return NULL;
+  }
+  r = route_entry(pkt + 24);
+  if(r->port != NULL && memcmp(r->addr, pkt + 24, 16) == 0) {
+    return r->port;
+  }
+  return NULL;
+}
+
+/*
+ * A complete packet from a serial line: a command, debug output or an
+ * IP packet for the tun.
+ */
+void
+packet_input(struct port *p)
+{
+  unsigned char *inbuf = p->inbuf;
+  int inbufptr = p->inbufptr;
+  int i;
+
+  if(inbuf[0] == '!') {
+    if(inbuf[1] == 'M') {
+      /* Read gateway MAC address and autoconfigure tap0 interface */
+      char macs[24];
+      int i, pos;
+      for(i = 0, pos = 0; i < 16; i++) {
+	macs[pos++] = inbuf[2 + i];
+	if((i & 1) == 1 && i < 14) {
+	  macs[pos++] = ':';
 	}
-      } else if(uip.inbuf[0] == '?') {
-	if(uip.inbuf[1] == 'P') {
-          /* Prefix info requested */
-          struct in6_addr addr;
-	  int i;
-	  char *s = strchr(ipaddr, '/');
-	  if(s != NULL) {
-	    *s = '\0';
-	  }
-          inet_pton(AF_INET6, ipaddr, &addr);
-          if(timestamp) stamptime();
-          fprintf(stderr,"*** Address:%s => %02x%02x:%02x%02x:%02x%02x:%02x%02x\n",
-		 ipaddr,
-		 addr.s6_addr[0], addr.s6_addr[1],
-		 addr.s6_addr[2], addr.s6_addr[3],
-		 addr.s6_addr[4], addr.s6_addr[5],
-		 addr.s6_addr[6], addr.s6_addr[7]);
-	  slip_send(slipfd, '!');
-	  slip_send(slipfd, 'P');
-	  for(i = 0; i < 8; i++) {
-	    /* need to call the slip_send_char for stuffing */
-	    slip_send_char(slipfd, addr.s6_addr[i]);
-	  }
-	  slip_send(slipfd, SLIP_END);
-        }
+      }
+      if(timestamp) stamptime();
+      macs[pos] = '\0';
+//	  printf("*** Gateway's MAC address: %s\n", macs);
+      fprintf(stderr,"*** Gateway's MAC address: %s\n", macs);
+      if (timestamp) stamptime();
+      ssystem("ifconfig %s down", p->tun->dev);
+      if (timestamp) stamptime();
+      ssystem("ifconfig %s hw ether %s", p->tun->dev, &macs[6]);
+      if (timestamp) stamptime();
+      ssystem("ifconfig %s up", p->tun->dev);
+    }
+  } else if(inbuf[0] == '?') {
+    if(inbuf[1] == 'P') {
+      /* Prefix info requested */
+      struct in6_addr addr;
+      char ipaddr[INET6_ADDRSTRLEN];
+      int i;
+      char *s;
+      strncpy(ipaddr, p->tun->ipaddr, sizeof(ipaddr) - 1);
+      ipaddr[sizeof(ipaddr) - 1] = '\0';
+      s = strchr(ipaddr, '/');
+      if(s != NULL) {
+	*s = '\0';
+      }
+      inet_pton(AF_INET6, ipaddr, &addr);
+      if(timestamp) stamptime();
+      fprintf(stderr,"*** Address:%s => %02x%02x:%02x%02x:%02x%02x:%02x%02x\n",
+	      ipaddr,
+	      addr.s6_addr[0], addr.s6_addr[1],
+	      addr.s6_addr[2], addr.s6_addr[3],
+	      addr.s6_addr[4], addr.s6_addr[5],
+	      addr.s6_addr[6], addr.s6_addr[7]);
+      slip_send(p, '!');
+      slip_send(p, 'P');
+      for(i = 0; i < 8; i++) {
+	/* need to call the slip_send_char for stuffing */
+	slip_send_char(p, addr.s6_addr[i]);
+      }
+      slip_send(p, SLIP_END);
+    }
 #define DEBUG_LINE_MARKER '\r'
-      } else if(uip.inbuf[0] == DEBUG_LINE_MARKER) {
-	fwrite(uip.inbuf + 1, inbufptr - 1, 1, stdout);
-      } else if(is_sensible_string(uip.inbuf, inbufptr)) {
-        if(verbose==1) {   /* strings already echoed below for verbose>1 */
-          if (timestamp) stamptime();
-          fwrite(uip.inbuf, inbufptr, 1, stdout);
-        }
-      } else {
-        if(verbose>2) {
-          if (timestamp) stamptime();
-          printf("Packet from SLIP of length %d - write TUN\n", inbufptr);
-          if (verbose>4) {
+  } else if(inbuf[0] == DEBUG_LINE_MARKER) {
+    port_label(p);
+    fwrite(inbuf + 1, inbufptr - 1, 1, stdout);
+  } else if(is_sensible_string(inbuf, inbufptr)) {
+    if(verbose==1) {   /* strings already echoed below for verbose>1 */
+      if (timestamp) stamptime();
+      port_label(p);
+      fwrite(inbuf, inbufptr, 1, stdout);
+    }
+  } else {
+    if(verbose>2) {
+      if (timestamp) stamptime();
+      port_label(p);
+      printf("Packet from SLIP of length %d - write TUN\n", inbufptr);
+      if (verbose>4) {
 #if WIRESHARK_IMPORT_FORMAT
-            printf("0000");
-	        for(i = 0; i < inbufptr; i++) printf(" %02x",uip.inbuf[i]);
+	printf("0000");
+	for(i = 0; i < inbufptr; i++) printf(" %02x",inbuf[i]);
 #else
-            printf("         ");
-            for(i = 0; i < inbufptr; i++) {
-              printf("%02x", uip.inbuf[i]);
-              if((i & 3) == 3) printf(" ");
-              if((i & 15) == 15) printf("\n         ");
-            }
-#endif
-            printf("\n");
-          }
-        }
-	if(write(outfd, uip.inbuf, inbufptr) != inbufptr) {
-	  err(1, "serial_to_tun: write");
+	printf("         ");
+	for(i = 0; i < inbufptr; i++) {
+	  printf("%02x", inbuf[i]);
+	  if((i & 3) == 3) printf(" ");
+	  if((i & 15) == 15) printf("\n         ");
 	}
+#endif
+	printf("\n");
       }
-      inbufptr = 0;
     }
-    break;
-
-  case SLIP_ESC:
-    if(fread(&c, 1, 1, inslip) != 1) {
-      clearerr(inslip);
-      /* Put ESC back and give up! */
-      ungetc(SLIP_ESC, inslip);
-      return;
+    if(ntuns < nports) {
+      route_learn(p, inbuf, inbufptr);
+    }
+    if(write(p->tun->fd, inbuf, inbufptr) != inbufptr) {
+      err(1, "serial_to_tun: write");
     }
+  }
+}
 
-    switch(c) {
-    case SLIP_ESC_END:
-      c = SLIP_END;
-      break;
-    case SLIP_ESC_ESC:
-      c = SLIP_ESC;
-      break;
-    case SLIP_ESC_XON:
-      c = XON;
-      break;
-    case SLIP_ESC_XOFF:
-      c = XOFF;
-      break;
+/*
+ * Add one byte to the packet being received. Slow path for escaped
+ * bytes and for the verbosity levels that echo every byte.
+ */
+void
+slip_store(struct port *p, unsigned char c)
+{
+  if(p->dropping) {
+    return;
+  }
+  if(p->inbufptr >= sizeof(p->inbuf)) {
+    if(timestamp) stamptime();
+    fprintf(stderr, "*** dropping large %d byte packet\n", p->inbufptr);
+    p->inbufptr = 0;
+    p->dropping = 1;
+    return;
+  }
+  p->inbuf[p->inbufptr++] = c;
+
+  /* Echo lines as they are received for verbose=2,3,5+ */
+  /* Echo all printable characters for verbose==4 */
+  if((verbose==2) || (verbose==3) || (verbose>4)) {
+    if(c=='\n') {
+      if(is_sensible_string(p->inbuf, p->inbufptr)) {
+	if (timestamp) stamptime();
+	port_label(p);
+	fwrite(p->inbuf, p->inbufptr, 1, stdout);
+	p->inbufptr=0;
+      }
+    }
+  } else if(verbose==4) {
+    if(c == 0 || c == '\r' || c == '\n' || c == '\t' || (c >= ' ' && c <= '~')) {
+      fwrite(&c, 1, 1, stdout);
+      if(c=='\n') if(timestamp) stamptime();
     }
-    /* FALLTHROUGH */
-  default:
-    uip.inbuf[inbufptr++] = c;
-
-    /* Echo lines as they are received for verbose=2,3,5+ */
-    /* Echo all printable characters for verbose==4 */
-    if((verbose==2) || (verbose==3) || (verbose>4)) {
-      if(c=='\n') {
-        if(is_sensible_string(uip.inbuf, inbufptr)) {
-          if (timestamp) stamptime();
-          fwrite(uip.inbuf, inbufptr, 1, stdout);
-          inbufptr=0;
-        }
+  }
+}
+
+/*
+ * Decode what was read from a serial line. Runs of data bytes are
+ * found with the class table and copied at once; only SLIP_END,
+ * SLIP_ESC and the byte after it are handled one by one.
+ */
+void
+slip_input(struct port *p, const unsigned char *buf, int len)
+{
+  const unsigned char *end = buf + len;
+  const unsigned char *run;
+  unsigned char c;
+  int n;
+
+  while(buf < end) {
+    if(p->esc) {
+      p->esc = 0;
+      c = *buf++;
+      switch(c) {
+      case SLIP_ESC_END:
+	c = SLIP_END;
+	break;
+      case SLIP_ESC_ESC:
+	c = SLIP_ESC;
+	break;
+      case SLIP_ESC_XON:
+	c = XON;
+	break;
+      case SLIP_ESC_XOFF:
+	c = XOFF;
+	break;
       }
-    } else if(verbose==4) {
-      if(c == 0 || c == '\r' || c == '\n' || c == '\t' || (c >= ' ' && c <= '~')) {
-	fwrite(&c, 1, 1, stdout);
-        if(c=='\n') if(timestamp) stamptime();
+      slip_store(p, c);
+    } else if(slip_in_class[*buf] == SLIP_IN_END) {
+      buf++;
+      if(p->inbufptr > 0 && !p->dropping) {
+	packet_input(p);
+      }
+      p->inbufptr = 0;
+      p->dropping = 0;
+    } else if(slip_in_class[*buf] == SLIP_IN_ESC) {
+      buf++;
+      p->esc = 1;
+    } else {
+      run = buf;
+      while(++buf < end && slip_in_class[*buf] == 0);
+      n = buf - run;
+      if(verbose >= 2 || p->dropping ||
+	 p->inbufptr + n > sizeof(p->inbuf)) {
+	while(run < buf) {
+	  slip_store(p, *run++);
+	}
+      } else {
+	memcpy(p->inbuf + p->inbufptr, run, n);
+	p->inbufptr += n;
       }
     }
-
-    break;
   }
-
-  goto read_more;
 }
 
-unsigned char slip_buf[2000];
-int slip_end, slip_begin;
-
+/*
+ * Read from serial, when we have a packet write it to tun. No output
+ * buffering, input read in large chunks.
+ */
 void
-slip_send_char(int fd, unsigned char c)
+serial_to_tun(struct port *p)
 {
-  switch(c) {
-  case SLIP_END:
-    slip_send(fd, SLIP_ESC);
-    slip_send(fd, SLIP_ESC_END);
-    break;
-  case SLIP_ESC:
-    slip_send(fd, SLIP_ESC);
-    slip_send(fd, SLIP_ESC_ESC);
-    break;
-  case XON:
-    if(flowcontrol_xonxoff) {
-      slip_send(fd, SLIP_ESC);
-      slip_send(fd, SLIP_ESC_XON);
-    } else {
-      slip_send(fd, c);
+  unsigned char buf[SERIAL_READ_SIZE];
+  int ret, i;
+
+  ret = read(p->fd, buf, sizeof(buf));
+  if(ret == -1) {
+    if(errno == EAGAIN || errno == EINTR) {
+      return;
     }
-    break;
-  case XOFF:
-    if(flowcontrol_xonxoff) {
-      slip_send(fd, SLIP_ESC);
-      slip_send(fd, SLIP_ESC_XOFF);
-    } else {
-      slip_send(fd, c);
+    err(1, "serial_to_tun: read");
+  }
+  if(ret == 0) {
+    if(p->siodev == NULL) {
+      errx(1, "serial_to_tun: connection closed");
     }
-    break;
-  default:
-    slip_send(fd, c);
-    break;
+    return;
   }
+  if(showprogress) {
+    for(i = 0; i < ret; i++) {
+      PROGRESS(".");
+    }
+  }
+  slip_input(p, buf, ret);
 }
 
 void
-slip_send(int fd, unsigned char c)
+slip_send_char(struct port *p, unsigned char c)
 {
-  if(slip_end >= sizeof(slip_buf)) {
+  if(slip_out_esc[c]) {
+    slip_send(p, SLIP_ESC);
+    slip_send(p, slip_out_esc[c]);
+  } else {
+    slip_send(p, c);
+  }
+}
+
+/* Make room for len more bytes at the end of the output buffer */
+unsigned char *
+slip_reserve(struct port *p, int len)
+{
+  if(p->out_end + len > sizeof(p->outbuf) && p->out_begin > 0) {
+    memmove(p->outbuf, p->outbuf + p->out_begin, p->out_end - p->out_begin);
+    p->out_end -= p->out_begin;
+    p->out_begin = 0;
+  }
+  if(p->out_end + len > sizeof(p->outbuf)) {
     err(1, "slip_send overflow");
   }
-  slip_buf[slip_end] = c;
-  slip_end++;
+  return p->outbuf + p->out_end;
+}
+
+void
+slip_send(struct port *p, unsigned char c)
+{
+  *slip_reserve(p, 1) = c;
+  p->out_end++;
 }
 
 int
-slip_empty()
+slip_empty(struct port *p)
 {
-  return slip_end == 0;
+  return p->out_end == p->out_begin;
+}
+
+/* Room for another packet from the tun */
+int
+slip_ready(struct port *p)
+{
+  if(basedelay) {
+    /* -d: one packet at a time */
+    return slip_empty(p) && p->delaymsec == 0;
+  }
+  return sizeof(p->outbuf) - (p->out_end - p->out_begin) >= SLIP_OUT_MAX;
 }
 
 void
-slip_flushbuf(int fd)
+slip_flushbuf(struct port *p)
 {
   int n;
 
-  if(slip_empty()) {
+  if(slip_empty(p)) {
     return;
   }
 
-  n = write(fd, slip_buf + slip_begin, (slip_end - slip_begin));
+  n = write(p->fd, p->outbuf + p->out_begin, (p->out_end - p->out_begin));
 
   if(n == -1 && errno != EAGAIN) {
     err(1, "slip_flushbuf write failed");
   } else if(n == -1) {
     PROGRESS("Q");		/* Outqueueis full! */
   } else {
-    slip_begin += n;
-    if(slip_begin == slip_end) {
-      slip_begin = slip_end = 0;
+    p->out_begin += n;
+    if(p->out_begin == p->out_end) {
+      p->out_begin = p->out_end = 0;
     }
   }
 }
 
 void
-write_to_serial(int outfd, void *inbuf, int len)
+write_to_serial(struct port *p, const unsigned char *inbuf, int len)
 {
-  u_int8_t *p = inbuf;
+  const unsigned char *end = inbuf + len;
+  const unsigned char *run;
+  unsigned char *out;
   int i;
 
   if(verbose>2) {
     if (timestamp) stamptime();
+    port_label(p);
     printf("Packet from TUN of length %d - write SLIP\n", len);
     if (verbose>4) {
 #if WIRESHARK_IMPORT_FORMAT
       printf("0000");
-	  for(i = 0; i < len; i++) printf(" %02x", p[i]);
+	  for(i = 0; i < len; i++) printf(" %02x", inbuf[i]);
 #else
       printf("         ");
       for(i = 0; i < len; i++) {
-        printf("%02x", p[i]);
+        printf("%02x", inbuf[i]);
         if((i & 3) == 3) printf(" ");
         if((i & 15) == 15) printf("\n         ");
       }
@@ -440,59 +619,96 @@ write_to_serial(int outfd, void *inbuf, int len)
   /* It would be ``nice'' to send a SLIP_END here but it's not
    * really necessary.
    */
-  /* slip_send(outfd, SLIP_END); */
 
-  for(i = 0; i < len; i++) {
-    switch(p[i]) {
-    case SLIP_END:
-      slip_send(outfd, SLIP_ESC);
-      slip_send(outfd, SLIP_ESC_END);
-      break;
-    case SLIP_ESC:
-      slip_send(outfd, SLIP_ESC);
-      slip_send(outfd, SLIP_ESC_ESC);
-      break;
-    case XON:
-      if(flowcontrol_xonxoff) {
-        slip_send(outfd, SLIP_ESC);
-        slip_send(outfd, SLIP_ESC_XON);
-      } else {
-        slip_send(outfd, p[i]);
-      }
-      break;
-    case XOFF:
-      if(flowcontrol_xonxoff) {
-        slip_send(outfd, SLIP_ESC);
-        slip_send(outfd, SLIP_ESC_XOFF);
-      } else {
-        slip_send(outfd, p[i]);
-      }
-      break;
-    default:
-      slip_send(outfd, p[i]);
-      break;
+  /* Copy the runs between the bytes that need escaping at once */
+  out = slip_reserve(p, 2 * len + 1);
+  while(inbuf < end) {
+    run = inbuf;
+    while(inbuf < end && slip_out_esc[*inbuf] == 0) {
+      inbuf++;
+    }
+    memcpy(out, run, inbuf - run);
+    out += inbuf - run;
+    if(inbuf < end) {
+      *out++ = SLIP_ESC;
+      *out++ = slip_out_esc[*inbuf++];
     }
   }
-  slip_send(outfd, SLIP_END);
+  *out++ = SLIP_END;
+  p->out_end = out - p->outbuf;
   PROGRESS("t");
 }
 
+void
+delay_start(struct port *p)
+{
+  struct timeval tv;
 
-/*
- * Read from tun, write to slip.
- */
+  if(basedelay) {
+    gettimeofday(&tv, NULL) ;
+ //   delaymsec=basedelay*(1+(size/120));//multiply by # of 6lowpan packets?
+    p->delaymsec=basedelay;
+    p->delaystartsec =tv.tv_sec;
+    p->delaystartmsec=tv.tv_usec/1000;
+  }
+}
+
+/* Clear the delay of a port once it is over */
+void
+delay_update(struct port *p)
+{
+  struct timeval tv;
+  int dmsec;
+
+  if(p->delaymsec) {
+    gettimeofday(&tv, NULL) ;
+    dmsec=(tv.tv_sec-p->delaystartsec)*1000+tv.tv_usec/1000-p->delaystartmsec;
+    if(dmsec<0) p->delaymsec=0;
+    if(dmsec>p->delaymsec) p->delaymsec=0;
+  }
+}
+
+/* Every port of the tun can take another packet */
 int
-tun_to_serial(int infd, int outfd)
+tun_ready(struct tun *t)
 {
-  struct {
-    unsigned char inbuf[2000];
-  } uip;
-  int size;
+  int i;
 
-  if((size = read(infd, uip.inbuf, 2000)) == -1) err(1, "tun_to_serial: read");
+  for(i = 0; i < nports; i++) {
+    if(ports[i].tun == t && !slip_ready(&ports[i])) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/*
+ * Read from tun, write to slip. Takes all packets the tun has ready,
+ * as long as the serial lines have room for them.
+ */
+void
+tun_to_serial(struct tun *t)
+{
+  unsigned char inbuf[PACKET_SIZE];
+  struct port *dest;
+  int size, i;
+
+  while(tun_ready(t)) {
+    if((size = read(t->fd, inbuf, sizeof(inbuf))) == -1) {
+      if(errno == EAGAIN || errno == EINTR) {
+	return;
+      }
+      err(1, "tun_to_serial: read");
+    }
 
-  write_to_serial(outfd, uip.inbuf, size);
-  return size;
+    dest = ntuns < nports ? route_lookup(inbuf, size) : NULL;
+    for(i = 0; i < nports; i++) {
+      if(ports[i].tun == t && (dest == NULL || dest == &ports[i])) {
+	write_to_serial(&ports[i], inbuf, size);
+	delay_start(&ports[i]);
+      }
+    }
+  }
 }
 
 void
@@ -601,11 +817,11 @@ tun_alloc(char *dev, int tap)
 #endif
 
 void
-cleanup(void)
+cleanup_tun(struct tun *t)
 {
 #ifndef __APPLE__
   if (timestamp) stamptime();
-  ssystem("ifconfig %s down", tundev);
+  ssystem("ifconfig %s down", t->dev);
 #ifndef linux
   ssystem("sysctl -w net.ipv6.conf.all.forwarding=1");
 #endif
@@ -614,15 +830,15 @@ cleanup(void)
   ssystem("netstat -nr"
 	  " | awk '{ if ($2 == \"%s\") print \"route delete -net \"$1; }'"
 	  " | sh",
-	  tundev);
+	  t->dev);
 #else
   {
-    char *  itfaddr = strdup(ipaddr);
+    char *  itfaddr = strdup(t->ipaddr);
     char *  prefix = index(itfaddr, '/');
     if (timestamp) stamptime();
-    ssystem("ifconfig %s inet6 %s remove", tundev, ipaddr);
+    ssystem("ifconfig %s inet6 %s remove", t->dev, t->ipaddr);
     if (timestamp) stamptime();
-    ssystem("ifconfig %s down", tundev);
+    ssystem("ifconfig %s down", t->dev);
     if ( prefix != NULL ) *prefix = '\0';
     ssystem("route delete -inet6 %s", itfaddr);
     free(itfaddr);
@@ -630,6 +846,16 @@ cleanup(void)
 #endif
 }
 
+void
+cleanup(void)
+{
+  int i;
+
+  for(i = 0; i < ntuns; i++) {
+    cleanup_tun(&tuns[i]);
+  }
+}
+
 void
 sigcleanup(int signo)
 {
@@ -746,23 +972,29 @@ int
 main(int argc, char **argv)
 {
   int c;
-  int tunfd, maxfd;
+  int maxfd;
   int ret;
+  int i;
   fd_set rset, wset;
-  FILE *inslip;
-  const char *siodev = NULL;
+  struct timeval tv;
+  struct port *p;
+  struct tun *t;
+  const char *siodevs[MAX_PORTS];
+  const char *tundevs[MAX_PORTS];
+  int nsiodevs = 0, ntundevs = 0;
   const char *host = NULL;
   const char *port = NULL;
   const char *prog;
   int baudrate = -2;
   int ipa_enable = 0;
   int tap = 0;
-  slipfd = 0;
+  int shared_tun = 0;
+  int delaying;
 
   prog = argv[0];
   setvbuf(stdout, NULL, _IOLBF, 0); /* Line buffered output. */
 
-  while((c = getopt(argc, argv, "B:HILPhXM:s:t:v::d::a:p:T")) != -1) {
+  while((c = getopt(argc, argv, "B:HILPhXM:s:t:Uv::d::a:p:T")) != -1) {
     switch(c) {
     case 'B':
       baudrate = atoi(optarg);
@@ -791,10 +1023,13 @@ main(int argc, char **argv)
       break;
 
     case 's':
+      if(nsiodevs == MAX_PORTS) {
+	errx(1, "at most %d serial devices", MAX_PORTS);
+      }
       if(strncmp("/dev/", optarg, 5) == 0) {
-	siodev = optarg + 5;
+	siodevs[nsiodevs++] = optarg + 5;
       } else {
-	siodev = optarg;
+	siodevs[nsiodevs++] = optarg;
       }
       break;
 
@@ -804,13 +1039,20 @@ main(int argc, char **argv)
       break;
 
     case 't':
+      if(ntundevs == MAX_PORTS) {
+	errx(1, "at most %d tun devices", MAX_PORTS);
+      }
       if(strncmp("/dev/", optarg, 5) == 0) {
-	strncpy(tundev, optarg + 5, sizeof(tundev));
+	tundevs[ntundevs++] = optarg + 5;
       } else {
-	strncpy(tundev, optarg, sizeof(tundev));
+	tundevs[ntundevs++] = optarg;
       }
       break;
 
+    case 'U':
+      shared_tun = 1;
+      break;
+
     case 'a':
       host = optarg;
       break;
@@ -836,8 +1078,9 @@ main(int argc, char **argv)
     case '?':
     case 'h':
     default:
-fprintf(stderr,"usage:  %s [options] ipaddress\n", prog);
+fprintf(stderr,"usage:  %s [options] ipaddress...\n", prog);
 fprintf(stderr,"example: tunslip6 -L -v2 -s ttyUSB1 fd00::1/64\n");
+fprintf(stderr,"         tunslip6 -s ttyUSB0 -s ttyUSB1 fd00::1/64 fd01::1/64\n");
 fprintf(stderr,"Options are:\n");
 #ifndef __APPLE__
 fprintf(stderr," -B baudrate    9600,19200,38400,57600,115200 (default),230400,460800,921600\n");
@@ -848,10 +1091,13 @@ fprintf(stderr," -H             Hardware CTS/RTS flow control (default disabled)
 fprintf(stderr," -I             Inquire IP address\n");
 fprintf(stderr," -X             Software XON/XOFF flow control (default disabled)\n");
 fprintf(stderr," -L             Log output format (adds time stamps)\n");
-fprintf(stderr," -s siodev      Serial device (default /dev/ttyUSB0)\n");
+fprintf(stderr," -s siodev      Serial device (default /dev/ttyUSB0), repeat for\n");
+fprintf(stderr,"                several 6LBRs, each with its own interface\n");
 fprintf(stderr," -M             Interface MTU (default and min: 1280)\n");
 fprintf(stderr," -T             Make tap interface (default is tun interface)\n");
-fprintf(stderr," -t tundev      Name of interface (default tap0 or tun0)\n");
+fprintf(stderr," -t tundev      Name of interface (default tap0 or tun0), repeat\n");
+fprintf(stderr,"                to name the interface of each serial device\n");
+fprintf(stderr," -U             One interface for all serial devices\n");
 fprintf(stderr," -v[level]      Verbosity level\n");
 fprintf(stderr,"    -v0         No messages\n");
 fprintf(stderr,"    -v1         Encapsulated SLIP debug messages (default)\n");
@@ -865,6 +1111,7 @@ fprintf(stderr,"                Actual delay is basedelay*(#6LowPAN fragments) m
 fprintf(stderr,"                -d is equivalent to -d10.\n");
 fprintf(stderr," -a serveraddr  \n");
 fprintf(stderr," -p serverport  \n");
+fprintf(stderr,"One ipaddress per interface.\n");
 exit(1);
       break;
     }
@@ -872,10 +1119,24 @@ exit(1);
   argc -= (optind - 1);
   argv += (optind - 1);
 
-  if(argc != 2 && argc != 3) {
-    err(1, "usage: %s [-B baudrate] [-H] [-L] [-s siodev] [-t tundev] [-T] [-v verbosity] [-d delay] [-a serveraddress] [-p serverport] ipaddress", prog);
+  if(host != NULL && nsiodevs > 0) {
+    errx(1, "-a and -s cannot be combined");
+  }
+  nports = nsiodevs > 0 ? nsiodevs : 1;
+  ntuns = shared_tun ? 1 : nports;
+
+  if(argc < 1 + ntuns) {
+    err(1, "usage: %s [-B baudrate] [-H] [-L] [-s siodev]... [-t tundev]... [-U] [-T] [-v verbosity] [-d delay] [-a serveraddress] [-p serverport] ipaddress...", prog);
+  }
+  for(i = 0; i < ntuns; i++) {
+    tuns[i].ipaddr = argv[1 + i];
+    if(i < ntundevs) {
+      strncpy(tuns[i].dev, tundevs[i], sizeof(tuns[i].dev) - 1);
+    }
+  }
+  for(i = 0; i < nports; i++) {
+    ports[i].tun = &tuns[shared_tun ? 0 : i];
   }
-  ipaddr = argv[1];
 
   if(baudrate != -2) { /* -2: use default baudrate */
     b_rate = select_baudrate(baudrate);
@@ -884,6 +1145,8 @@ exit(1);
     }
   }
 
+  slip_tables_init();
+
   if(host != NULL) {
     struct addrinfo hints, *servinfo, *p;
     int rv;
@@ -903,14 +1166,14 @@ exit(1);
 
     /* loop through all the results and connect to the first we can */
     for(p = servinfo; p != NULL; p = p->ai_next) {
-      if((slipfd = socket(p->ai_family, p->ai_socktype,
-                          p->ai_protocol)) == -1) {
+      if((ports[0].fd = socket(p->ai_family, p->ai_socktype,
+                               p->ai_protocol)) == -1) {
         perror("client: socket");
         continue;
       }
 
-      if(connect(slipfd, p->ai_addr, p->ai_addrlen) == -1) {
-        close(slipfd);
+      if(connect(ports[0].fd, p->ai_addr, p->ai_addrlen) == -1) {
+        close(ports[0].fd);
         perror("client: connect");
         continue;
       }
@@ -921,7 +1184,7 @@ exit(1);
       err(1, "can't connect to ``%s:%s''", host, port);
     }
 
-    fcntl(slipfd, F_SETFL, O_NONBLOCK);
+    fcntl(ports[0].fd, F_SETFL, O_NONBLOCK);
 
     inet_ntop(p->ai_family, get_in_addr((struct sockaddr *)p->ai_addr),
               s, sizeof(s));
@@ -930,115 +1193,132 @@ exit(1);
     /* all done with this structure */
     freeaddrinfo(servinfo);
 
-  } else {
-    if(siodev != NULL) {
-      slipfd = devopen(siodev, O_RDWR | O_NONBLOCK);
-      if(slipfd == -1) {
-	err(1, "can't open siodev ``/dev/%s''", siodev);
-      }
-    } else {
-      static const char *siodevs[] = {
-        "ttyUSB0", "cuaU0", "ucom0" /* linux, fbsd6, fbsd5 */
-      };
-      int i;
-      for(i = 0; i < 3; i++) {
-        siodev = siodevs[i];
-        slipfd = devopen(siodev, O_RDWR | O_NONBLOCK);
-        if(slipfd != -1) {
-          break;
-        }
+  } else if(nsiodevs > 0) {
+    for(i = 0; i < nports; i++) {
+      ports[i].siodev = siodevs[i];
+      ports[i].fd = devopen(siodevs[i], O_RDWR | O_NONBLOCK);
+      if(ports[i].fd == -1) {
+	err(1, "can't open siodev ``/dev/%s''", siodevs[i]);
       }
-      if(slipfd == -1) {
-        err(1, "can't open siodev");
+      if (timestamp) stamptime();
+      fprintf(stderr, "********SLIP started on ``/dev/%s''\n", siodevs[i]);
+      stty_telos(ports[i].fd);
+    }
+  } else {
+    static const char *siodevs[] = {
+      "ttyUSB0", "cuaU0", "ucom0" /* linux, fbsd6, fbsd5 */
+    };
+    for(i = 0; i < 3; i++) {
+      ports[0].siodev = siodevs[i];
+      ports[0].fd = devopen(siodevs[i], O_RDWR | O_NONBLOCK);
+      if(ports[0].fd != -1) {
+        break;
       }
     }
+    if(ports[0].fd == -1) {
+      err(1, "can't open siodev");
+    }
     if (timestamp) stamptime();
-    fprintf(stderr, "********SLIP started on ``/dev/%s''\n", siodev);
-    stty_telos(slipfd);
+    fprintf(stderr, "********SLIP started on ``/dev/%s''\n", ports[0].siodev);
+    stty_telos(ports[0].fd);
+  }
+  for(i = 0; i < nports; i++) {
+    slip_send(&ports[i], SLIP_END);
   }
-  slip_send(slipfd, SLIP_END);
-  inslip = fdopen(slipfd, "r");
-  if(inslip == NULL) err(1, "main: fdopen");
 
-  tunfd = tun_alloc(tundev, tap);
-  if(tunfd == -1) err(1, "main: open /dev/tun");
-  if (timestamp) stamptime();
-  fprintf(stderr, "opened %s device ``/dev/%s''\n",
-          tap ? "tap" : "tun", tundev);
+  for(i = 0; i < ntuns; i++) {
+    tuns[i].fd = tun_alloc(tuns[i].dev, tap);
+    if(tuns[i].fd == -1) err(1, "main: open /dev/tun");
+    /* Read until there is nothing left */
+    fcntl(tuns[i].fd, F_SETFL, O_NONBLOCK);
+    if (timestamp) stamptime();
+    fprintf(stderr, "opened %s device ``/dev/%s''\n",
+	    tap ? "tap" : "tun", tuns[i].dev);
+  }
 
   atexit(cleanup);
   signal(SIGHUP, sigcleanup);
   signal(SIGTERM, sigcleanup);
   signal(SIGINT, sigcleanup);
   signal(SIGALRM, sigalarm);
-  ifconf(tundev, ipaddr);
+  for(i = 0; i < ntuns; i++) {
+    ifconf(tuns[i].dev, tuns[i].ipaddr);
+  }
 
   while(1) {
     maxfd = 0;
     FD_ZERO(&rset);
     FD_ZERO(&wset);
+    delaying = 0;
+
+    for(i = 0; i < nports; i++) {
+      p = &ports[i];
+      if(got_sigalarm && ipa_enable) {
+	/* Send "?IPA". */
+	slip_send(p, '?');
+	slip_send(p, 'I');
+	slip_send(p, 'P');
+	slip_send(p, 'A');
+	slip_send(p, SLIP_END);
+      }
 
-    if(got_sigalarm && ipa_enable) {
-      /* Send "?IPA". */
-      slip_send(slipfd, '?');
-      slip_send(slipfd, 'I');
-      slip_send(slipfd, 'P');
-      slip_send(slipfd, 'A');
-      slip_send(slipfd, SLIP_END);
-      got_sigalarm = 0;
-    }
-
-    if(!slip_empty()) {		/* Anything to flush? */
-      FD_SET(slipfd, &wset);
-    }
+      /* Optional delay between outgoing packets */
+      delay_update(p);
+      if(p->delaymsec) {
+	delaying = 1;
+      }
 
-    FD_SET(slipfd, &rset);	/* Read from slip ASAP! */
-    if(slipfd > maxfd) maxfd = slipfd;
+      if(!slip_empty(p)) {	/* Anything to flush? */
+	FD_SET(p->fd, &wset);
+      }
 
-    /* We only have one packet at a time queued for slip output. */
-    if(slip_empty()) {
-      FD_SET(tunfd, &rset);
-      if(tunfd > maxfd) maxfd = tunfd;
+      FD_SET(p->fd, &rset);	/* Read from slip ASAP! */
+      if(p->fd > maxfd) maxfd = p->fd;
     }
+    got_sigalarm = 0;
+
+    /* Only when the serial lines can take what comes from the tun */
+    for(i = 0; i < ntuns; i++) {
+      t = &tuns[i];
+      if(tun_ready(t)) {
+	FD_SET(t->fd, &rset);
+	if(t->fd > maxfd) maxfd = t->fd;
+      }
+    }
+
+    /* Wake up when the delay is over */
+    tv.tv_sec = 0;
+    tv.tv_usec = basedelay * 1000;
 
-    ret = select(maxfd + 1, &rset, &wset, NULL, NULL);
+    ret = select(maxfd + 1, &rset, &wset, NULL, delaying ? &tv : NULL);
     if(ret == -1 && errno != EINTR) {
       err(1, "select");
     } else if(ret > 0) {
-      if(FD_ISSET(slipfd, &rset)) {
-        serial_to_tun(inslip, tunfd);
-      }
+      for(i = 0; i < nports; i++) {
+	p = &ports[i];
+	if(FD_ISSET(p->fd, &rset)) {
+	  serial_to_tun(p);
+	}
 
-      if(FD_ISSET(slipfd, &wset)) {
-	slip_flushbuf(slipfd);
-	if(ipa_enable) sigalarm_reset();
+	if(FD_ISSET(p->fd, &wset)) {
+	  slip_flushbuf(p);
+	  if(ipa_enable) sigalarm_reset();
+	}
       }
 
-      /* Optional delay between outgoing packets */
-      /* Base delay times number of 6lowpan fragments to be sent */
-      if(delaymsec) {
-       struct timeval tv;
-       int dmsec;
-       gettimeofday(&tv, NULL) ;
-       dmsec=(tv.tv_sec-delaystartsec)*1000+tv.tv_usec/1000-delaystartmsec;
-       if(dmsec<0) delaymsec=0;
-       if(dmsec>delaymsec) delaymsec=0;
+      for(i = 0; i < ntuns; i++) {
+	t = &tuns[i];
+	if(FD_ISSET(t->fd, &rset)) {
+	  tun_to_serial(t);
+	}
       }
-      if(delaymsec==0) {
-        int size;
-        if(slip_empty() && FD_ISSET(tunfd, &rset)) {
-          size=tun_to_serial(tunfd, slipfd);
-          slip_flushbuf(slipfd);
-          if(ipa_enable) sigalarm_reset();
-          if(basedelay) {
-            struct timeval tv;
-            gettimeofday(&tv, NULL) ;
- //         delaymsec=basedelay*(1+(size/120));//multiply by # of 6lowpan packets?
-            delaymsec=basedelay;
-            delaystartsec =tv.tv_sec;
-            delaystartmsec=tv.tv_usec/1000;
-          }
-        }
+
+      /* Everything the tuns had, in one write per serial line */
+      for(i = 0; i < nports; i++) {
+	if(!slip_empty(&ports[i])) {
+	  slip_flushbuf(&ports[i]);
+	  if(ipa_enable) sigalarm_reset();
+	}
       }
     }
   }
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+
+/**
+ * \file
+ *         Micro-benchmark of the secured NS input of the 6LBR
+ *
+ *         Runs the 6LBR stack of ../lbr.c on the native platform without
+ *         a radio and feeds it synthetic secured NS, valid ones and ones
+ *         that fail each of the checks, from 6LNs at the start, middle
+ *         and end of the registration table.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-ds6-nbr.h"
+#include "net/ipv6/nd6-stats.h"
+#include "ns-craft.h"
+#include "nd6-fuzz.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef ND6_BENCH_CONF_ROUNDS
+#define ROUNDS ND6_BENCH_CONF_ROUNDS
+#else
+#define ROUNDS 2000UL
+#endif
+
+/* Bytes of stack painted below the benchmark to find the high-water mark */
+#define STACK_PAINT_SIZE 8192
+#define STACK_PAINT      0xcd
+
+enum { POS_FIRST, POS_MIDDLE, POS_LAST };
+
+static const struct scenario {
+  const char *name;
+  uint8_t pos;
+  uint8_t order;
+  uint8_t defects;
+} scenarios[] = {
+  { "valid, first entry", POS_FIRST, NS_CRAFT_ORDER_6LN, 0 },
+  { "valid, middle entry", POS_MIDDLE, NS_CRAFT_ORDER_6LN, 0 },
+  { "valid, last entry", POS_LAST, NS_CRAFT_ORDER_6LN, 0 },
+  { "unknown EUI-64", POS_LAST, NS_CRAFT_ORDER_6LN, NS_CRAFT_BAD_MAC },
+  { "replayed nonce", POS_LAST, NS_CRAFT_ORDER_6LN, NS_CRAFT_BAD_NONCE },
+  { "bad authenticator", POS_LAST, NS_CRAFT_ORDER_6LN, NS_CRAFT_BAD_AUTH },
+  { "ARO without NONCE/AUTH", POS_LAST, NS_CRAFT_ORDER_6LN, NS_CRAFT_NO_AUTH },
+  { "order SLLAO ARO NONCE AUTH", POS_LAST, NS_CRAFT_ORDER_ARO_FIRST, 0 },
+  { "order AUTH NONCE SLLAO ARO", POS_LAST, NS_CRAFT_ORDER_AUTH_FIRST, 0 },
+  { "order ARO SLLAO AUTH NONCE", POS_LAST, NS_CRAFT_ORDER_REVERSED, 0 },
+};
+
+extern int contiki_argc;
+extern char **contiki_argv;
+
+PROCESS(nd6_bench_process, "ND6 bench");
+AUTOSTART_PROCESSES(&nd6_bench_process);
+/*---------------------------------------------------------------------------*/
+static uint64_t
+now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static void __attribute__((noinline))
+stack_paint(void)
+{
+  volatile uint8_t buf[STACK_PAINT_SIZE];
+  unsigned i;
+
+  for(i = 0; i < sizeof(buf); i++) {
+    buf[i] = STACK_PAINT;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Bytes used since stack_paint(), called from the same frame. Reading
+ * what is left of the paint is the whole point */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+static unsigned __attribute__((noinline))
+stack_used(void)
+{
+  volatile uint8_t buf[STACK_PAINT_SIZE];
+  unsigned i;
+
+  for(i = 0; i < sizeof(buf) && buf[i] == STACK_PAINT; i++);
+  return sizeof(buf) - i;
+}
+#pragma GCC diagnostic pop
+/*---------------------------------------------------------------------------*/
+/* Input the NS in uip_buf, adding the time it took to *ns and the stack
+ * it used to *stack */
+static uint8_t __attribute__((noinline))
+input(uint64_t *ns, unsigned *stack)
+{
+  uint64_t start;
+  unsigned used;
+  uint8_t outcome;
+
+  stack_paint();
+  start = now_ns();
+  outcome = ns_craft_input();
+  *ns += now_ns() - start;
+  used = stack_used();
+  if(used > *stack) {
+    *stack = used;
+  }
+  return outcome;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(const struct scenario *s, unsigned long rounds)
+{
+  unsigned long outcomes[4] = { 0 };
+  unsigned long i;
+  uint64_t ns = 0;
+  unsigned stack = 0;
+  uint16_t num, nbr_max = 0;
+  uip_ds6_reg_t *reg;
+
+  num = ns_craft_reg_num();
+  reg = ns_craft_reg(s->pos == POS_FIRST ? 0 :
+                     s->pos == POS_MIDDLE ? num / 2 : num - 1);
+  for(i = 0; i < rounds; i++) {
+    ns_craft(reg, s->order, s->defects);
+    outcomes[input(&ns, &stack)]++;
+    if(uip_ds6_nbr_num() > nbr_max) {
+      nbr_max = uip_ds6_nbr_num();
+    }
+  }
+  if(ns == 0) {
+    ns = 1;
+  }
+
+  printf("%-28s %8lu NS/s %7lu ns/NS  registered %5lu NA %5lu dropped %5lu"
+         "  stack %s%u B  neighbors %u\n",
+         s->name,
+         (unsigned long)(rounds * 1000000000ULL / ns),
+         (unsigned long)(ns / rounds),
+         outcomes[NS_CRAFT_REGISTERED] + outcomes[NS_CRAFT_DUPLICATE],
+         outcomes[NS_CRAFT_NA], outcomes[NS_CRAFT_DROPPED],
+         stack >= STACK_PAINT_SIZE ? ">" : "", stack, nbr_max);
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench(unsigned long rounds)
+{
+  uip_ds6_reg_t *reg;
+  uint16_t registered = 0;
+  int i;
+
+  printf("nd6 bench: %u of %u registration entries used, %lu NS per case\n",
+         ns_craft_reg_num(), UIP_DS6_REG_LIST_SIZE, rounds);
+  nd6_stats_reset();
+  for(i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+    run(&scenarios[i], rounds);
+  }
+
+  for(i = 0; (reg = ns_craft_reg(i)) != NULL; i++) {
+    if(reg->state == REG_REGISTERED) {
+      registered++;
+    }
+  }
+  printf("registered %u, neighbors %u of %u\n",
+         registered, uip_ds6_nbr_num(), NBR_TABLE_MAX_NEIGHBORS);
+  nd6_stats_print("ND6bench");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(nd6_bench_process, ev, data)
+{
+  int ret = 0;
+
+  PROCESS_BEGIN();
+
+  /* Let tcpip_process finish the 6LBR setup */
+  PROCESS_PAUSE();
+
+#if WITH_LIBFUZZER
+  {
+    extern int LLVMFuzzerRunDriver(int *argc, char ***argv,
+                                   int (*cb)(const uint8_t *, size_t));
+    ret = LLVMFuzzerRunDriver(&contiki_argc, &contiki_argv,
+                              LLVMFuzzerTestOneInput);
+  }
+#else /* WITH_LIBFUZZER */
+  if(contiki_argc > 1 && !strcmp(contiki_argv[1], "fuzz")) {
+    ret = nd6_fuzz_run(contiki_argc > 2 ? strtoul(contiki_argv[2], NULL, 0) : 1000000,
+                       contiki_argc > 3 ? strtoul(contiki_argv[3], NULL, 0) : 1);
+  } else if(contiki_argc > 1 && !strcmp(contiki_argv[1], "replay")) {
+    ret = nd6_fuzz_replay(contiki_argc - 2, contiki_argv + 2);
+  } else if(contiki_argc > 2 && !strcmp(contiki_argv[1], "corpus")) {
+    ret = nd6_fuzz_corpus(contiki_argv[2]);
+  } else if(contiki_argc > 1 && strcmp(contiki_argv[1], "bench")) {
+    printf("usage: %s [bench [rounds] | fuzz [iterations [seed]] |"
+           " replay file... | corpus dir]\n", contiki_argv[0]);
+    ret = 1;
+  } else {
+    bench(contiki_argc > 2 ? strtoul(contiki_argv[2], NULL, 0) : ROUNDS);
+  }
+#endif /* WITH_LIBFUZZER */
+
+  exit(ret == 0 ? 0 : 1);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+
+/**
+ * \file
+ *         Fuzzing of the NS input of the 6LBR
+ *
+ *         Without libFuzzer, nd6_fuzz_run() crafts secured NS that would
+ *         pass, mutates most of them and feeds them to the 6LBR. Starting
+ *         from valid NS gets past the MAC, nonce and authenticator checks
+ *         often enough to reach the registration code as well.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-6lowpan-nd6.h"
+#include "ns-craft.h"
+#include "nd6-fuzz.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__SANITIZE_ADDRESS__)
+#define WITH_SANITIZER 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define WITH_SANITIZER 1
+#endif
+#endif
+#if WITH_SANITIZER
+#include <sanitizer/common_interface_defs.h>
+#endif /* WITH_SANITIZER */
+
+/* Source address and ICMPv6 message */
+#define INPUT_MAX (sizeof(uip_ipaddr_t) + UIP_BUFSIZE - UIP_LLH_LEN - UIP_IPH_LEN)
+/* Offset of the first ND option in the input */
+#define OPT_OFFSET (sizeof(uip_ipaddr_t) + UIP_ICMPH_LEN + UIP_ND6_NS_LEN)
+
+/* File the input that crashed is written to */
+#define CRASH_FILE "nd6-fuzz-crash"
+
+#define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+static uint8_t input[INPUT_MAX];
+static uint16_t input_len;
+static uint32_t prng;
+static unsigned long outcomes[4];
+
+static const uint8_t interesting[] = {
+  0x00, 0x01, 0x02, 0x03, 0x05, 0x7f, 0x80, 0xfe, 0xff,
+  UIP_ND6_OPT_SLLAO, UIP_ND6_OPT_ARO, UIP_ND6_OPT_NONCE, UIP_ND6_OPT_AUTH,
+};
+/*---------------------------------------------------------------------------*/
+static uint32_t
+rnd(void)
+{
+  /* xorshift32, the same sequence for the same seed everywhere */
+  prng ^= prng << 13;
+  prng ^= prng >> 17;
+  prng ^= prng << 5;
+  return prng;
+}
+/*---------------------------------------------------------------------------*/
+static void
+crash_dump(void)
+{
+  static const char msg[] = "nd6-fuzz: input written to " CRASH_FILE "\n";
+  ssize_t r;
+  int fd;
+
+  /* Runs from a signal handler, stick to system calls */
+  fd = open(CRASH_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(fd >= 0) {
+    r = write(fd, input, input_len);
+    close(fd);
+    r = write(STDERR_FILENO, msg, sizeof(msg) - 1);
+    (void)r;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+crash_signal(int sig)
+{
+  crash_dump();
+  signal(sig, SIG_DFL);
+  raise(sig);
+}
+/*---------------------------------------------------------------------------*/
+static void
+block_swap(uint16_t a, uint16_t b)
+{
+  uint8_t tmp[8];
+
+  memcpy(tmp, &input[a], 8);
+  memcpy(&input[a], &input[b], 8);
+  memcpy(&input[b], tmp, 8);
+}
+/*---------------------------------------------------------------------------*/
+static void
+mutate(void)
+{
+  uint16_t pos, blocks, off;
+  uint8_t n, i;
+
+  for(n = 1 + rnd() % 4; n > 0 && input_len > 0; n--) {
+    pos = rnd() % input_len;
+    blocks = input_len > OPT_OFFSET ? (input_len - OPT_OFFSET) / 8 : 0;
+    switch(rnd() % 8) {
+    case 0:
+      input[pos] ^= 1 << (rnd() % 8);
+      break;
+    case 1:
+      input[pos] = rnd();
+      break;
+    case 2:
+      input[pos] = interesting[rnd() % sizeof(interesting)];
+      break;
+    case 3:
+      /* Truncate */
+      input_len = pos;
+      break;
+    case 4:
+      /* Append garbage */
+      for(i = 1 + rnd() % 16; i > 0 && input_len < INPUT_MAX; i--) {
+        input[input_len++] = rnd();
+      }
+      break;
+    case 5:
+      /* Swap two 8-byte blocks of the options */
+      if(blocks >= 2) {
+        block_swap(OPT_OFFSET + 8 * (rnd() % blocks),
+                   OPT_OFFSET + 8 * (rnd() % blocks));
+      }
+      break;
+    case 6:
+      /* Repeat an 8-byte block of the options at the end */
+      if(blocks >= 1 && input_len + 8 <= INPUT_MAX) {
+        memcpy(&input[input_len], &input[OPT_OFFSET + 8 * (rnd() % blocks)], 8);
+        input_len += 8;
+      }
+      break;
+    case 7:
+      /* Change the length of one of the options */
+      off = OPT_OFFSET;
+      for(i = rnd() % 4; i > 0 && off + 1 < input_len && input[off + 1] != 0; i--) {
+        off += input[off + 1] << 3;
+      }
+      if(off + 1 < input_len) {
+        input[off + 1] = rnd() % 7;
+      }
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  if(size <= INPUT_MAX) {
+    ns_craft_input_raw(data, size);
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+nd6_fuzz_run(unsigned long iterations, unsigned long seed)
+{
+  unsigned long i;
+  uint16_t num;
+  uint8_t defects;
+
+  prng = seed != 0 ? seed : 1;
+  num = ns_craft_reg_num();
+  signal(SIGSEGV, crash_signal);
+  signal(SIGBUS, crash_signal);
+  signal(SIGFPE, crash_signal);
+  signal(SIGABRT, crash_signal);
+#if WITH_SANITIZER
+  __sanitizer_set_death_callback(crash_dump);
+#endif /* WITH_SANITIZER */
+
+  printf("fuzz: %lu iterations, seed %lu, %u registrations\n",
+         iterations, seed, num);
+  for(i = 0; i < iterations; i++) {
+    defects = rnd() % 4 == 0 ? 1 << (rnd() % 4) : 0;
+    ns_craft(ns_craft_reg(rnd() % num), rnd() % NS_CRAFT_ORDER_NUM, defects);
+    memcpy(input, &UIP_IP_BUF->srcipaddr, sizeof(uip_ipaddr_t));
+    input_len = sizeof(uip_ipaddr_t) + uip_len - UIP_IPH_LEN;
+    memcpy(&input[sizeof(uip_ipaddr_t)], &uip_buf[UIP_LLH_LEN + UIP_IPH_LEN],
+           uip_len - UIP_IPH_LEN);
+    if(rnd() % 8 != 0) {
+      mutate();
+    }
+    outcomes[ns_craft_input_raw(input, input_len)]++;
+  }
+  printf("fuzz: dropped %lu NA %lu registered %lu duplicate %lu\n",
+         outcomes[NS_CRAFT_DROPPED], outcomes[NS_CRAFT_NA],
+         outcomes[NS_CRAFT_REGISTERED], outcomes[NS_CRAFT_DUPLICATE]);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+nd6_fuzz_replay(int num, char **files)
+{
+  FILE *f;
+  int i;
+
+  for(i = 0; i < num; i++) {
+    f = fopen(files[i], "rb");
+    if(f == NULL) {
+      perror(files[i]);
+      return -1;
+    }
+    input_len = fread(input, 1, sizeof(input), f);
+    fclose(f);
+    printf("replay: %s, %u bytes, outcome %u\n", files[i], input_len,
+           ns_craft_input_raw(input, input_len));
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+nd6_fuzz_corpus(const char *dir)
+{
+  char path[256];
+  FILE *f;
+  uint16_t num;
+  uint8_t order;
+
+  /* A different 6LN for each, so that none replays the nonce of another */
+  num = ns_craft_reg_num();
+  for(order = 0; order < NS_CRAFT_ORDER_NUM; order++) {
+    ns_craft(ns_craft_reg(order % num), order, 0);
+    snprintf(path, sizeof(path), "%s/ns-order-%u", dir, order);
+    f = fopen(path, "wb");
+    if(f == NULL) {
+      perror(path);
+      return -1;
+    }
+    fwrite(&UIP_IP_BUF->srcipaddr, 1, sizeof(uip_ipaddr_t), f);
+    fwrite(&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN], 1, uip_len - UIP_IPH_LEN, f);
+    fclose(f);
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+
+/**
+ * \file
+ *         Fuzzing of the NS input of the 6LBR
+ */
+
+#ifndef ND6_FUZZ_H_
+#define ND6_FUZZ_H_
+
+#include "contiki.h"
+#include <stddef.h>
+
+/* libFuzzer entry point: the data is the source address of a NS followed
+ * by its ICMPv6 part */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+/* Run iterations mutated secured NS, starting from the PRNG seed.
+ * Returns 0 */
+int nd6_fuzz_run(unsigned long iterations, unsigned long seed);
+
+/* Feed the content of each file to LLVMFuzzerTestOneInput().
+ * Returns -1 if a file could not be read */
+int nd6_fuzz_replay(int num, char **files);
+
+/* Write one valid NS per option order into dir, as libFuzzer seeds.
+ * Returns -1 if a file could not be written */
+int nd6_fuzz_corpus(const char *dir);
+
+#endif /* ND6_FUZZ_H_ */
@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+
+/**
+ * \file
+ *         Synthetic secured NS messages for the 6LBR, as a 6LN sends them
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6-reg.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-icmp6.h"
+#include "net/ipv6/uip-6lowpan-nd6.h"
+#include "net/ipv6/opt8/crypto_hash.h"
+#include "ns-craft.h"
+
+#include <string.h>
+
+#define UIP_IP_BUF   ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_ICMP_BUF ((struct uip_icmp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
+#define UIP_NS_BUF   ((uip_nd6_ns *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN + UIP_ICMPH_LEN])
+#define OPT_BUF(off) (&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN + UIP_ICMPH_LEN + (off)])
+
+/* Registration lifetime asked for, in minutes */
+#define ARO_LIFETIME 120
+
+#define NONCE_OPT_LEN (UIP_ND6_OPT_NONCE_LEN << 3)
+#define AUTH_OPT_LEN  (UIP_ND6_OPT_AUTH_LEN << 3)
+#define ARO_OPT_LEN   (UIP_ND6_OPT_ARO_LEN << 3)
+
+/*---------------------------------------------------------------------------*/
+/* The LBR information the 6LN learnt from the RA, built the way the 6LBR
+ * rebuilds it when it verifies the authenticator */
+static void
+lbr_info_get(lbr_info *info)
+{
+  uip_ds6_prefix_t *prefix;
+  uip_ds6_addr_context_t *context;
+
+  memset(info, 0, sizeof(*info));
+  for(prefix = uip_ds6_prefix_list;
+      prefix < uip_ds6_prefix_list + UIP_DS6_PREFIX_NB; prefix++) {
+    if(prefix->isused && prefix->advertise) {
+      info->pio.type = UIP_ND6_OPT_PREFIX_INFO;
+      info->pio.len = UIP_ND6_OPT_PREFIX_INFO_LEN / 8;
+      info->pio.preflen = prefix->length;
+      info->pio.flagsreserved1 = prefix->l_a_reserved;
+      info->pio.validlt = uip_htonl(prefix->vlifetime);
+      info->pio.preferredlt = uip_htonl(prefix->plifetime);
+      uip_ipaddr_copy(&info->pio.prefix, &prefix->ipaddr);
+    }
+  }
+  for(context = uip_ds6_context_list;
+      context < uip_ds6_context_list + UIP_DS6_6CO_NB; context++) {
+    if(context->state == 2) { /* IN_USE_COMPRESS */
+      info->co.type = UIP_ND6_OPT_6CO;
+      info->co.len = UIP_ND6_OPT_6CO_LEN;
+      info->co.context_len = context->length;
+      info->co.res1_c_cid = 16 + context->context_id;
+      info->co.valid_lifetime = uip_htons(context->vlifetime);
+      uip_ipaddr_copy(&info->co.prefix, &context->prefix);
+    }
+  }
+  info->abro.type = UIP_ND6_OPT_ABRO;
+  info->abro.len = UIP_ND6_OPT_ABRO_LEN;
+  info->abro.v_low = 0xABCD;
+  info->abro.v_high = 0x1234;
+  info->abro.valid_lifetime = 0xFFFF;
+  memcpy(&info->abro.ipaddr, &global_fipaddr, 16);
+}
+/*---------------------------------------------------------------------------*/
+/* Authenticator of the 6LN: H(source | EUI-64 | lifetime | LBR info |
+ * counter | key) */
+static void
+auth_get(uint8_t *auth, const uip_ipaddr_t *src, const uip_802154_longaddr *eui64,
+         uint16_t lifetime, const uint8_t *counter, const uint8_t *key)
+{
+  uint8_t m[sizeof(uip_ipaddr_t) + sizeof(uip_802154_longaddr) + 2 +
+            sizeof(lbr_info) + 6 + 16];
+  uint8_t *p = m;
+  lbr_info info;
+
+  lbr_info_get(&info);
+  memcpy(p, src, sizeof(uip_ipaddr_t));
+  p += sizeof(uip_ipaddr_t);
+  memcpy(p, eui64, sizeof(uip_802154_longaddr));
+  p += sizeof(uip_802154_longaddr);
+  memcpy(p, &lifetime, 2);
+  p += 2;
+  memcpy(p, &info, sizeof(info));
+  p += sizeof(info);
+  memcpy(p, counter, 6);
+  p += 6;
+  memcpy(p, key, 16);
+  crypto_hash(auth, m, sizeof(m));
+}
+/*---------------------------------------------------------------------------*/
+static void
+counter_next(uint8_t *counter)
+{
+  int i;
+
+  for(i = 5; i >= 0; i--) {
+    if(++counter[i] != 0) {
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+ns_craft(const uip_ds6_reg_t *reg, uint8_t order, uint8_t defects)
+{
+  static const uint8_t orders[NS_CRAFT_ORDER_NUM][4] = {
+    { UIP_ND6_OPT_NONCE, UIP_ND6_OPT_AUTH, UIP_ND6_OPT_SLLAO, UIP_ND6_OPT_ARO },
+    { UIP_ND6_OPT_SLLAO, UIP_ND6_OPT_ARO, UIP_ND6_OPT_NONCE, UIP_ND6_OPT_AUTH },
+    { UIP_ND6_OPT_AUTH, UIP_ND6_OPT_NONCE, UIP_ND6_OPT_SLLAO, UIP_ND6_OPT_ARO },
+    { UIP_ND6_OPT_ARO, UIP_ND6_OPT_SLLAO, UIP_ND6_OPT_AUTH, UIP_ND6_OPT_NONCE },
+  };
+  uip_802154_longaddr eui64;
+  uint8_t counter[6];
+  uint8_t auth[32];
+  uint16_t lifetime;
+  uint16_t off;
+  uint8_t *opt;
+  int i;
+
+  memcpy(&eui64, &reg->mac, sizeof(eui64));
+  if(defects & NS_CRAFT_BAD_MAC) {
+    eui64.addr[0] = 0xee;
+  }
+  memcpy(counter, reg->counter, sizeof(counter));
+  if(!(defects & NS_CRAFT_BAD_NONCE)) {
+    counter_next(counter);
+  }
+  lifetime = uip_htons(ARO_LIFETIME);
+
+  uip_ext_len = 0;
+  memset(UIP_IP_BUF, 0, UIP_IPH_LEN + UIP_ICMPH_LEN + UIP_ND6_NS_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->proto = UIP_PROTO_ICMP6;
+  UIP_IP_BUF->ttl = UIP_ND6_HOP_LIMIT;
+  uip_create_linklocal_prefix(&UIP_IP_BUF->srcipaddr);
+  memcpy(&UIP_IP_BUF->srcipaddr.u8[8], &eui64, 8);
+  UIP_IP_BUF->srcipaddr.u8[8] ^= 0x02;
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &uip_ds6_get_link_local(-1)->ipaddr);
+  UIP_ICMP_BUF->type = ICMP6_NS;
+  uip_ipaddr_copy(&UIP_NS_BUF->tgtipaddr, &UIP_IP_BUF->destipaddr);
+
+  auth_get(auth, &UIP_IP_BUF->srcipaddr, &eui64, lifetime, counter, reg->key);
+  if(defects & NS_CRAFT_BAD_AUTH) {
+    auth[17] ^= 0x10;
+  }
+
+  off = UIP_ND6_NS_LEN;
+  for(i = 0; i < 4; i++) {
+    opt = OPT_BUF(off);
+    switch(orders[order % NS_CRAFT_ORDER_NUM][i]) {
+    case UIP_ND6_OPT_NONCE:
+      if(defects & NS_CRAFT_NO_AUTH) {
+        continue;
+      }
+      memset(opt, 0, NONCE_OPT_LEN);
+      opt[UIP_ND6_OPT_TYPE_OFFSET] = UIP_ND6_OPT_NONCE;
+      opt[UIP_ND6_OPT_LEN_OFFSET] = UIP_ND6_OPT_NONCE_LEN;
+      memcpy(&opt[UIP_ND6_OPT_DATA_OFFSET], counter, sizeof(counter));
+      off += NONCE_OPT_LEN;
+      break;
+    case UIP_ND6_OPT_AUTH:
+      if(defects & NS_CRAFT_NO_AUTH) {
+        continue;
+      }
+      memset(opt, 0, AUTH_OPT_LEN);
+      opt[UIP_ND6_OPT_TYPE_OFFSET] = UIP_ND6_OPT_AUTH;
+      opt[UIP_ND6_OPT_LEN_OFFSET] = UIP_ND6_OPT_AUTH_LEN;
+      memcpy(&opt[UIP_ND6_OPT_DATA_OFFSET], auth, sizeof(auth));
+      off += AUTH_OPT_LEN;
+      break;
+    case UIP_ND6_OPT_SLLAO:
+      memset(opt, 0, UIP_ND6_OPT_LLAO_LEN);
+      opt[UIP_ND6_OPT_TYPE_OFFSET] = UIP_ND6_OPT_SLLAO;
+      opt[UIP_ND6_OPT_LEN_OFFSET] = UIP_ND6_OPT_LLAO_LEN >> 3;
+      memcpy(&opt[UIP_ND6_OPT_DATA_OFFSET],
+             &eui64.addr[8 - UIP_LLADDR_LEN], UIP_LLADDR_LEN);
+      off += UIP_ND6_OPT_LLAO_LEN;
+      break;
+    case UIP_ND6_OPT_ARO:
+      memset(opt, 0, ARO_OPT_LEN);
+      ((uip_nd6_opt_aro *)opt)->type = UIP_ND6_OPT_ARO;
+      ((uip_nd6_opt_aro *)opt)->len = UIP_ND6_OPT_ARO_LEN;
+      ((uip_nd6_opt_aro *)opt)->lifetime = lifetime;
+      memcpy(&((uip_nd6_opt_aro *)opt)->eui64, &eui64, sizeof(eui64));
+      off += ARO_OPT_LEN;
+      break;
+    }
+  }
+
+  uip_len = UIP_IPH_LEN + UIP_ICMPH_LEN + off;
+  UIP_IP_BUF->len[0] = (uip_len - UIP_IPH_LEN) >> 8;
+  UIP_IP_BUF->len[1] = (uip_len - UIP_IPH_LEN) & 0xff;
+  return uip_len;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+ns_craft_input(void)
+{
+  uint8_t *aro;
+
+  uip_ext_len = 0;
+  uip_icmp6_input(UIP_ICMP_BUF->type, UIP_ICMP_BUF->icode);
+  if(uip_len == 0) {
+    return NS_CRAFT_DROPPED;
+  }
+  if(uip_len < UIP_IPH_LEN + UIP_ICMPH_LEN + UIP_ND6_NA_LEN +
+     UIP_ND6_OPT_LLAO_LEN + ARO_OPT_LEN) {
+    uip_clear_buf();
+    return NS_CRAFT_NA;
+  }
+  aro = &uip_buf[UIP_LLH_LEN + UIP_IPH_LEN + UIP_ICMPH_LEN + UIP_ND6_NA_LEN +
+                 UIP_ND6_OPT_LLAO_LEN];
+  uip_clear_buf();
+  return ((uip_nd6_opt_aro *)aro)->status == UIP_ND6_ARO_SUCCESS ?
+    NS_CRAFT_REGISTERED : NS_CRAFT_DUPLICATE;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+ns_craft_input_raw(const uint8_t *data, uint16_t len)
+{
+  if(len < sizeof(uip_ipaddr_t) + UIP_ICMPH_LEN ||
+     len > sizeof(uip_ipaddr_t) + UIP_BUFSIZE - UIP_LLH_LEN - UIP_IPH_LEN) {
+    return NS_CRAFT_DROPPED;
+  }
+  len -= sizeof(uip_ipaddr_t);
+  uip_ext_len = 0;
+  memset(UIP_IP_BUF, 0, UIP_IPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->proto = UIP_PROTO_ICMP6;
+  UIP_IP_BUF->ttl = UIP_ND6_HOP_LIMIT;
+  UIP_IP_BUF->len[0] = len >> 8;
+  UIP_IP_BUF->len[1] = len & 0xff;
+  memcpy(&UIP_IP_BUF->srcipaddr, data, sizeof(uip_ipaddr_t));
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &uip_ds6_get_link_local(-1)->ipaddr);
+  memcpy(UIP_ICMP_BUF, data + sizeof(uip_ipaddr_t), len);
+  UIP_ICMP_BUF->type = ICMP6_NS;
+  uip_len = UIP_IPH_LEN + len;
+  return ns_craft_input();
+}
+/*---------------------------------------------------------------------------*/
+uip_ds6_reg_t *
+ns_craft_reg(uint16_t i)
+{
+  uip_ds6_reg_t *reg;
+
+  for(reg = uip_ds6_reg_list; reg < uip_ds6_reg_list + UIP_DS6_REG_LIST_SIZE;
+      reg++) {
+    if(reg->isused && i-- == 0) {
+      return reg;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+ns_craft_reg_num(void)
+{
+  uint16_t n = 0;
+
+  while(ns_craft_reg(n) != NULL) {
+    n++;
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+
+/**
+ * \file
+ *         Synthetic secured NS messages for the 6LBR, as a 6LN sends them
+ */
+
+#ifndef NS_CRAFT_H_
+#define NS_CRAFT_H_
+
+#include "contiki.h"
+#include "net/ipv6/uip-ds6-reg.h"
+
+/* Option orders, as a permutation of NONCE, AUTH, SLLAO and ARO */
+enum {
+  NS_CRAFT_ORDER_6LN,        /* NONCE AUTH SLLAO ARO, what the 6LN sends */
+  NS_CRAFT_ORDER_ARO_FIRST,  /* SLLAO ARO NONCE AUTH */
+  NS_CRAFT_ORDER_AUTH_FIRST, /* AUTH NONCE SLLAO ARO */
+  NS_CRAFT_ORDER_REVERSED,   /* ARO SLLAO AUTH NONCE */
+  NS_CRAFT_ORDER_NUM
+};
+
+/* Defects of the crafted NS */
+#define NS_CRAFT_BAD_MAC      0x01 /* EUI-64 not in the registration table */
+#define NS_CRAFT_BAD_NONCE    0x02 /* replay of the last accepted counter */
+#define NS_CRAFT_BAD_AUTH     0x04 /* one bit of the authenticator flipped */
+#define NS_CRAFT_NO_AUTH      0x08 /* NONCE and AUTH left out */
+
+/* Outcome of ns_craft_input() */
+enum {
+  NS_CRAFT_DROPPED,          /* no NA */
+  NS_CRAFT_NA,               /* NA without ARO */
+  NS_CRAFT_REGISTERED,       /* NA with ARO status success */
+  NS_CRAFT_DUPLICATE,        /* NA with ARO status duplicate */
+};
+
+/* Write into uip_buf a NS from the 6LN of registration entry reg to the
+ * 6LBR, with a counter one above the last accepted one. Returns the
+ * length of the IPv6 packet */
+uint16_t ns_craft(const uip_ds6_reg_t *reg, uint8_t order, uint8_t defects);
+
+/* Feed len bytes to the 6LBR as a NS, as uip_process() would: the
+ * source address (16 bytes) followed by the ICMPv6 message. The ICMPv6
+ * type is forced to NS */
+uint8_t ns_craft_input_raw(const uint8_t *data, uint16_t len);
+
+/* Feed the packet in uip_buf, of uip_len bytes, to the ICMPv6 input */
+uint8_t ns_craft_input(void);
+
+/* The i-th used entry of the registration table, NULL past the last */
+uip_ds6_reg_t *ns_craft_reg(uint16_t i);
+
+/* Number of used entries of the registration table */
+uint16_t ns_craft_reg_num(void);
+
+#endif /* NS_CRAFT_H_ */
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef ND6_BENCH_PROJECT_CONF_H_
+#define ND6_BENCH_PROJECT_CONF_H_
+
+/* The 6LBR configuration under test, which sets UIP_CONF_ND6_SEND_RA
+ * again */
+#undef UIP_CONF_ND6_SEND_RA
+#include "../project-conf.h"
+
+/* 2-byte link-layer addresses, as on sky */
+#undef LINKADDR_CONF_SIZE
+#define LINKADDR_CONF_SIZE    2
+
+/* Addresses are registered with the ARO, no DAD NS is sent */
+#define UIP_CONF_ND6_DEF_MAXDADNS 0
+
+/* Keep the ND debug output and the trace records off the console */
+#define UIP_ND6_CONF_DEBUG    0
+#define ND6_TRACE_CONF_OUTPUT 0
+
+#endif /* ND6_BENCH_PROJECT_CONF_H_ */
@@ -47,6 +47,10 @@
 #define UIP_CONF_ND6_NS_NONCE			1
 #define UIP_CONF_ND6_NS_AUTH			1
 
+/* ND counters in uip_stat.nd6 and the registration latency histograms
+ * (core/net/ipv6/nd6-stats.h), reported every minute */
+#define UIP_CONF_STATISTICS		1
+
 
 
 #define AUTH_NODE_NUM 		7
@@ -67,4 +71,69 @@
 						{0x06,0x66,0xDF,0x02,0x00,0xC3,0x19,0x2A,0x12,0xB3,0xCC,0x42,0xAE,0xFE,0xF2,0x03}, \
 						{0x07,0x77,0xDF,0x02,0x00,0xC3,0x19,0x2A,0x12,0xB3,0xCC,0x42,0xAE,0xFE,0xF2,0x03}}
 
+/* TSCH with Orchestra, used by the registration latency simulations
+ * (sim4.4-1LBR-20N-tsch*.csc). Build with MAKE_WITH_TSCH=1 and, for
+ * dedicated ND cells, MAKE_WITH_ORCHESTRA_ND=1. */
+#if WITH_TSCH
+#undef NETSTACK_CONF_MAC
+#define NETSTACK_CONF_MAC     tschmac_driver
+#undef NETSTACK_CONF_RDC
+#define NETSTACK_CONF_RDC     nordc_driver
+#undef NETSTACK_CONF_FRAMER
+#define NETSTACK_CONF_FRAMER  framer_802154
+#undef FRAME802154_CONF_VERSION
+#define FRAME802154_CONF_VERSION FRAME802154_IEEE802154E_2012
+#undef IEEE802154_CONF_PANID
+#define IEEE802154_CONF_PANID 0xabcd
+/* Started from the application, once the 6LBR became coordinator */
+#undef TSCH_CONF_AUTOSTART
+#define TSCH_CONF_AUTOSTART 0
+/* cc2420: no DCO calibration, SFD timestamps for TSCH */
+#undef DCOSYNCH_CONF_ENABLED
+#define DCOSYNCH_CONF_ENABLED 0
+#undef CC2420_CONF_SFD_TIMESTAMPS
+#define CC2420_CONF_SFD_TIMESTAMPS 1
+
+#define TSCH_SCHEDULE_CONF_WITH_6TISCH_MINIMAL 0
+#define TSCH_CONF_WITH_LINK_SELECTOR 1
+/* The 6LBR keeps a TSCH queue for each registering 6LN */
+#define TSCH_QUEUE_CONF_HASH_SIZE 8
+#define TSCH_CALLBACK_NEW_TIME_SOURCE orchestra_callback_new_time_source
+#define TSCH_CALLBACK_PACKET_READY orchestra_callback_packet_ready
+#if WITH_ORCHESTRA_ND
+#define ORCHESTRA_CONF_RULES { &eb_per_time_source, &unicast_per_neighbor_nd, &default_common }
+#else
+#define ORCHESTRA_CONF_RULES { &eb_per_time_source, &default_common }
+#endif
+#endif /* WITH_TSCH */
+
+/* Authorize AUTH_SIM_NODE_NUM simulated 6LNs (sky mote IDs starting at
+ * AUTH_SIM_FIRST_ID) that all use the key of the 6LN firmware */
+#ifdef AUTH_SIM_NODE_NUM
+#define AUTH_SIM_FIRST_ID	2
+#define AUTH_SIM_KEY {0x01,0x11,0xAE,0xCC,0xD1,0xB2,0x02,0x02,0x00,0xA2,0xBB,0x87,0x9D,0xE2,0x02,0x02}
+#undef NBR_TABLE_CONF_MAX_NEIGHBORS
+#define NBR_TABLE_CONF_MAX_NEIGHBORS	(AUTH_SIM_NODE_NUM + 2)
+/* registrations are spread over UIP_DS6_ADDR_NB slices */
+#define UIP_DS6_CONF_REGS_PER_ADDR	\
+  ((AUTH_NODE_NUM + AUTH_SIM_NODE_NUM + UIP_DS6_ADDR_NB - 1) / UIP_DS6_ADDR_NB)
+#endif
+
+/* Native build on the UDP multicast radio medium, to run hundreds of
+ * nodes as Linux processes. Build with TARGET=native
+ * MAKE_WITH_MCASTRADIO=1, see cpu/native/net/README-MCASTRADIO.md */
+#if WITH_MCASTRADIO
+#undef NETSTACK_CONF_RADIO
+#define NETSTACK_CONF_RADIO   mcastradio_driver
+/* 2-byte link-layer addresses, as on sky */
+#undef LINKADDR_CONF_SIZE
+#define LINKADDR_CONF_SIZE    2
+#if !WITH_TSCH
+#undef NETSTACK_CONF_MAC
+#define NETSTACK_CONF_MAC     csma_driver
+#endif /* !WITH_TSCH */
+/* Addresses are registered with the ARO, no DAD NS is sent */
+#define UIP_CONF_ND6_DEF_MAXDADNS 0
+#endif /* WITH_MCASTRADIO */
+
 #endif
@@ -49,6 +49,8 @@
 #define ORCHESTRA_RULES { &eb_per_time_source, &unicast_per_neighbor_rpl_storing, &default_common }
 /* Example configuration for RPL non-storing mode: */
 /* #define ORCHESTRA_RULES { &eb_per_time_source, &unicast_per_neighbor_rpl_ns, &default_common } */
+/* Example configuration for 6LoWPAN-ND without RPL, with dedicated cells for registrations: */
+/* #define ORCHESTRA_RULES { &eb_per_time_source, &unicast_per_neighbor_nd, &default_common } */
 
 #endif /* ORCHESTRA_CONF_RULES */
 
@@ -72,6 +74,21 @@
 #define ORCHESTRA_UNICAST_PERIOD                  17
 #endif /* ORCHESTRA_CONF_UNICAST_PERIOD */
 
+#ifdef ORCHESTRA_CONF_ND_PERIOD
+#define ORCHESTRA_ND_PERIOD                       ORCHESTRA_CONF_ND_PERIOD
+#else /* ORCHESTRA_CONF_ND_PERIOD */
+#define ORCHESTRA_ND_PERIOD                       13
+#endif /* ORCHESTRA_CONF_ND_PERIOD */
+
+/* How long a transmit link of the 6LoWPAN-ND slotframe survives without
+ * carrying any ND message. Should exceed the re-registration interval
+ * for links towards registered 6LNs to persist. */
+#ifdef ORCHESTRA_CONF_ND_LINK_LIFETIME
+#define ORCHESTRA_ND_LINK_LIFETIME                ORCHESTRA_CONF_ND_LINK_LIFETIME
+#else /* ORCHESTRA_CONF_ND_LINK_LIFETIME */
+#define ORCHESTRA_ND_LINK_LIFETIME                (60 * CLOCK_SECOND)
+#endif /* ORCHESTRA_CONF_ND_LINK_LIFETIME */
+
 /* Is the per-neighbor unicast slotframe sender-based (if not, it is receiver-based).
  * Note: sender-based works only with RPL storing mode as it relies on DAO and
  * routing entries to keep track of children and parents. */
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Shell interface to the 6LoWPAN-ND registration statistics
+ */
+
+#include "shell.h"
+#include "net/ipv6/nd6-stats.h"
+#include <stdio.h>
+#include <string.h>
+
+/*---------------------------------------------------------------------------*/
+PROCESS(shell_nd6stats_process, "nd6stats");
+SHELL_COMMAND(nd6stats_command,
+	      "nd6stats",
+	      "nd6stats [reset | interval]: print the ND registration statistics, clear them or print them every <interval> seconds",
+	      &shell_nd6stats_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_nd6stats_process, ev, data)
+{
+#if ND6_STATS_ENABLED
+  char buf[10];
+  int interval;
+#endif /* ND6_STATS_ENABLED */
+
+  PROCESS_BEGIN();
+
+#if ND6_STATS_ENABLED
+  if(data != NULL && strncmp(data, "reset", 5) == 0) {
+    nd6_stats_reset();
+    shell_output_str(&nd6stats_command, "ND registration statistics cleared", "");
+    PROCESS_EXIT();
+  }
+
+  interval = shell_strtolong(data, NULL);
+
+  nd6_stats_stop();
+  if(data == NULL || interval == 0) {
+    nd6_stats_print("");
+  } else {
+    nd6_stats_start(interval * CLOCK_SECOND);
+    sprintf(buf, "%d", interval);
+    shell_output_str(&nd6stats_command, "Printing ND registration statistics every ", buf);
+  }
+#else /* ND6_STATS_ENABLED */
+  shell_output_str(&nd6stats_command, "ND registration statistics are disabled", "");
+#endif /* ND6_STATS_ENABLED */
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+shell_nd6_init(void)
+{
+  shell_register_command(&nd6stats_command);
+}
+/*---------------------------------------------------------------------------*/
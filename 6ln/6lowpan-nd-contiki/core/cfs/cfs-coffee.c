@@ -84,6 +84,17 @@
 #define COFFEE_EXTENDED_WEAR_LEVELLING  1
 #endif
 
+/*
+ * Number of files whose first page is kept in RAM, by a hash of their
+ * name. Opening a file that is not in coffee_files[] then reads one
+ * header instead of scanning the storage. The index is built at the
+ * first lookup; if there are more files than entries, lookups of the
+ * files that did not fit fall back to the scan. 0 disables the index.
+ */
+#ifndef COFFEE_NAME_INDEX_SIZE
+#define COFFEE_NAME_INDEX_SIZE  16
+#endif
+
 #if COFFEE_START & (COFFEE_SECTOR_SIZE - 1)
 #error COFFEE_START must point to the first byte in a sector.
 #endif
@@ -206,6 +217,16 @@ static struct file_desc coffee_fd_set[COFFEE_FD_SET_SIZE];
 static coffee_page_t next_free;
 static char gc_wait;
 
+#if COFFEE_NAME_INDEX_SIZE > 0
+/* Name index flags. */
+#define NAME_INDEX_VALID     0x1 /* Built and kept up to date. */
+#define NAME_INDEX_OVERFLOW  0x2 /* Some files are not in the index. */
+
+static coffee_page_t name_index_page[COFFEE_NAME_INDEX_SIZE];
+static uint8_t name_index_hash[COFFEE_NAME_INDEX_SIZE];
+static uint8_t name_index_flags;
+#endif /* COFFEE_NAME_INDEX_SIZE > 0 */
+
 /*---------------------------------------------------------------------------*/
 static void
 write_header(struct file_header *hdr, coffee_page_t page)
@@ -223,6 +244,74 @@ read_header(struct file_header *hdr, coffee_page_t page)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_NAME_INDEX_SIZE > 0
+static uint8_t
+name_hash(const char *name)
+{
+  uint8_t hash;
+  int i;
+
+  /* Only the part of the name that fits into a file header. */
+  hash = 0;
+  for(i = 0; i < COFFEE_NAME_LENGTH - 1 && name[i] != '\0'; i++) {
+    hash = ((hash << 3) | (hash >> 5)) ^ (uint8_t)name[i];
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+static void
+name_index_clear(void)
+{
+  int i;
+
+  for(i = 0; i < COFFEE_NAME_INDEX_SIZE; i++) {
+    name_index_page[i] = INVALID_PAGE;
+  }
+  name_index_flags = NAME_INDEX_VALID;
+}
+/*---------------------------------------------------------------------------*/
+static void
+name_index_add(const char *name, coffee_page_t page)
+{
+  int i;
+
+  if(!(name_index_flags & NAME_INDEX_VALID)) {
+    /* It will be built from the storage, with this file. */
+    return;
+  }
+
+  for(i = 0; i < COFFEE_NAME_INDEX_SIZE; i++) {
+    if(name_index_page[i] == INVALID_PAGE) {
+      name_index_page[i] = page;
+      name_index_hash[i] = name_hash(name);
+      return;
+    }
+  }
+  name_index_flags |= NAME_INDEX_OVERFLOW;
+}
+/*---------------------------------------------------------------------------*/
+static void
+name_index_remove(coffee_page_t page)
+{
+  int i;
+
+  for(i = 0; i < COFFEE_NAME_INDEX_SIZE; i++) {
+    if(name_index_page[i] == page) {
+      name_index_page[i] = INVALID_PAGE;
+    }
+  }
+
+  if(name_index_flags & NAME_INDEX_OVERFLOW) {
+    /* A file that did not fit may fit now. Rebuild at the next lookup. */
+    name_index_flags = 0;
+  }
+}
+#else /* COFFEE_NAME_INDEX_SIZE > 0 */
+#define name_index_clear()
+#define name_index_add(name, page)
+#define name_index_remove(page)
+#endif /* COFFEE_NAME_INDEX_SIZE > 0 */
+/*---------------------------------------------------------------------------*/
 static cfs_offset_t
 absolute_offset(coffee_page_t page, cfs_offset_t offset)
 {
@@ -452,12 +541,37 @@ load_file(coffee_page_t start, struct file_header *hdr)
   return file;
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_NAME_INDEX_SIZE > 0
+static void
+name_index_build(void)
+{
+  struct file_header hdr;
+  coffee_page_t page;
+
+  name_index_clear();
+  for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
+    read_header(&hdr, page);
+    if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr)) {
+      name_index_add(hdr.name, page);
+      if(name_index_flags & NAME_INDEX_OVERFLOW) {
+        break;
+      }
+    }
+  }
+  PRINTF("Coffee: Built the name index%s\n",
+         name_index_flags & NAME_INDEX_OVERFLOW ? ", overflowed" : "");
+}
+#endif /* COFFEE_NAME_INDEX_SIZE > 0 */
+/*---------------------------------------------------------------------------*/
 static struct file *
 find_file(const char *name)
 {
   int i;
   struct file_header hdr;
   coffee_page_t page;
+#if COFFEE_NAME_INDEX_SIZE > 0
+  uint8_t hash;
+#endif
 
   /* First check if the file metadata is cached. */
   for(i = 0; i < COFFEE_MAX_OPEN_FILES; i++) {
@@ -471,6 +585,30 @@ find_file(const char *name)
     }
   }
 
+#if COFFEE_NAME_INDEX_SIZE > 0
+  /* Then the name index, which needs one header read per hash match. */
+  if(!(name_index_flags & NAME_INDEX_VALID)) {
+    name_index_build();
+  }
+
+  hash = name_hash(name);
+  for(i = 0; i < COFFEE_NAME_INDEX_SIZE; i++) {
+    if(name_index_page[i] == INVALID_PAGE || name_index_hash[i] != hash) {
+      continue;
+    }
+
+    read_header(&hdr, name_index_page[i]);
+    if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr) && strcmp(name, hdr.name) == 0) {
+      return load_file(name_index_page[i], &hdr);
+    }
+  }
+
+  if(!(name_index_flags & NAME_INDEX_OVERFLOW)) {
+    /* Every file is in the index. */
+    return NULL;
+  }
+#endif /* COFFEE_NAME_INDEX_SIZE > 0 */
+
   /* Scan the flash memory sequentially otherwise. */
   for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
     read_header(&hdr, page);
@@ -572,6 +710,7 @@ remove_by_page(coffee_page_t page, int remove_log,
 
   hdr.flags |= HDR_FLAG_OBSOLETE;
   write_header(&hdr, page);
+  name_index_remove(page);
 
   gc_wait = 0;
 
@@ -636,6 +775,9 @@ reserve(const char *name, coffee_page_t pages,
   hdr.max_pages = pages;
   hdr.flags = HDR_FLAG_ALLOCATED | flags;
   write_header(&hdr, page);
+  if(!(flags & HDR_FLAG_LOG)) {
+    name_index_add(name, page);
+  }
 
   PRINTF("Coffee: Reserved %u pages starting from %u for file %s\n",
          (unsigned)pages, (unsigned)page, name);
@@ -1338,6 +1480,7 @@ cfs_coffee_format(void)
   memset(&coffee_fd_set, 0, sizeof(coffee_fd_set));
   next_free = 0;
   gc_wait = 1;
+  name_index_clear();
 
   PRINTF(" done!\n");
 
@@ -51,6 +51,28 @@
 #define AES_128            aes_128_driver
 #endif /* AES_128_CONF */
 
+/* Encryption in the software driver: byte-oriented rounds (0), or
+   32-bit table lookups (1), which are several times faster but take
+   1 KB of tables */
+#ifdef AES_128_CONF_TTABLE
+#define AES_128_TTABLE     AES_128_CONF_TTABLE
+#else /* AES_128_CONF_TTABLE */
+#define AES_128_TTABLE     0
+#endif /* AES_128_CONF_TTABLE */
+
+/**
+ * A key together with its key schedule. Keeping one context per key
+ * avoids expanding the key again each time it is used.
+ */
+struct aes_128_context {
+  uint8_t key[AES_128_KEY_LENGTH];
+#if AES_128_TTABLE
+  uint32_t round_keys[44];
+#else /* AES_128_TTABLE */
+  uint8_t round_keys[11][AES_128_BLOCK_SIZE];
+#endif /* AES_128_TTABLE */
+};
+
 /**
  * Structure of AES drivers.
  */
@@ -65,6 +87,13 @@ struct aes_128_driver {
    * \brief Encrypts.
    */
   void (* encrypt)(uint8_t *plaintext_and_result);
+
+  /**
+   * \brief Makes a context initialized with aes_128_init_context()
+   *        the current key, without expanding the key again. Optional,
+   *        use aes_128_set_context().
+   */
+  void (* set_context)(const struct aes_128_context *context);
 };
 
 /**
@@ -72,6 +101,18 @@ struct aes_128_driver {
  */
 void aes_128_set_padded_key(uint8_t *key, uint8_t key_len);
 
+/**
+ * \brief Stores a key and its key schedule in a context
+ */
+void aes_128_init_context(struct aes_128_context *context,
+                          const uint8_t *key);
+
+/**
+ * \brief Makes the key of a context the current key of AES_128. Falls
+ *        back to AES_128.set_key when the driver keeps its own schedule.
+ */
+void aes_128_set_context(const struct aes_128_context *context);
+
 extern const struct aes_128_driver AES_128;
 
 #endif /* AES_128_H_ */
@@ -527,6 +527,69 @@ tcpip_input(void)
 }
 /*---------------------------------------------------------------------------*/
 #if NETSTACK_CONF_WITH_IPV6
+#if UIP_CONF_IPV6_QUEUE_PKT
+/* Append the packet in uip_buf to the tail of the queue of nbr */
+static struct uip_packetqueue_packet *
+queue_packet(uip_ds6_nbr_t *nbr)
+{
+  struct uip_packetqueue_packet *p;
+
+  p = uip_packetqueue_alloc(&nbr->packethandle, UIP_DS6_NBR_PACKET_LIFETIME);
+  if(p != NULL) {
+    memcpy(p->queue_buf, UIP_IP_BUF, uip_len);
+    p->queue_buf_len = uip_len;
+  } else {
+    PRINTF("tcpip_ipv6_output: queue full, dropping packet\n");
+  }
+  return p;
+}
+/*---------------------------------------------------------------------------*/
+/* An ND message in uip_buf: it resolves neighbors and registers
+   addresses, so it is never held back */
+static int
+is_nd_message(void)
+{
+  uint8_t type;
+
+  if(UIP_IP_BUF->proto != UIP_PROTO_ICMP6) {
+    return 0;
+  }
+  type = ((struct uip_icmp_hdr *)&uip_buf[UIP_LLIPH_LEN])->type;
+  return type >= ICMP6_RS && type <= ICMP6_REDIRECT;
+}
+/*---------------------------------------------------------------------------*/
+/* The packet in uip_buf is sent from one of our addresses that is still
+   waiting for its registration (ARO) to succeed */
+static int
+awaiting_registration(void)
+{
+  uip_ds6_addr_t *addr;
+
+  if(is_nd_message()) {
+    return 0;
+  }
+  addr = uip_ds6_addr_lookup(&UIP_IP_BUF->srcipaddr);
+  return addr != NULL && addr->state == ADDR_TENTATIVE;
+}
+/*---------------------------------------------------------------------------*/
+void
+tcpip_ipv6_output_queued(uip_ds6_nbr_t *nbr)
+{
+  while(uip_packetqueue_count(&nbr->packethandle) > 0) {
+    uip_len = uip_packetqueue_buflen(&nbr->packethandle);
+    memcpy(UIP_IP_BUF, uip_packetqueue_buf(&nbr->packethandle), uip_len);
+    if(awaiting_registration()) {
+      /* Held, with the packets behind it, until the registration
+         succeeds */
+      break;
+    }
+    uip_packetqueue_free(&nbr->packethandle);
+    tcpip_output(uip_ds6_nbr_get_ll(nbr));
+  }
+  uip_clear_buf();
+}
+/*---------------------------------------------------------------------------*/
+#endif /* UIP_CONF_IPV6_QUEUE_PKT */
 void
 tcpip_ipv6_output(void)
 {
@@ -675,10 +738,7 @@ tcpip_ipv6_output(void)
       } else {
 #if UIP_CONF_IPV6_QUEUE_PKT
         /* Copy outgoing pkt in the queuing buffer for later transmit. */
-        if(uip_packetqueue_alloc(&nbr->packethandle, UIP_DS6_NBR_PACKET_LIFETIME) != NULL) {
-          memcpy(uip_packetqueue_buf(&nbr->packethandle), UIP_IP_BUF, uip_len);
-          uip_packetqueue_set_buflen(&nbr->packethandle, uip_len);
-        }
+        queue_packet(nbr);
 #endif
         /* RFC4861, 7.2.2:
          * "If the source address of the packet prompting the solicitation is the
@@ -708,10 +768,7 @@ tcpip_ipv6_output(void)
 #if UIP_CONF_IPV6_QUEUE_PKT
         /* Copy outgoing pkt in the queuing buffer for later transmit and set
            the destination nbr to nbr. */
-        if(uip_packetqueue_alloc(&nbr->packethandle, UIP_DS6_NBR_PACKET_LIFETIME) != NULL) {
-          memcpy(uip_packetqueue_buf(&nbr->packethandle), UIP_IP_BUF, uip_len);
-          uip_packetqueue_set_buflen(&nbr->packethandle, uip_len);
-        }
+        queue_packet(nbr);
 #endif /*UIP_CONF_IPV6_QUEUE_PKT*/
         uip_clear_buf();
         return;
@@ -726,21 +783,27 @@ tcpip_ipv6_output(void)
       }
 #endif /* UIP_ND6_SEND_NS */
 
-      tcpip_output(uip_ds6_nbr_get_ll(nbr));
-
 #if UIP_CONF_IPV6_QUEUE_PKT
       /*
        * Send the queued packets from here, may not be 100% perfect though.
        * This happens in a few cases, for example when instead of receiving a
        * NA after sendiong a NS, you receive a NS with SLLAO: the entry moves
-       * to STALE, and you must both send a NA and the queued packet.
+       * to STALE, and you must both send a NA and the queued packets.
+       * To keep the packets in order, the current packet is appended to the
+       * queue; it is only sent ahead of the queue if there is no room left.
+       * ND messages are sent at once. A packet whose source address is
+       * still being registered is queued until the registration succeeds,
+       * and dropped if there is no room left.
        */
-      if(uip_packetqueue_buflen(&nbr->packethandle) != 0) {
-        uip_len = uip_packetqueue_buflen(&nbr->packethandle);
-        memcpy(UIP_IP_BUF, uip_packetqueue_buf(&nbr->packethandle), uip_len);
-        uip_packetqueue_free(&nbr->packethandle);
+      if(is_nd_message() ||
+         (uip_packetqueue_count(&nbr->packethandle) == 0 &&
+          !awaiting_registration()) ||
+         (queue_packet(nbr) == NULL && !awaiting_registration())) {
         tcpip_output(uip_ds6_nbr_get_ll(nbr));
       }
+      tcpip_ipv6_output_queued(nbr);
+#else /*UIP_CONF_IPV6_QUEUE_PKT*/
+      tcpip_output(uip_ds6_nbr_get_ll(nbr));
 #endif /*UIP_CONF_IPV6_QUEUE_PKT*/
 
       uip_clear_buf();
@@ -818,6 +881,9 @@ PROCESS_THREAD(tcpip_process, ev, data)
 {
   PROCESS_BEGIN();
 
+  /* Incoming packets and the ND timers go before application events */
+  process_set_prio(PROCESS_CURRENT(), PROCESS_PRIO_HIGH);
+
 #if UIP_TCP
   {
     unsigned char i;
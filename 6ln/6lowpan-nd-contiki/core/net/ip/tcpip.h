@@ -355,6 +355,16 @@ void tcpip_set_outputfunc(uint8_t (* f)(void));
 void tcpip_ipv6_output(void);
 #endif
 
+/**
+ * \brief Send, in order, all packets queued for a neighbor while its
+ * address was being resolved. Stops at a packet whose source address
+ * still awaits its registration. Clobbers uip_buf.
+ */
+#if NETSTACK_CONF_WITH_IPV6 && UIP_CONF_IPV6_QUEUE_PKT
+struct uip_ds6_nbr;
+void tcpip_ipv6_output_queued(struct uip_ds6_nbr *nbr);
+#endif
+
 /**
  * \brief Is forwarding generally enabled?
  */
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+
+/**
+ * \file
+ *         Latency histograms of the 6LoWPAN-ND registration path
+ */
+
+#include "contiki.h"
+#include "net/ipv6/nd6-stats.h"
+#include "net/ip/uip.h"
+#include "net/linkaddr.h"
+#include <stdio.h>
+#include <string.h>
+
+#if ND6_STATS_ENABLED
+
+#define ND6_STATS_RTT_NUM (ND6_STATS_HIST_NUM - ND6_STATS_FIRST_RTT)
+
+struct nd6_stats_hist nd6_stats_hist[ND6_STATS_HIST_NUM];
+
+static const char *const hist_name[ND6_STATS_HIST_NUM] = {
+  "ns_mac", "ns_nonce", "ns_lbr_info", "ns_hash", "ns_reg", "ns_total",
+  "rs_ra", "ns_na"
+};
+
+static rtimer_clock_t begin_time;
+static rtimer_clock_t lap_time;
+static clock_time_t rtt_time[ND6_STATS_RTT_NUM];
+static uint8_t rtt_pending;
+
+PROCESS(nd6_stats_process, "Periodic ND6 stats output");
+/*---------------------------------------------------------------------------*/
+void
+nd6_stats_add(uint8_t hist, uint32_t value)
+{
+  struct nd6_stats_hist *h;
+  uint8_t i;
+
+  if(hist >= ND6_STATS_HIST_NUM) {
+    return;
+  }
+  h = &nd6_stats_hist[hist];
+
+  /* Bucket: floor(log2(value)), 0 for 0 and 1 */
+  for(i = 0; i < ND6_STATS_BUCKETS - 1 && (value >> (i + 1)) != 0; i++);
+
+  if(h->count < 0xffff) {
+    h->count++;
+    h->bucket[i]++;
+    h->sum += value;
+  }
+  if(value > h->max) {
+    h->max = value > 0xffff ? 0xffff : value;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+nd6_stats_begin(void)
+{
+  begin_time = lap_time = RTIMER_NOW();
+}
+/*---------------------------------------------------------------------------*/
+void
+nd6_stats_mark(void)
+{
+  lap_time = RTIMER_NOW();
+}
+/*---------------------------------------------------------------------------*/
+void
+nd6_stats_lap(uint8_t hist)
+{
+  rtimer_clock_t now = RTIMER_NOW();
+
+  nd6_stats_add(hist, (rtimer_clock_t)(now - lap_time));
+  lap_time = now;
+}
+/*---------------------------------------------------------------------------*/
+void
+nd6_stats_end(uint8_t hist)
+{
+  nd6_stats_add(hist, (rtimer_clock_t)(RTIMER_NOW() - begin_time));
+}
+/*---------------------------------------------------------------------------*/
+void
+nd6_stats_rtt_start(uint8_t hist)
+{
+  uint8_t i = hist - ND6_STATS_FIRST_RTT;
+
+  if(i < ND6_STATS_RTT_NUM) {
+    rtt_time[i] = clock_time();
+    rtt_pending |= 1 << i;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+nd6_stats_rtt_end(uint8_t hist)
+{
+  uint8_t i = hist - ND6_STATS_FIRST_RTT;
+
+  /* Only the first answer to a request counts, unsolicited ones don't */
+  if(i < ND6_STATS_RTT_NUM && (rtt_pending & (1 << i))) {
+    rtt_pending &= ~(1 << i);
+    nd6_stats_add(hist, clock_time() - rtt_time[i]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+nd6_stats_reset(void)
+{
+  memset(nd6_stats_hist, 0, sizeof(nd6_stats_hist));
+  rtt_pending = 0;
+#if UIP_STATISTICS
+  memset(&uip_stat.nd6, 0, sizeof(uip_stat.nd6));
+#endif /* UIP_STATISTICS */
+}
+/*---------------------------------------------------------------------------*/
+void
+nd6_stats_print(const char *str)
+{
+  struct nd6_stats_hist *h;
+  uint8_t hist;
+  uint8_t i;
+
+#if UIP_STATISTICS
+  /* recv sent drop unautherr nonceerr autherr duperr */
+  printf("%s %lu N %d.%d %u %u %u %u %u %u %u\n",
+         str, (unsigned long)clock_time(),
+         linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+         (unsigned)uip_stat.nd6.recv, (unsigned)uip_stat.nd6.sent,
+         (unsigned)uip_stat.nd6.drop, (unsigned)uip_stat.nd6.unautherr,
+         (unsigned)uip_stat.nd6.nonceerr, (unsigned)uip_stat.nd6.autherr,
+         (unsigned)uip_stat.nd6.duperr);
+#endif /* UIP_STATISTICS */
+
+#if PROCESS_CONF_STATS
+  /* prio maxevents overflows, per event queue */
+  for(i = 0; i < PROCESS_PRIO_LEVELS; i++) {
+    printf("%s %lu Q %d.%d %u %u %u\n",
+           str, (unsigned long)clock_time(),
+           linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+           i, (unsigned)process_queue_stats[i].maxevents,
+           process_queue_stats[i].overflows);
+  }
+#endif /* PROCESS_CONF_STATS */
+
+  /* name ticks-per-second count sum max bucket... */
+  for(hist = 0; hist < ND6_STATS_HIST_NUM; hist++) {
+    h = &nd6_stats_hist[hist];
+    if(h->count == 0) {
+      continue;
+    }
+    printf("%s %lu H %d.%d %s %lu %u %lu %u",
+           str, (unsigned long)clock_time(),
+           linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+           hist_name[hist],
+           hist < ND6_STATS_FIRST_RTT ?
+           (unsigned long)RTIMER_SECOND : (unsigned long)CLOCK_SECOND,
+           h->count, (unsigned long)h->sum, h->max);
+    for(i = 0; i < ND6_STATS_BUCKETS; i++) {
+      printf(" %u", h->bucket[i]);
+    }
+    printf("\n");
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(nd6_stats_process, ev, data)
+{
+  static struct etimer periodic;
+  clock_time_t *period;
+  PROCESS_BEGIN();
+
+  period = data;
+
+  if(period == NULL) {
+    PROCESS_EXIT();
+  }
+  etimer_set(&periodic, *period);
+
+  while(1) {
+    PROCESS_WAIT_UNTIL(etimer_expired(&periodic));
+    etimer_reset(&periodic);
+    nd6_stats_print("ND6stats");
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+nd6_stats_start(clock_time_t period)
+{
+  process_start(&nd6_stats_process, (void *)&period);
+}
+/*---------------------------------------------------------------------------*/
+void
+nd6_stats_stop(void)
+{
+  process_exit(&nd6_stats_process);
+}
+#endif /* ND6_STATS_ENABLED */
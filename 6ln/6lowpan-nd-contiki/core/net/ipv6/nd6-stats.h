@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+
+/**
+ * \file
+ *         Latency histograms of the 6LoWPAN-ND registration path
+ *
+ *         The 6LBR times each phase of ns_input() and the 6LN the RS/RA
+ *         and NS/NA round trips. Each histogram has log2 buckets: bucket
+ *         0 counts values 0 and 1, bucket i > 0 values 2^i to 2^(i+1)-1
+ *         and the last bucket everything above. The failure reasons go
+ *         to uip_stat.nd6.
+ */
+
+#ifndef ND6_STATS_H_
+#define ND6_STATS_H_
+
+#include "contiki.h"
+#include "net/ip/uipopt.h"
+
+/******** Configuration *******/
+
+/* Enable the histograms, by default along with the uIP statistics */
+#ifdef ND6_STATS_CONF_ENABLED
+#define ND6_STATS_ENABLED ND6_STATS_CONF_ENABLED
+#else /* ND6_STATS_CONF_ENABLED */
+#define ND6_STATS_ENABLED UIP_STATISTICS
+#endif /* ND6_STATS_CONF_ENABLED */
+
+/* Number of log2 buckets per histogram */
+#ifdef ND6_STATS_CONF_BUCKETS
+#define ND6_STATS_BUCKETS ND6_STATS_CONF_BUCKETS
+#else /* ND6_STATS_CONF_BUCKETS */
+#define ND6_STATS_BUCKETS 16
+#endif /* ND6_STATS_CONF_BUCKETS */
+
+/************ Types ***********/
+
+/* Histograms. The ns_input() phases are in rtimer ticks, the round
+ * trips in clock ticks. */
+enum {
+  ND6_STATS_NS_MAC,       /* 6LBR: EUI-64 lookup of the ARO */
+  ND6_STATS_NS_NONCE,     /* 6LBR: nonce check */
+  ND6_STATS_NS_LBR_INFO,  /* 6LBR: building the authenticated message */
+  ND6_STATS_NS_HASH,      /* 6LBR: hashing it */
+  ND6_STATS_NS_REG,       /* 6LBR: registration table update */
+  ND6_STATS_NS_TOTAL,     /* 6LBR: NS received to NA sent */
+  ND6_STATS_RS_RA,        /* 6LN: RS sent to RA received */
+  ND6_STATS_NS_NA,        /* 6LN: NS with ARO sent to NA received */
+  ND6_STATS_HIST_NUM
+};
+
+/* First histogram counted in clock ticks */
+#define ND6_STATS_FIRST_RTT ND6_STATS_RS_RA
+
+struct nd6_stats_hist {
+  uint32_t sum;
+  uint16_t count;
+  uint16_t max;
+  uint16_t bucket[ND6_STATS_BUCKETS];
+};
+
+/********** Functions *********/
+
+#if ND6_STATS_ENABLED
+
+extern struct nd6_stats_hist nd6_stats_hist[ND6_STATS_HIST_NUM];
+
+/* Add a value to a histogram */
+void nd6_stats_add(uint8_t hist, uint32_t value);
+/* Start timing the phases of an incoming message */
+void nd6_stats_begin(void);
+/* Start timing a phase */
+void nd6_stats_mark(void);
+/* Count the time since the last phase ended or was marked, and start
+ * the next one */
+void nd6_stats_lap(uint8_t hist);
+/* Count the time since nd6_stats_begin */
+void nd6_stats_end(uint8_t hist);
+/* Remember when a request was sent */
+void nd6_stats_rtt_start(uint8_t hist);
+/* Count the round trip if a request is outstanding */
+void nd6_stats_rtt_end(uint8_t hist);
+
+/* Clear the histograms and the ND counters of uip_stat */
+void nd6_stats_reset(void);
+/* Print the counters and all histograms that are not empty */
+void nd6_stats_print(const char *str);
+/* Print a report every period, like powertrace_start() */
+void nd6_stats_start(clock_time_t period);
+void nd6_stats_stop(void);
+
+#define ND6_STATS_BEGIN()          nd6_stats_begin()
+#define ND6_STATS_MARK()           nd6_stats_mark()
+#define ND6_STATS_LAP(hist)        nd6_stats_lap(hist)
+#define ND6_STATS_END(hist)        nd6_stats_end(hist)
+#define ND6_STATS_RTT_START(hist)  nd6_stats_rtt_start(hist)
+#define ND6_STATS_RTT_END(hist)    nd6_stats_rtt_end(hist)
+
+#else /* ND6_STATS_ENABLED */
+
+#define nd6_stats_reset()
+#define nd6_stats_print(str)
+#define nd6_stats_start(period)
+#define nd6_stats_stop()
+
+#define ND6_STATS_BEGIN()
+#define ND6_STATS_MARK()
+#define ND6_STATS_LAP(hist)
+#define ND6_STATS_END(hist)
+#define ND6_STATS_RTT_START(hist)
+#define ND6_STATS_RTT_END(hist)
+
+#endif /* ND6_STATS_ENABLED */
+
+#endif /* ND6_STATS_H_ */
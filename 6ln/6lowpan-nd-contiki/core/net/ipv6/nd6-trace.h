@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Binary trace of the secured 6LoWPAN-ND registration
+ *
+ *         The ND and registration code add fixed-size records to a ring
+ *         instead of formatting text. They stay there until the host
+ *         fetches them with nd6_trace_read(). With ND6_TRACE_CONF_OUTPUT,
+ *         a process writes them out as "#T" lines of hex instead, which
+ *         tools/nd6-trace/nd6-trace-decode turns back into readable text.
+ */
+
+#ifndef ND6_TRACE_H_
+#define ND6_TRACE_H_
+
+#include "contiki.h"
+
+/******** Configuration *******/
+
+/* Enable the trace */
+#ifdef ND6_TRACE_CONF_ENABLED
+#define ND6_TRACE_ENABLED ND6_TRACE_CONF_ENABLED
+#else /* ND6_TRACE_CONF_ENABLED */
+#define ND6_TRACE_ENABLED 1
+#endif /* ND6_TRACE_CONF_ENABLED */
+
+/* Number of records the ring holds, must be a power of two */
+#ifdef ND6_TRACE_CONF_LEN
+#define ND6_TRACE_LEN ND6_TRACE_CONF_LEN
+#else /* ND6_TRACE_CONF_LEN */
+#define ND6_TRACE_LEN 16
+#endif /* ND6_TRACE_CONF_LEN */
+
+/* 1: write the records to the console as they come in.
+ * 0: keep them in the ring until nd6_trace_read() fetches them */
+#ifdef ND6_TRACE_CONF_OUTPUT
+#define ND6_TRACE_OUTPUT ND6_TRACE_CONF_OUTPUT
+#else /* ND6_TRACE_CONF_OUTPUT */
+#define ND6_TRACE_OUTPUT 0
+#endif /* ND6_TRACE_CONF_OUTPUT */
+
+/************ Types ***********/
+
+/* Event IDs. Only ever append to this list: the decoder knows the
+ * events by number. */
+enum {
+  ND6_TRACE_START,        /* arg: CLOCK_SECOND, data: RTIMER_SECOND */
+  ND6_TRACE_DROPPED,      /* arg: records lost since the last one */
+  ND6_TRACE_RS_IN,        /* data: IID of the source */
+  ND6_TRACE_RS_OUT,       /* data: IID of the destination */
+  ND6_TRACE_RA_IN,        /* data: IID of the source */
+  ND6_TRACE_RA_OUT,       /* data: IID of the destination */
+  ND6_TRACE_NS_IN,        /* data: IID of the source */
+  ND6_TRACE_NS_OUT,       /* arg8: with ARO, data: IID of the destination */
+  ND6_TRACE_NA_IN,        /* arg8: ARO status, data: IID of the source */
+  ND6_TRACE_NA_OUT,       /* arg8: ARO status, data: IID of the destination */
+  ND6_TRACE_ARO_UNAUTH,   /* data: EUI-64 that is not authorized */
+  ND6_TRACE_NONCE,        /* arg8: valid, data: received counter */
+  ND6_TRACE_HASH,         /* arg: message length, data: rtimer ticks
+                             (4 bytes) and first 4 bytes of the digest */
+  ND6_TRACE_AUTH,         /* arg8: passed, data: first 4 bytes of the
+                             received and of the computed authenticator */
+  ND6_TRACE_REG,          /* arg: lifetime, arg8: state, data: EUI-64 */
+  ND6_TRACE_REG_RM,       /* data: EUI-64 */
+};
+
+/* One record, 16 bytes. Written out in this order, multi-byte fields
+ * little-endian. */
+struct nd6_trace_rec {
+  uint32_t time;          /* clock_time() */
+  uint16_t arg;
+  uint8_t event;
+  uint8_t arg8;
+  uint8_t data[8];
+};
+
+/********** Functions *********/
+
+#if ND6_TRACE_ENABLED
+
+/* Initialize the trace and log a ND6_TRACE_START record */
+void nd6_trace_init(void);
+/* Add a record, len bytes of data are copied (at most 8) */
+void nd6_trace_add(uint8_t event, uint8_t arg8, uint16_t arg,
+                   const void *data, uint8_t len);
+/* Fetch the oldest record. Returns 0 if the ring is empty */
+int nd6_trace_read(struct nd6_trace_rec *rec);
+/* Add a ND6_TRACE_HASH record */
+void nd6_trace_hash(uint16_t len, uint32_t ticks, const uint8_t *digest);
+
+#define ND6_TRACE(event, arg8, arg, data, len) \
+  nd6_trace_add((event), (arg8), (arg), (data), (len))
+
+#else /* ND6_TRACE_ENABLED */
+
+#define nd6_trace_init()
+#define nd6_trace_read(rec) 0
+#define nd6_trace_hash(len, ticks, digest)
+#define ND6_TRACE(event, arg8, arg, data, len)
+
+#endif /* ND6_TRACE_ENABLED */
+
+/* Interface identifier (last 8 bytes) of an IPv6 address, as trace data */
+#define ND6_TRACE_IID(addr) (&((uint8_t *)(addr))[8])
+
+#endif /* ND6_TRACE_H_ */
@@ -66,6 +66,7 @@
 #include "net/ip/tcpip.h"
 #include "net/ip/uip.h"
 #include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-icmp6.h"
 #include "net/rime/rime.h"
 #include "net/ipv6/sicslowpan.h"
 #include "net/netstack.h"
@@ -455,6 +456,68 @@ rime_sniffer_remove(struct rime_sniffer *s)
   callback = NULL;
 }
 
+/* Options of an RS, RA, NS or NA, as SICSLOWPAN_ND_PROFILE_ bits */
+static uint8_t
+nd_option_profile(void)
+{
+  uint16_t offset;
+  uint8_t profile = 0;
+  uint8_t *opt;
+
+  switch(UIP_ICMP_BUF->type) {
+  case ICMP6_RS:
+    offset = UIP_ND6_RS_LEN;
+    break;
+  case ICMP6_RA:
+    offset = UIP_ND6_RA_LEN;
+    break;
+  case ICMP6_NS:
+    offset = UIP_ND6_NS_LEN;
+    break;
+  case ICMP6_NA:
+    offset = UIP_ND6_NA_LEN;
+    break;
+  default:
+    return UIP_ICMP_BUF->icode;
+  }
+
+  for(offset += UIP_LLIPH_LEN + UIP_ICMPH_LEN;
+      offset + 2 <= UIP_LLH_LEN + uip_len;
+      offset += opt[1] << 3) {
+    opt = &uip_buf[offset];
+    if(opt[1] == 0) {
+      break;
+    }
+    switch(opt[0]) {
+    case UIP_ND6_OPT_SLLAO:
+      profile |= SICSLOWPAN_ND_PROFILE_SLLAO;
+      break;
+    case UIP_ND6_OPT_TLLAO:
+      profile |= SICSLOWPAN_ND_PROFILE_TLLAO;
+      break;
+    case UIP_ND6_OPT_PREFIX_INFO:
+      profile |= SICSLOWPAN_ND_PROFILE_PIO;
+      break;
+    case UIP_ND6_OPT_ARO:
+      profile |= SICSLOWPAN_ND_PROFILE_ARO;
+      break;
+    case UIP_ND6_OPT_6CO:
+      profile |= SICSLOWPAN_ND_PROFILE_6CO;
+      break;
+    case UIP_ND6_OPT_ABRO:
+      profile |= SICSLOWPAN_ND_PROFILE_ABRO;
+      break;
+    case UIP_ND6_OPT_NONCE:
+      profile |= SICSLOWPAN_ND_PROFILE_NONCE;
+      break;
+    case UIP_ND6_OPT_AUTH:
+      profile |= SICSLOWPAN_ND_PROFILE_AUTH;
+      break;
+    }
+  }
+  return profile;
+}
+
 static void
 set_packet_attrs(void)
 {
@@ -462,7 +525,8 @@ set_packet_attrs(void)
   /* set protocol in NETWORK_ID */
   packetbuf_set_attr(PACKETBUF_ATTR_NETWORK_ID, UIP_IP_BUF->proto);
 
-  /* assign values to the channel attribute (port or type + code) */
+  /* assign values to the channel attribute (port or type + code, or
+     type + option profile for ND) */
   if(UIP_IP_BUF->proto == UIP_PROTO_UDP) {
     c = UIP_UDP_BUF->srcport;
     if(UIP_UDP_BUF->destport < c) {
@@ -474,7 +538,7 @@ set_packet_attrs(void)
       c = UIP_TCP_BUF->destport;
     }
   } else if(UIP_IP_BUF->proto == UIP_PROTO_ICMP6) {
-    c = UIP_ICMP_BUF->type << 8 | UIP_ICMP_BUF->icode;
+    c = UIP_ICMP_BUF->type << 8 | nd_option_profile();
   }
 
   packetbuf_set_attr(PACKETBUF_ATTR_CHANNEL, c);
@@ -1312,6 +1376,16 @@ output(const uip_lladdr_t *localdest)
   }
 #endif
 
+  /* Neighbor discovery and routing messages are queued ahead of data */
+  if(UIP_IP_BUF->proto == UIP_PROTO_ICMP6 &&
+     (UIP_ICMP_BUF->type == ICMP6_RS || UIP_ICMP_BUF->type == ICMP6_RA ||
+      UIP_ICMP_BUF->type == ICMP6_NS || UIP_ICMP_BUF->type == ICMP6_NA ||
+      UIP_ICMP_BUF->type == ICMP6_REDIRECT ||
+      UIP_ICMP_BUF->type == ICMP6_RPL)) {
+    packetbuf_set_attr(PACKETBUF_ATTR_PRIORITY,
+                       PACKETBUF_ATTR_PRIORITY_CONTROL);
+  }
+
   /*
    * The destination address will be tagged to each outbound
    * packet. If the argument localdest is NULL, we are sending a
@@ -51,10 +51,26 @@
 #include "net/ipv6/uip-ds6-reg.h"
 #include "net/ipv6/uip-ds6.h"
 #include "net/ip/uip-nameserver.h"
+#include "net/ip/tcpip.h"
 #include "lib/random.h"
 #include "dev/ds2411/ds2411.h"
+#include "net/ipv6/nd6-trace.h"
+#include "net/ipv6/nd6-stats.h"
+#if UIP_ND6_NS_NONCE && UIP_ND6_NONCE_CFS
+#include "cfs/cfs.h"
+#endif
+#if UIP_ND6_PAIRWISE_LLSEC
+#include "net/packetbuf.h"
+#include "net/llsec/pairwisesec/pairwisesec.h"
+#endif /* UIP_ND6_PAIRWISE_LLSEC */
 /*------------------------------------------------------------------*/
-#define DEBUG 1
+/* Debug output of the secured ND, off unless UIP_ND6_CONF_DEBUG is set;
+ * nd6-trace records the same path without printf */
+#ifdef UIP_ND6_CONF_DEBUG
+#define DEBUG UIP_ND6_CONF_DEBUG
+#else /* UIP_ND6_CONF_DEBUG */
+#define DEBUG 0
+#endif /* UIP_ND6_CONF_DEBUG */
 #include "net/ip/uip-debug.h"
 #define PRINTADDR(addr) PRINTF("%02x%02x:%02x%02x:%02x%02x:%02x%02x ", ((uint8_t *)addr)[0], ((uint8_t *)addr)[1], ((uint8_t *)addr)[2], ((uint8_t *)addr)[3], ((uint8_t *)addr)[4], ((uint8_t *)addr)[5], ((uint8_t *)addr)[6], ((uint8_t *)addr)[7])
 #if UIP_LOGGING
@@ -66,13 +82,6 @@ void uip_log(char *msg);
 #define UIP_LOG(m)
 #endif /* UIP_LOGGING == 1 */
 
-void __print__(unsigned char c, unsigned char* x, unsigned long long xlen) {
-  unsigned long long i;
-  printf("%c[%d]=", c, (int)xlen);
-  for (i = 0; i < xlen; ++i) printf("%02x", x[i]);
-  printf("\n");
-}
-
 //#if UIP_CONF_IPV6_LOWPAN_ND
 /*------------------------------------------------------------------*/
 /** @{ */
@@ -147,7 +156,6 @@ extract_lladdr_from_llao_aligned(uip_lladdr_t *dest) {
 /*------------------------------------------------------------------*/
 
 #if UIP_ND6_NS_NONCE
-static uint8_t nonce = 0;
 static uint8_t nonce_arr[6]={0};
 #endif
 
@@ -198,6 +206,75 @@ create_nonce(uip_nd6_opt_nonce * nonce, uint8_t  counter[]) {
   	memcpy(&(((uip_nd6_opt_nonce*)nonce)->counter), counter, 6);
 }
 /*------------------------------------------------------------------*/
+#if UIP_ND6_NS_NONCE
+#if UIP_ND6_NONCE_CFS
+#define NONCE_FILE "nd6nonce"
+
+/* Counter values below this bound may have been sent before a reboot */
+static uint8_t nonce_bound[6];
+static uint8_t nonce_loaded;
+
+/* Move the bound UIP_ND6_NONCE_STEP past the counter and save it before
+ * any counter up to it is sent */
+static void
+nonce_store(void)
+{
+	uint16_t sum;
+	int fd;
+	int i;
+
+	sum = UIP_ND6_NONCE_STEP;
+	for(i = 5; i >= 0; i--) {
+		sum += nonce_arr[i];
+		nonce_bound[i] = sum;
+		sum >>= 8;
+	}
+	fd = cfs_open(NONCE_FILE, CFS_WRITE);
+	if(fd < 0 || cfs_write(fd, nonce_bound, sizeof(nonce_bound)) != sizeof(nonce_bound)) {
+		PRINTF("Cannot save the nonce counter, a reboot will restart it\n");
+	}
+	if(fd >= 0) {
+		cfs_close(fd);
+	}
+}
+#endif /* UIP_ND6_NONCE_CFS */
+
+/* The 6LBR keeps the last counter it accepted, so count over all six
+ * bytes rather than wrap after 255 NS. With UIP_ND6_NONCE_CFS, a boot
+ * goes on from the saved bound, above any counter sent before. */
+static void
+nonce_next(void)
+{
+	int i;
+#if UIP_ND6_NONCE_CFS
+	int fd;
+
+	if(!nonce_loaded) {
+		nonce_loaded = 1;
+		fd = cfs_open(NONCE_FILE, CFS_READ);
+		if(fd >= 0) {
+			if(cfs_read(fd, nonce_arr, sizeof(nonce_arr)) != sizeof(nonce_arr)) {
+				memset(nonce_arr, 0, sizeof(nonce_arr));
+			}
+			cfs_close(fd);
+		}
+		nonce_store();
+	}
+#endif /* UIP_ND6_NONCE_CFS */
+
+	for(i = 5; i >= 0; i--) {
+		if(++nonce_arr[i] != 0) {
+			break;
+		}
+	}
+#if UIP_ND6_NONCE_CFS
+	if(memcmp(nonce_arr, nonce_bound, sizeof(nonce_arr)) >= 0) {
+		nonce_store();
+	}
+#endif /* UIP_ND6_NONCE_CFS */
+}
+#endif /* UIP_ND6_NS_NONCE */
+/*------------------------------------------------------------------*/
 static void
 create_auth(uip_nd6_opt_auth * auth, uint8_t  authenticator[]) {
 	auth->type = (uint8_t)UIP_ND6_OPT_AUTH;
@@ -216,6 +293,7 @@ ns_input(void)
   //  uip_lladdr_t eui64;
   uip_802154_longaddr eui64;
 
+  ND6_TRACE(ND6_TRACE_NS_IN, 0, 0, ND6_TRACE_IID(&UIP_IP_BUF->srcipaddr), 8);
   PRINTF("Received NS from ");
   PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
   PRINTF(" to ");
@@ -322,8 +400,6 @@ ns_input(void)
 		  reg = uip_ds6_reg_lookup(UIP_IP_BUF->srcipaddr, NULL);
 
 		  if(reg == NULL) {
-			  uip_ds6_print_reg_list();
-
 			  addr = uip_ds6_addr_lookup(&UIP_ND6_NS_BUF->tgtipaddr);
 
 			  memcpy(&srcipaddr, &UIP_IP_BUF->srcipaddr, sizeof(uip_ip6addr_t));
@@ -339,7 +415,6 @@ ns_input(void)
 
 			  PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
 			  PRINTF(" has been added to the registration list.\n");
-			  uip_ds6_print_reg_list();
 
 			  /* goto create NA */
 //	          goto create_lowpan_na;
@@ -467,6 +542,7 @@ create_lowpan_na:
 	UIP_ICMP_BUF->icmpchksum = ~uip_icmp6chksum();
 
 	UIP_STAT(++uip_stat.nd6.sent);
+	ND6_TRACE(ND6_TRACE_NA_OUT, reg_status, 0, ND6_TRACE_IID(&UIP_IP_BUF->destipaddr), 8);
 	PRINTF("Sending NA to ");
 	PRINT6ADDR(&UIP_IP_BUF->destipaddr);
 	PRINTF(" from ");
@@ -536,7 +612,7 @@ uip_nd6_lowpan_ns_output(uip_ipaddr_t * src, uip_ipaddr_t * dest, uip_ipaddr_t *
     memcpy(&mac64, ds2411_id, sizeof(uip_802154_longaddr));
 
 #if UIP_ND6_NS_NONCE
-	nonce_arr[5] = ++nonce;
+	nonce_next();
 	create_nonce(UIP_ND6_OPT_NONCE_BUF, nonce_arr);
 	uip_len +=  (UIP_ND6_OPT_NONCE_LEN << 3);
 	nd6_opt_offset += (UIP_ND6_OPT_NONCE_LEN << 3);
@@ -571,12 +647,16 @@ uip_nd6_lowpan_ns_output(uip_ipaddr_t * src, uip_ipaddr_t * dest, uip_ipaddr_t *
 	unsigned char h[32];
 	unsigned long long mlen = len;
 	int result = 0;
+#if ND6_TRACE_ENABLED
+	rtimer_clock_t hash_start = RTIMER_NOW();
+#endif /* ND6_TRACE_ENABLED */
 
-	__print__('m', m, mlen);
-	printf(" -> ");
+	ENERGEST_ON(ENERGEST_TYPE_CRYPTO);
 	result |= crypto_hash(h, m, mlen);
-	__print__('h', h, CRYPTO_BYTES);
-	printf("\n");
+	ENERGEST_OFF(ENERGEST_TYPE_CRYPTO);
+#if ND6_TRACE_ENABLED
+	nd6_trace_hash(mlen, (rtimer_clock_t)(RTIMER_NOW() - hash_start), h);
+#endif /* ND6_TRACE_ENABLED */
 
 	memcpy(authenticator, h, sizeof(h));
 	create_auth(UIP_ND6_OPT_AUTH_BUF, authenticator);
@@ -613,6 +693,10 @@ uip_nd6_lowpan_ns_output(uip_ipaddr_t * src, uip_ipaddr_t * dest, uip_ipaddr_t *
 	UIP_ICMP_BUF->icmpchksum = ~uip_icmp6chksum();
 
 	UIP_STAT(++uip_stat.nd6.sent);
+	if(aro) {
+		ND6_STATS_RTT_START(ND6_STATS_NS_NA);
+	}
+	ND6_TRACE(ND6_TRACE_NS_OUT, aro, 0, ND6_TRACE_IID(&UIP_IP_BUF->destipaddr), 8);
 	PRINTF("Sending NS to ");
 	PRINT6ADDR(&UIP_IP_BUF->destipaddr);
 	PRINTF(" from ");
@@ -623,6 +707,18 @@ uip_nd6_lowpan_ns_output(uip_ipaddr_t * src, uip_ipaddr_t * dest, uip_ipaddr_t *
 	return;
 }
 
+/*------------------------------------------------------------------*/
+#if UIP_ND6_SEND_NA && UIP_ND6_PAIRWISE_LLSEC && UIP_ND6_NS_AUTH
+/* The router accepted our authenticated NS, so it holds the same key */
+static void
+activate_pairwise_key(void)
+{
+  static const uint8_t reg_key[] = KEY;
+
+  pairwisesec_set_key(packetbuf_addr(PACKETBUF_ADDR_SENDER), reg_key,
+      PAIRWISESEC_KEY_ACTIVE);
+}
+#endif /* UIP_ND6_SEND_NA && UIP_ND6_PAIRWISE_LLSEC && UIP_ND6_NS_AUTH */
 /*------------------------------------------------------------------*/
 /**
  * Neighbor Advertisement Processing
@@ -773,6 +869,12 @@ na_input(void)
 		 * process logic of ARO option in the NA message *
 		 *************************************************/
 		if(nd6_opt_aro != NULL) {
+			ND6_TRACE(ND6_TRACE_NA_IN, nd6_opt_aro->status, 0,
+					ND6_TRACE_IID(&UIP_IP_BUF->srcipaddr), 8);
+			ND6_STATS_RTT_END(ND6_STATS_NS_NA);
+			if(nd6_opt_aro->status == UIP_ND6_ARO_DUPLICATE_ADDRESS) {
+				UIP_STAT(++uip_stat.nd6.duperr);
+			}
 //			PRINTF("ARO is not empty \n");
 #if UIP_CONF_ROUTER
 			reg = uip_ds6_if.registration_in_progress;
@@ -798,6 +900,9 @@ na_input(void)
 							reg->reg_count = 0;
 							stimer_set(&reg->reg_lifetime, uip_ntohs(nd6_opt_aro->lifetime) * 60);
 							uip_ds6_if.registration_in_progress = NULL;
+#if UIP_ND6_PAIRWISE_LLSEC && UIP_ND6_NS_AUTH
+							activate_pairwise_key();
+#endif /* UIP_ND6_PAIRWISE_LLSEC && UIP_ND6_NS_AUTH */
 						}
 						break;
 
@@ -833,6 +938,9 @@ na_input(void)
 				addr->state = ADDR_PREFERRED;
 				PRINT6ADDR(&addr->ipaddr);
 				PRINTF(" address registered successfully.\n");
+#if UIP_ND6_PAIRWISE_LLSEC && UIP_ND6_NS_AUTH
+				activate_pairwise_key();
+#endif /* UIP_ND6_PAIRWISE_LLSEC && UIP_ND6_NS_AUTH */
 //				if (uip_ds6_is_my_addr(&UIP_ND6_NA_BUF->tgtipaddr)) {
 //				   PRINTF("ARO supported in this message\n");
 //				}
@@ -901,18 +1009,10 @@ na_input(void)
 	} // if(addr != NULL)
 
 #if UIP_CONF_IPV6_QUEUE_PKT
-	/* The nbr is now reachable, check if we had buffered a pkt for it */
-	/*if(nbr->queue_buf_len != 0) {
-		uip_len = nbr->queue_buf_len;
-		memcpy(UIP_IP_BUF, nbr->queue_buf, uip_len);
-		nbr->queue_buf_len = 0;
-		return;
-	}*/
-	if(uip_packetqueue_buflen(&nbr->packethandle) != 0) {
-		uip_len = uip_packetqueue_buflen(&nbr->packethandle);
-		memcpy(UIP_IP_BUF, uip_packetqueue_buf(&nbr->packethandle), uip_len);
-		uip_packetqueue_free(&nbr->packethandle);
-		return;
+	/* The nbr is now reachable, send the pkts we buffered for it, oldest
+	 * first */
+	if(nbr != NULL && uip_packetqueue_count(&nbr->packethandle) != 0) {
+		tcpip_ipv6_output_queued(nbr);
 	}
 #endif /*UIP_CONF_IPV6_QUEUE_PKT */
 
@@ -930,6 +1030,7 @@ static void
 rs_input(void)
 {
 
+  ND6_TRACE(ND6_TRACE_RS_IN, 0, 0, ND6_TRACE_IID(&UIP_IP_BUF->srcipaddr), 8);
   PRINTF("Received RS from ");
   PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
   PRINTF(" to ");
@@ -1141,6 +1242,7 @@ uip_nd6_lowpan_ra_output(uip_ipaddr_t * dest)
   UIP_ICMP_BUF->icmpchksum = ~uip_icmp6chksum();
 
   UIP_STAT(++uip_stat.nd6.sent);
+  ND6_TRACE(ND6_TRACE_RA_OUT, 0, 0, ND6_TRACE_IID(&UIP_IP_BUF->destipaddr), 8);
   PRINTF("Sending RA to ");
   PRINT6ADDR(&UIP_IP_BUF->destipaddr);
   PRINTF(" from ");
@@ -1188,6 +1290,8 @@ uip_nd6_lowpan_rs_output(uip_ipaddr_t* rtr_ipaddr)
   UIP_ICMP_BUF->icmpchksum = ~uip_icmp6chksum();
 
   UIP_STAT(++uip_stat.nd6.sent);
+  ND6_STATS_RTT_START(ND6_STATS_RS_RA);
+  ND6_TRACE(ND6_TRACE_RS_OUT, 0, 0, ND6_TRACE_IID(&UIP_IP_BUF->destipaddr), 8);
   PRINTF("Sending RS to ");
   PRINT6ADDR(&UIP_IP_BUF->destipaddr);
   PRINTF(" from ");
@@ -1210,6 +1314,8 @@ ra_input(void)
 {
   uip_lladdr_t lladdr_aligned;
 
+  ND6_STATS_RTT_END(ND6_STATS_RS_RA);
+  ND6_TRACE(ND6_TRACE_RA_IN, 0, 0, ND6_TRACE_IID(&UIP_IP_BUF->srcipaddr), 8);
   PRINTF("Received RA from ");
   PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
   PRINTF(" to ");
@@ -1465,10 +1571,21 @@ ra_input(void)
       memcpy(&lbrinfo.abro, nd6_opt_abro, sizeof(uip_nd6_opt_abro));
 #endif
 
+#if UIP_CONF_IPV6_QUEUE_PKT
+      /* The router, uip_buf is reused for the NS */
+      nbr = uip_ds6_nbr_lookup(&UIP_IP_BUF->srcipaddr);
+#endif /*UIP_CONF_IPV6_QUEUE_PKT */
       /* The generated address (ipaddr) is as source address of NS message */
 	  uip_nd6_lowpan_ns_output(&ipaddr, &UIP_IP_BUF->srcipaddr,
 			  &UIP_IP_BUF->srcipaddr,1, (uint16_t) uip_ntohs(UIP_ND6_RA_BUF->router_lifetime), lbrinfo);
       tcpip_ipv6_output();
+#if UIP_CONF_IPV6_QUEUE_PKT
+      /* The NS is out, send what was queued for the router meanwhile;
+       * packets from the address being registered wait for the NA */
+      if(nbr != NULL && uip_packetqueue_count(&nbr->packethandle) != 0) {
+        tcpip_ipv6_output_queued(nbr);
+      }
+#endif /*UIP_CONF_IPV6_QUEUE_PKT */
       return;
 
     } else {
@@ -1483,18 +1600,9 @@ ra_input(void)
 
 #if UIP_CONF_IPV6_QUEUE_PKT
   /* If the nbr just became reachable (e.g. it was in NBR_INCOMPLETE state
-   * and we got a SLLAO), check if we had buffered a pkt for it */
-  /*  if((nbr != NULL) && (nbr->queue_buf_len != 0)) {
-    uip_len = nbr->queue_buf_len;
-    memcpy(UIP_IP_BUF, nbr->queue_buf, uip_len);
-    nbr->queue_buf_len = 0;
-    return;
-    }*/
-  if(nbr != NULL && uip_packetqueue_buflen(&nbr->packethandle) != 0) {
-    uip_len = uip_packetqueue_buflen(&nbr->packethandle);
-    memcpy(UIP_IP_BUF, uip_packetqueue_buf(&nbr->packethandle), uip_len);
-    uip_packetqueue_free(&nbr->packethandle);
-    return;
+   * and we got a SLLAO), send the pkts we buffered for it, oldest first */
+  if(nbr != NULL && uip_packetqueue_count(&nbr->packethandle) != 0) {
+    tcpip_ipv6_output_queued(nbr);
   }
 
 #endif /*UIP_CONF_IPV6_QUEUE_PKT */
@@ -1526,6 +1634,7 @@ UIP_ICMP6_HANDLER(ra_input_handler, ICMP6_RA, UIP_ICMP6_HANDLER_CODE_ANY,
 void
 uip_nd6_init()
 {
+  nd6_trace_init();
 
 #if UIP_ND6_SEND_NA
   /* Only handle NSs if we are prepared to send out NAs */
@@ -229,6 +229,27 @@
 #else
 #define UIP_ND6_NS_NONCE               UIP_CONF_ND6_NS_NONCE
 #endif
+
+/* Keep the nonce counter in a CFS file, so that it keeps growing across
+   reboots. The file is rewritten every UIP_ND6_NONCE_STEP NS. */
+#ifndef UIP_CONF_ND6_NONCE_CFS
+#define UIP_ND6_NONCE_CFS				1
+#else
+#define UIP_ND6_NONCE_CFS              UIP_CONF_ND6_NONCE_CFS
+#endif
+
+#ifndef UIP_CONF_ND6_NONCE_STEP
+#define UIP_ND6_NONCE_STEP				64
+#else
+#define UIP_ND6_NONCE_STEP             UIP_CONF_ND6_NONCE_STEP
+#endif
+
+/* Derive pairwise link keys (pairwisesec) from authenticated registrations */
+#ifndef UIP_CONF_ND6_PAIRWISE_LLSEC
+#define UIP_ND6_PAIRWISE_LLSEC			0
+#else
+#define UIP_ND6_PAIRWISE_LLSEC         UIP_CONF_ND6_PAIRWISE_LLSEC
+#endif
 /** @} */
 
 /** \name ND6 option types */
@@ -282,7 +303,6 @@
 #define UIP_ND6_OPT_ABRO_LEN	       3
 //add
 #define UIP_ND6_OPT_NONCE_LEN	       1
-//#define UIP_ND6_OPT_AUTH_LEN	       3
 #define UIP_ND6_OPT_AUTH_LEN	       5
 
 /* Length of TLLAO and SLLAO options, it is L2 dependant */
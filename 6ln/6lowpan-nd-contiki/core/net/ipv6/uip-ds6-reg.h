@@ -87,7 +87,7 @@
 
 /*registration list*/
 #ifdef UIP_DS6_CONF_REGS_PER_ADDR
-#define UIP_DS6_REGS_PER_ADDR UID_DS6_CONF_REGS_PER_ADDR
+#define UIP_DS6_REGS_PER_ADDR UIP_DS6_CONF_REGS_PER_ADDR
 #else
 #define UIP_DS6_REGS_PER_ADDR UIP_DS6_NBR_NB
 //#define UIP_DS6_REGS_PER_ADDR 4
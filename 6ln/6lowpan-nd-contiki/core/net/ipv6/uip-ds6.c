@@ -60,7 +60,11 @@
 #include "dev/ds2411/ds2411.h"
 
 //#define DEBUG DEBUG_NONE
-#define DEBUG DEBUG_PRINT
+#ifdef UIP_ND6_CONF_DEBUG
+#define DEBUG UIP_ND6_CONF_DEBUG
+#else /* UIP_ND6_CONF_DEBUG */
+#define DEBUG DEBUG_NONE
+#endif /* UIP_ND6_CONF_DEBUG */
 #include "net/ip/uip-debug.h"
 
 struct etimer uip_ds6_timer_periodic;                           /**< Timer for maintenance of data structures */
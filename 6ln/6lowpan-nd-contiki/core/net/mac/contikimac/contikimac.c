@@ -820,6 +820,9 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
     PRINTF("no miss %d wake-ups %d\n",
 	   packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[0],
            strobes);
+#if PHASE_STATS
+    phase_stats_strobe(CYCLE_TIME, encounter_time - t0);
+#endif /* PHASE_STATS */
   }
 
   if(!is_broadcast) {
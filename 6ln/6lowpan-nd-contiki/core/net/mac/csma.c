@@ -47,6 +47,7 @@
 #include "lib/random.h"
 
 #include "net/netstack.h"
+#include "net/nbr-table.h"
 
 #include "lib/list.h"
 #include "lib/memb.h"
@@ -98,25 +99,21 @@ struct qbuf_metadata {
   mac_callback_t sent;
   void *cptr;
   uint8_t max_transmissions;
+  uint8_t priority;
 };
 
-/* Every neighbor has its own packet queue */
+/* Every neighbor has its own packet queue and backoff state. The
+   queues are kept in the neighbor table, locked while they hold
+   packets and removed once they are empty. Broadcasts have a static
+   queue of their own, so they never take a neighbor table entry from
+   a real neighbor. */
 struct neighbor_queue {
-  struct neighbor_queue *next;
-  linkaddr_t addr;
   struct ctimer transmit_timer;
   uint8_t transmissions;
   uint8_t collisions;
   LIST_STRUCT(queued_packet_list);
 };
 
-/* The maximum number of co-existing neighbor queues */
-#ifdef CSMA_CONF_MAX_NEIGHBOR_QUEUES
-#define CSMA_MAX_NEIGHBOR_QUEUES CSMA_CONF_MAX_NEIGHBOR_QUEUES
-#else
-#define CSMA_MAX_NEIGHBOR_QUEUES 2
-#endif /* CSMA_CONF_MAX_NEIGHBOR_QUEUES */
-
 /* The maximum number of pending packet per neighbor */
 #ifdef CSMA_CONF_MAX_PACKET_PER_NEIGHBOR
 #define CSMA_MAX_PACKET_PER_NEIGHBOR CSMA_CONF_MAX_PACKET_PER_NEIGHBOR
@@ -125,10 +122,32 @@ struct neighbor_queue {
 #endif /* CSMA_CONF_MAX_PACKET_PER_NEIGHBOR */
 
 #define MAX_QUEUED_PACKETS QUEUEBUF_NUM
-MEMB(neighbor_memb, struct neighbor_queue, CSMA_MAX_NEIGHBOR_QUEUES);
+
+/* The number of queued packets kept free for control traffic
+   (PACKETBUF_ATTR_PRIORITY_CONTROL), such as neighbor discovery */
+#ifdef CSMA_CONF_CONTROL_RESERVED
+#define CSMA_CONTROL_RESERVED CSMA_CONF_CONTROL_RESERVED
+#elif MAX_QUEUED_PACKETS > 2
+#define CSMA_CONTROL_RESERVED 1
+#else
+#define CSMA_CONTROL_RESERVED 0
+#endif /* CSMA_CONF_CONTROL_RESERVED */
+
+NBR_TABLE(struct neighbor_queue, neighbor_queues);
+static struct neighbor_queue broadcast_queue;
+static uint8_t broadcast_queue_used;
 MEMB(packet_memb, struct rdc_buf_list, MAX_QUEUED_PACKETS);
 MEMB(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
-LIST(neighbor_list);
+/* Packets of queues the neighbor table reclaimed */
+LIST(evicted_list);
+static struct ctimer evicted_timer;
+
+#if CSMA_STATS
+struct csma_stats csma_stats;
+#define CSMA_STAT(code) (code)
+#else /* CSMA_STATS */
+#define CSMA_STAT(code)
+#endif /* CSMA_STATS */
 
 static void packet_sent(void *ptr, int status, int num_transmissions);
 static void transmit_packet_list(void *ptr);
@@ -136,14 +155,107 @@ static void transmit_packet_list(void *ptr);
 static struct neighbor_queue *
 neighbor_queue_from_addr(const linkaddr_t *addr)
 {
-  struct neighbor_queue *n = list_head(neighbor_list);
-  while(n != NULL) {
-    if(linkaddr_cmp(&n->addr, addr)) {
-      return n;
-    }
-    n = list_item_next(n);
+  if(linkaddr_cmp(addr, &linkaddr_null)) {
+    return broadcast_queue_used ? &broadcast_queue : NULL;
+  }
+  return nbr_table_get_from_lladdr(neighbor_queues, addr);
+}
+/*---------------------------------------------------------------------------*/
+static struct neighbor_queue *
+neighbor_queue_add(const linkaddr_t *addr)
+{
+  struct neighbor_queue *n;
+
+  if(linkaddr_cmp(addr, &linkaddr_null)) {
+    broadcast_queue_used = 1;
+    return &broadcast_queue;
+  }
+  /* A queue only lives as long as its packets, it must not evict the
+     entries other tables keep for a neighbor */
+  n = nbr_table_add_lladdr_no_evict(neighbor_queues, addr,
+                                    NBR_TABLE_REASON_MAC, NULL);
+  if(n != NULL) {
+    /* Keep the queue while it holds packets */
+    nbr_table_lock(neighbor_queues, n);
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+free_neighbor_queue(struct neighbor_queue *n)
+{
+  ctimer_stop(&n->transmit_timer);
+  if(n == &broadcast_queue) {
+    broadcast_queue_used = 0;
+  } else {
+    nbr_table_remove(neighbor_queues, n);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Reports the packets of reclaimed queues to their senders as failed */
+static void
+report_evicted(void *ptr)
+{
+  struct rdc_buf_list *q;
+  struct qbuf_metadata *metadata;
+  mac_callback_t sent;
+  void *cptr;
+
+  while((q = list_pop(evicted_list)) != NULL) {
+    metadata = (struct qbuf_metadata *)q->ptr;
+    sent = metadata->sent;
+    cptr = metadata->cptr;
+    queuebuf_to_packetbuf(q->buf);
+    queuebuf_free(q->buf);
+    memb_free(&metadata_memb, metadata);
+    memb_free(&packet_memb, q);
+    mac_call_sent_callback(sent, cptr, MAC_TX_ERR, 1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Called by the neighbor table when it reclaims a queue. Queues are
+   locked while they hold packets, so this only happens when the
+   neighbor policy forces it. The senders of the packets are told from
+   a timer, not in the middle of a neighbor table allocation. */
+static void
+neighbor_queue_removed(struct neighbor_queue *n)
+{
+  struct rdc_buf_list *q;
+
+  while((q = list_pop(n->queued_packet_list)) != NULL) {
+    list_add(evicted_list, q);
+    CSMA_STAT(csma_stats.evicted++);
+  }
+  ctimer_stop(&n->transmit_timer);
+  if(list_head(evicted_list) != NULL) {
+    ctimer_set(&evicted_timer, 0, report_evicted, NULL);
   }
-  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+packet_priority(struct rdc_buf_list *q)
+{
+  return ((struct qbuf_metadata *)q->ptr)->priority;
+}
+/*---------------------------------------------------------------------------*/
+/* Queues a control packet behind the head of the queue, which may be
+   under transmission, and behind the other control packets */
+static void
+enqueue_control(struct neighbor_queue *n, struct rdc_buf_list *q)
+{
+  struct rdc_buf_list *prev;
+
+  prev = list_head(n->queued_packet_list);
+  if(prev == NULL) {
+    list_add(n->queued_packet_list, q);
+    return;
+  }
+  while(list_item_next(prev) != NULL &&
+        packet_priority(list_item_next(prev)) ==
+        PACKETBUF_ATTR_PRIORITY_CONTROL) {
+    prev = list_item_next(prev);
+  }
+  list_insert(n->queued_packet_list, prev, q);
 }
 /*---------------------------------------------------------------------------*/
 static clock_time_t
@@ -218,9 +330,7 @@ free_packet(struct neighbor_queue *n, struct rdc_buf_list *p, int status)
       schedule_transmission(n);
     } else {
       /* This was the last packet in the queue, we free the neighbor */
-      ctimer_stop(&n->transmit_timer);
-      list_remove(neighbor_list, n);
-      memb_free(&neighbor_memb, n);
+      free_neighbor_queue(n);
     }
   }
 }
@@ -370,6 +480,7 @@ send_packet(mac_callback_t sent, void *ptr)
   static uint8_t initialized = 0;
   static uint16_t seqno;
   const linkaddr_t *addr = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+  uint8_t priority = packetbuf_attr(PACKETBUF_ATTR_PRIORITY);
 
   if(!initialized) {
     initialized = 1;
@@ -388,22 +499,23 @@ send_packet(mac_callback_t sent, void *ptr)
   n = neighbor_queue_from_addr(addr);
   if(n == NULL) {
     /* Allocate a new neighbor entry */
-    n = memb_alloc(&neighbor_memb);
+    n = neighbor_queue_add(addr);
     if(n != NULL) {
       /* Init neighbor entry */
-      linkaddr_copy(&n->addr, addr);
       n->transmissions = 0;
       n->collisions = CSMA_MIN_BE;
       /* Init packet list for this neighbor */
       LIST_STRUCT_INIT(n, queued_packet_list);
-      /* Add neighbor to the list */
-      list_add(neighbor_list, n);
     }
   }
 
   if(n != NULL) {
-    /* Add packet to the neighbor's queue */
-    if(list_length(n->queued_packet_list) < CSMA_MAX_PACKET_PER_NEIGHBOR) {
+    /* Add packet to the neighbor's queue. Control packets are not bound
+       by the per-neighbor limit, and data packets leave the last
+       CSMA_CONTROL_RESERVED packets of the pool to control traffic. */
+    if(priority == PACKETBUF_ATTR_PRIORITY_CONTROL ||
+       (list_length(n->queued_packet_list) < CSMA_MAX_PACKET_PER_NEIGHBOR &&
+        memb_numfree(&packet_memb) > CSMA_CONTROL_RESERVED)) {
       q = memb_alloc(&packet_memb);
       if(q != NULL) {
         q->ptr = memb_alloc(&metadata_memb);
@@ -421,13 +533,16 @@ send_packet(mac_callback_t sent, void *ptr)
             }
             metadata->sent = sent;
             metadata->cptr = ptr;
+            metadata->priority = priority;
 #if PACKETBUF_WITH_PACKET_TYPE
             if(packetbuf_attr(PACKETBUF_ATTR_PACKET_TYPE) ==
                PACKETBUF_ATTR_PACKET_TYPE_ACK) {
               list_push(n->queued_packet_list, q);
             } else
 #endif
-            {
+            if(priority == PACKETBUF_ATTR_PRIORITY_CONTROL) {
+              enqueue_control(n, q);
+            } else {
               list_add(n->queued_packet_list, q);
             }
 
@@ -445,17 +560,19 @@ send_packet(mac_callback_t sent, void *ptr)
         memb_free(&packet_memb, q);
         PRINTF("csma: could not allocate queuebuf, dropping packet\n");
       }
-      /* The packet allocation failed. Remove and free neighbor entry if empty. */
-      if(list_length(n->queued_packet_list) == 0) {
-        list_remove(neighbor_list, n);
-        memb_free(&neighbor_memb, n);
-      }
+      CSMA_STAT(csma_stats.packet_alloc_failed++);
     } else {
-      PRINTF("csma: Neighbor queue full\n");
+      PRINTF("csma: Neighbor queue or data share of the pool full\n");
+      CSMA_STAT(csma_stats.queue_full++);
+    }
+    /* The packet allocation failed. Remove and free neighbor entry if empty. */
+    if(list_length(n->queued_packet_list) == 0) {
+      free_neighbor_queue(n);
     }
     PRINTF("csma: could not allocate packet, dropping packet\n");
   } else {
     PRINTF("csma: could not allocate neighbor, dropping packet\n");
+    CSMA_STAT(csma_stats.queue_alloc_failed++);
   }
   mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
 }
@@ -492,7 +609,8 @@ init(void)
 {
   memb_init(&packet_memb);
   memb_init(&metadata_memb);
-  memb_init(&neighbor_memb);
+  nbr_table_register(neighbor_queues,
+                     (nbr_table_callback *)neighbor_queue_removed);
 }
 /*---------------------------------------------------------------------------*/
 const struct mac_driver csma_driver = {
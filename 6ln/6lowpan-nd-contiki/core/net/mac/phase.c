@@ -50,6 +50,15 @@
 #define PHASE_DRIFT_CORRECT 0
 #endif
 
+/* Maximum number of phases kept. Once reached, a new phase replaces the
+   one of the neighbor that was addressed least recently, relative to
+   how often it is addressed. */
+#ifdef PHASE_CONF_MAX_ENTRIES
+#define PHASE_MAX_ENTRIES PHASE_CONF_MAX_ENTRIES
+#else
+#define PHASE_MAX_ENTRIES NBR_TABLE_MAX_NEIGHBORS
+#endif
+
 struct phase {
   rtimer_clock_t time;
 #if PHASE_DRIFT_CORRECT
@@ -57,6 +66,8 @@ struct phase {
 #endif
   uint8_t noacks;
   struct timer noacks_timer;
+  uint16_t last_used; /* clock_seconds() of the last transmission */
+  uint8_t uses;       /* transmissions, halved at each replacement */
 };
 
 struct phase_queueitem {
@@ -76,6 +87,14 @@ struct phase_queueitem {
 
 MEMB(queued_packets_memb, struct phase_queueitem, PHASE_QUEUESIZE);
 NBR_TABLE(struct phase, nbr_phase);
+static uint8_t num_phases;
+
+#if PHASE_STATS
+struct phase_stats phase_stats;
+#define PHASE_STAT(code) (code)
+#else /* PHASE_STATS */
+#define PHASE_STAT(code)
+#endif /* PHASE_STATS */
 
 #define DEBUG 0
 #if DEBUG
@@ -87,6 +106,51 @@ NBR_TABLE(struct phase, nbr_phase);
 #define PRINTDEBUG(...)
 #endif
 /*---------------------------------------------------------------------------*/
+/* Called by the neighbor table when it reclaims the neighbor */
+static void
+phase_removed(void *item)
+{
+  num_phases--;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_phase(struct phase *e)
+{
+  nbr_table_remove(nbr_phase, e);
+  num_phases--;
+}
+/*---------------------------------------------------------------------------*/
+/* Drop the phase least worth keeping: the one with the longest time
+   since its last use, divided by its (decaying) number of uses.
+   Phases that currently miss ACKs go first. */
+static void
+evict_phase(void)
+{
+  struct phase *e;
+  struct phase *victim = NULL;
+  uint16_t now = clock_seconds();
+  uint16_t score;
+  uint16_t victim_score = 0;
+
+  for(e = nbr_table_head(nbr_phase); e != NULL; e = nbr_table_next(nbr_phase, e)) {
+    score = (uint16_t)(now - e->last_used);
+    if(e->noacks == 0) {
+      score /= e->uses + 1;
+    }
+    e->uses >>= 1;
+    if(victim == NULL || score >= victim_score) {
+      victim = e;
+      victim_score = score;
+    }
+  }
+  if(victim != NULL) {
+    PRINTF("phase: evict %d, score %u\n",
+           nbr_table_get_lladdr(nbr_phase, victim)->u8[0], victim_score);
+    remove_phase(victim);
+    PHASE_STAT(phase_stats.evicted++);
+  }
+}
+/*---------------------------------------------------------------------------*/
 void
 phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
              int mac_status)
@@ -113,7 +177,8 @@ phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
       }
       if(e->noacks >= MAX_NOACKS || timer_expired(&e->noacks_timer)) {
         PRINTF("drop %d\n", neighbor->u8[0]);
-        nbr_table_remove(nbr_phase, e);
+        remove_phase(e);
+        PHASE_STAT(phase_stats.dropped++);
         return;
       }
     } else if(mac_status == MAC_TX_OK) {
@@ -122,13 +187,19 @@ phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
   } else {
     /* No matching phase was found, so we allocate a new one. */
     if(mac_status == MAC_TX_OK && e == NULL) {
+      if(num_phases >= PHASE_MAX_ENTRIES) {
+        evict_phase();
+      }
       e = nbr_table_add_lladdr(nbr_phase, neighbor, NBR_TABLE_REASON_MAC, NULL);
       if(e) {
+        num_phases++;
         e->time = time;
 #if PHASE_DRIFT_CORRECT
       e->drift = 0;
 #endif
       e->noacks = 0;
+      e->last_used = clock_seconds();
+      e->uses = 1;
       }
     }
   }
@@ -166,6 +237,12 @@ phase_wait(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
   if(e != NULL) {
     rtimer_clock_t wait, now, expected, sync;
     clock_time_t ctimewait;
+
+    PHASE_STAT(phase_stats.hits++);
+    e->last_used = clock_seconds();
+    if(e->uses < 0xff) {
+      e->uses++;
+    }
     
     /* We expect phases to happen every CYCLE_TIME time
        units. The next expected phase is at time e->time +
@@ -240,13 +317,37 @@ phase_wait(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
     }
     return PHASE_SEND_NOW;
   }
+  PHASE_STAT(phase_stats.misses++);
   return PHASE_UNKNOWN;
 }
 /*---------------------------------------------------------------------------*/
 void
+phase_remove(const linkaddr_t *neighbor)
+{
+  struct phase *e = nbr_table_get_from_lladdr(nbr_phase, neighbor);
+  if(e != NULL) {
+    remove_phase(e);
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if PHASE_STATS
+/* Account for a strobe to a neighbor with known phase, which was acked
+   after strobe_time. Without phase, a strobe lasts half a cycle on
+   average. */
+void
+phase_stats_strobe(rtimer_clock_t cycle_time, rtimer_clock_t strobe_time)
+{
+  if(strobe_time < cycle_time / 2) {
+    phase_stats.strobe_time_saved += cycle_time / 2 - strobe_time;
+  }
+}
+#endif /* PHASE_STATS */
+/*---------------------------------------------------------------------------*/
+void
 phase_init(void)
 {
   memb_init(&queued_packets_memb);
-  nbr_table_register(nbr_phase, NULL);
+  nbr_table_register(nbr_phase, phase_removed);
+  num_phases = 0;
 }
 /*---------------------------------------------------------------------------*/
@@ -77,6 +77,14 @@
 #define TSCH_QUEUE_MAX_NEIGHBOR_QUEUES ((NBR_TABLE_CONF_MAX_NEIGHBORS) + 2)
 #endif
 
+/* Number of hash buckets used to look up neighbor queues by link-layer
+ * address (a power of two). 0 searches the list of neighbor queues. */
+#ifdef TSCH_QUEUE_CONF_HASH_SIZE
+#define TSCH_QUEUE_HASH_SIZE TSCH_QUEUE_CONF_HASH_SIZE
+#else
+#define TSCH_QUEUE_HASH_SIZE 0
+#endif
+
 /* TSCH CSMA-CA parameters, see IEEE 802.15.4e-2012 */
 /* Min backoff exponent */
 #ifdef TSCH_CONF_MAC_MIN_BE
@@ -140,6 +148,15 @@ struct tsch_neighbor {
   struct tsch_packet *tx_array[TSCH_QUEUE_NUM_PER_NEIGHBOR];
   /* Circular buffer of pointers to packet. */
   struct ringbufindex tx_ringbuf;
+#if TSCH_QUEUE_HASH_SIZE
+  struct tsch_neighbor *hash_next; /* next neighbor in the same hash bucket */
+#endif
+  /* Next neighbor in the list of neighbors that may send over shared links */
+  struct tsch_neighbor *ready_next;
+  /* Next neighbor in the list of neighbors in backoff state */
+  struct tsch_neighbor *backoff_next;
+  uint8_t in_lists; /* ready/backoff list membership, owned by the slot operation */
+  uint8_t ready_pending; /* queued for insertion into the ready list */
 };
 
 /***** External Variables *****/
@@ -188,6 +205,9 @@ void tsch_queue_backoff_reset(struct tsch_neighbor *n);
 void tsch_queue_backoff_inc(struct tsch_neighbor *n);
 /* Decrement backoff window for all queues directed at dest_addr */
 void tsch_queue_update_all_backoff_windows(const linkaddr_t *dest_addr);
+/* Re-evaluate whether the neighbor may send over shared links,
+ * e.g. after its last Tx link was removed */
+void tsch_queue_update_nbr_ready(struct tsch_neighbor *n);
 /* Initialize TSCH queue module */
 void tsch_queue_init(void);
 
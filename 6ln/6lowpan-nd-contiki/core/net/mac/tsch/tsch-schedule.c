@@ -269,6 +269,10 @@ tsch_schedule_remove_link(struct tsch_slotframe *slotframe, struct tsch_link *l)
           if(!(link_options & LINK_OPTION_SHARED)) {
             n->dedicated_tx_links_count--;
           }
+          if(n->tx_links_count == 0) {
+            /* The neighbor's packets may now go over shared broadcast links */
+            tsch_queue_update_nbr_ready(n);
+          }
         }
       }
 
@@ -65,6 +65,9 @@ const linkaddr_t *NBR_TABLE_FIND_REMOVABLE(nbr_table_reason_t reason, void *data
 typedef struct nbr_table_key {
   struct nbr_table_key *next;
   linkaddr_t lladdr;
+#if NBR_TABLE_HASH_SIZE
+  struct nbr_table_key *hash_next;
+#endif /* NBR_TABLE_HASH_SIZE */
 } nbr_table_key_t;
 
 /* For each neighbor, a map of the tables that use the neighbor.
@@ -83,6 +86,14 @@ static unsigned num_tables;
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+#if NBR_TABLE_HASH_SIZE
+#if NBR_TABLE_HASH_SIZE & (NBR_TABLE_HASH_SIZE - 1)
+#error NBR_TABLE_CONF_HASH_SIZE must be a power of two
+#endif
+/* The keys, chained by the hash of their link-layer address */
+static nbr_table_key_t *hash_buckets[NBR_TABLE_HASH_SIZE];
+#endif /* NBR_TABLE_HASH_SIZE */
+
 /*---------------------------------------------------------------------------*/
 /* Get a key from a neighbor index */
 static nbr_table_key_t *
@@ -119,6 +130,45 @@ item_from_key(nbr_table_t *table, nbr_table_key_t *key)
   return item_from_index(table, index_from_key(key));
 }
 /*---------------------------------------------------------------------------*/
+#if NBR_TABLE_HASH_SIZE
+static nbr_table_key_t **
+hash_bucket(const linkaddr_t *lladdr)
+{
+  uint8_t h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = (h << 1 | h >> 7) ^ lladdr->u8[i];
+  }
+  return &hash_buckets[h & (NBR_TABLE_HASH_SIZE - 1)];
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_add(nbr_table_key_t *key)
+{
+  nbr_table_key_t **bucket = hash_bucket(&key->lladdr);
+  key->hash_next = *bucket;
+  *bucket = key;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_remove(nbr_table_key_t *key)
+{
+  nbr_table_key_t **p;
+
+  for(p = hash_bucket(&key->lladdr); *p != NULL; p = &(*p)->hash_next) {
+    if(*p == key) {
+      *p = key->hash_next;
+      return;
+    }
+  }
+}
+#else /* NBR_TABLE_HASH_SIZE */
+#define hash_add(key)
+#define hash_remove(key)
+#endif /* NBR_TABLE_HASH_SIZE */
+/*---------------------------------------------------------------------------*/
 /* Get the key af an item */
 static nbr_table_key_t *
 key_from_item(nbr_table_t *table, const nbr_table_item_t *item)
@@ -136,6 +186,13 @@ index_from_lladdr(const linkaddr_t *lladdr)
   if(lladdr == NULL) {
     lladdr = &linkaddr_null;
   }
+#if NBR_TABLE_HASH_SIZE
+  for(key = *hash_bucket(lladdr); key != NULL; key = key->hash_next) {
+    if(linkaddr_cmp(lladdr, &key->lladdr)) {
+      return index_from_key(key);
+    }
+  }
+#else /* NBR_TABLE_HASH_SIZE */
   key = list_head(nbr_table_keys);
   while(key != NULL) {
     if(lladdr && linkaddr_cmp(lladdr, &key->lladdr)) {
@@ -143,6 +200,7 @@ index_from_lladdr(const linkaddr_t *lladdr)
     }
     key = list_item_next(key);
   }
+#endif /* NBR_TABLE_HASH_SIZE */
   return -1;
 }
 /*---------------------------------------------------------------------------*/
@@ -195,6 +253,7 @@ remove_key(nbr_table_key_t *least_used_key)
   used_map[index_from_key(least_used_key)] = 0;
   /* Remove neighbor from list */
   list_remove(nbr_table_keys, least_used_key);
+  hash_remove(least_used_key);
 }
 /*---------------------------------------------------------------------------*/
 static nbr_table_key_t *
@@ -359,6 +418,7 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr, nbr_table_rea
 
     /* Set link-layer address */
     linkaddr_copy(&key->lladdr, lladdr);
+    hash_add(key);
   }
 
   /* Get item in the current table */
@@ -374,6 +434,17 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr, nbr_table_rea
   return item;
 }
 /*---------------------------------------------------------------------------*/
+/* Add a neighbor only if its link-layer address already has an entry or
+   a free entry is left */
+nbr_table_item_t *
+nbr_table_add_lladdr_no_evict(nbr_table_t *table, const linkaddr_t *lladdr, nbr_table_reason_t reason, void *data)
+{
+  if(index_from_lladdr(lladdr) == -1 && memb_numfree(&neighbor_addr_mem) == 0) {
+    return NULL;
+  }
+  return nbr_table_add_lladdr(table, lladdr, reason, data);
+}
+/*---------------------------------------------------------------------------*/
 /* Get an item from its link-layer address */
 void *
 nbr_table_get_from_lladdr(nbr_table_t *table, const linkaddr_t *lladdr)
@@ -450,7 +521,9 @@ nbr_table_update_lladdr(const linkaddr_t *old_addr, const linkaddr_t *new_addr,
    * Copy the new lladdr into the key - since we know that there is no
    * conflicting entry.
    */
+  hash_remove(key);
   memcpy(&key->lladdr, new_addr, sizeof(linkaddr_t));
+  hash_add(key);
   return 1;
 }
 /*---------------------------------------------------------------------------*/
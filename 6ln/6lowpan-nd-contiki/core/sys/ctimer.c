@@ -43,6 +43,7 @@
  */
 
 #include "sys/ctimer.h"
+#include <stddef.h>
 #include "contiki.h"
 #include "lib/list.h"
 
@@ -58,6 +59,18 @@ static char initialized;
 #define PRINTF(...)
 #endif
 
+/*---------------------------------------------------------------------------*/
+static void
+add_to_list(struct ctimer *c)
+{
+#if ETIMER_WHEEL
+  /* The list only holds the timers set before the process started */
+  if(initialized) {
+    return;
+  }
+#endif /* ETIMER_WHEEL */
+  list_add(ctimer_list, c);
+}
 /*---------------------------------------------------------------------------*/
 PROCESS(ctimer_process, "Ctimer process");
 PROCESS_THREAD(ctimer_process, ev, data)
@@ -70,6 +83,14 @@ PROCESS_THREAD(ctimer_process, ev, data)
   }
   initialized = 1;
 
+#if ETIMER_WHEEL
+  /* From now on, expired callback timers are handed to ctimer_expire()
+     by the event timer library, so the list is no longer needed. */
+  list_init(ctimer_list);
+  while(1) {
+    PROCESS_YIELD();
+  }
+#else /* ETIMER_WHEEL */
   while(1) {
     PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_TIMER);
     for(c = list_head(ctimer_list); c != NULL; c = c->next) {
@@ -84,9 +105,25 @@ PROCESS_THREAD(ctimer_process, ev, data)
       }
     }
   }
+#endif /* ETIMER_WHEEL */
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
+#if ETIMER_WHEEL
+void
+ctimer_expire(struct etimer *et)
+{
+  struct ctimer *c;
+
+  c = (struct ctimer *)((char *)et - offsetof(struct ctimer, etimer));
+  PROCESS_CONTEXT_BEGIN(c->p);
+  if(c->f != NULL) {
+    c->f(c->ptr);
+  }
+  PROCESS_CONTEXT_END(c->p);
+}
+#endif /* ETIMER_WHEEL */
+/*---------------------------------------------------------------------------*/
 void
 ctimer_init(void)
 {
@@ -118,7 +155,7 @@ ctimer_set_with_process(struct ctimer *c, clock_time_t t,
     c->etimer.timer.interval = t;
   }
 
-  list_add(ctimer_list, c);
+  add_to_list(c);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -130,7 +167,7 @@ ctimer_reset(struct ctimer *c)
     PROCESS_CONTEXT_END(&ctimer_process);
   }
 
-  list_add(ctimer_list, c);
+  add_to_list(c);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -142,7 +179,7 @@ ctimer_restart(struct ctimer *c)
     PROCESS_CONTEXT_END(&ctimer_process);
   }
 
-  list_add(ctimer_list, c);
+  add_to_list(c);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -154,7 +191,13 @@ ctimer_stop(struct ctimer *c)
     c->etimer.next = NULL;
     c->etimer.p = PROCESS_NONE;
   }
+#if ETIMER_WHEEL
+  if(!initialized) {
+    list_remove(ctimer_list, c);
+  }
+#else /* ETIMER_WHEEL */
   list_remove(ctimer_list, c);
+#endif /* ETIMER_WHEEL */
 }
 /*---------------------------------------------------------------------------*/
 int
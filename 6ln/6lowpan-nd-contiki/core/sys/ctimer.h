@@ -161,6 +161,20 @@ int ctimer_expired(struct ctimer *c);
  */
 void ctimer_init(void);
 
+#if ETIMER_WHEEL
+/**
+ * \brief      Run the callback of an expired callback timer.
+ * \param et   A pointer to the event timer of the callback timer
+ *
+ *             With the timing wheel, the event timer library calls
+ *             this function directly when a callback timer expires,
+ *             instead of posting an event to the ctimer process.
+ */
+void ctimer_expire(struct etimer *et);
+
+PROCESS_NAME(ctimer_process);
+#endif /* ETIMER_WHEEL */
+
 #endif /* CTIMER_H_ */
 /** @} */
 /** @} */
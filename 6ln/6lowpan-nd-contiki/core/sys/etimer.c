@@ -49,6 +49,365 @@
 #include "sys/etimer.h"
 #include "sys/process.h"
 
+#if ETIMER_WHEEL
+/*
+ * Hierarchical timing wheel. A pending timer is kept on one of the
+ * slots of WHEEL_LEVELS wheels. Level 0 has one slot per clock tick,
+ * and each slot of level n covers a whole revolution of level n - 1.
+ * A timer is put on the lowest level that reaches its expiration time.
+ * When the wheel time enters a new slot of a level above 0, the timers
+ * of that slot are cascaded down. Timers beyond the top level are kept
+ * on an overflow list.
+ *
+ * Since all timers of a level 0 slot expire on the same tick, the next
+ * expiration time is exact, as needed for tickless operation.
+ */
+#include "sys/ctimer.h"
+
+/* While a timer is linked, link_check holds its pprev mixed with its
+   own address. A timer that was never set may hold anything in p and
+   pprev, e.g. in memb or stack memory, so pprev is only followed when
+   link_check matches it. The odd constant keeps it from matching a
+   cleared timer. */
+#define LINK_CHECK(t) ((uintptr_t)(t)->pprev ^ (uintptr_t)(t) ^ (uintptr_t)0x5a5a5a5bUL)
+
+#ifdef ETIMER_CONF_WHEEL_BITS
+#define WHEEL_BITS ETIMER_CONF_WHEEL_BITS
+#else
+#define WHEEL_BITS 6
+#endif
+#define WHEEL_SLOTS  (1 << WHEEL_BITS)
+#define WHEEL_MASK   (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4
+
+static struct etimer *wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+/* Expired timers that have not been delivered yet */
+static struct etimer *due;
+/* Timers beyond the reach of the top level */
+static struct etimer *overflow;
+/* The last tick for which timers have been expired */
+static clock_time_t wheel_time;
+static unsigned short wheel_count;
+static clock_time_t next_expiration;
+
+PROCESS(etimer_process, "Event timer");
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+shift_time(clock_time_t t, int level)
+{
+  if(level * WHEEL_BITS >= sizeof(clock_time_t) * 8) {
+    return 0;
+  }
+  return t >> (level * WHEEL_BITS);
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_pprev(struct etimer *t, struct etimer **pprev)
+{
+  t->pprev = pprev;
+  t->link_check = LINK_CHECK(t);
+}
+/*---------------------------------------------------------------------------*/
+static void
+clear_link(struct etimer *t)
+{
+  t->next = NULL;
+  t->pprev = NULL;
+  t->link_check = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+link_timer(struct etimer **head, struct etimer *t)
+{
+  t->next = *head;
+  if(t->next != NULL) {
+    set_pprev(t->next, &t->next);
+  }
+  *head = t;
+  set_pprev(t, head);
+  wheel_count++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+unlink_timer(struct etimer *t)
+{
+  *t->pprev = t->next;
+  if(t->next != NULL) {
+    set_pprev(t->next, t->pprev);
+  }
+  clear_link(t);
+  wheel_count--;
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_linked(struct etimer *t)
+{
+  return t->p != PROCESS_NONE && t->pprev != NULL &&
+    t->link_check == LINK_CHECK(t);
+}
+/*---------------------------------------------------------------------------*/
+static void
+place_timer(struct etimer *t)
+{
+  clock_time_t now;
+  clock_time_t delta;
+  clock_time_t expiration;
+  int level;
+
+  if(timer_expired(&t->timer)) {
+    link_timer(&due, t);
+    return;
+  }
+
+  /* Distance from the wheel time, which may lag behind the clock */
+  now = clock_time();
+  delta = (now - wheel_time) + timer_remaining(&t->timer);
+  expiration = wheel_time + delta;
+
+  for(level = 0; level < WHEEL_LEVELS; level++) {
+    if(shift_time(delta, level + 1) == 0) {
+      link_timer(&wheel[level][shift_time(expiration, level) & WHEEL_MASK], t);
+      return;
+    }
+  }
+  link_timer(&overflow, t);
+}
+/*---------------------------------------------------------------------------*/
+static void
+replace_list(struct etimer **head)
+{
+  struct etimer *list;
+  struct etimer *t;
+
+  /* Detach the list first, as timers may be placed back on it */
+  list = *head;
+  *head = NULL;
+  if(list != NULL) {
+    set_pprev(list, &list);
+  }
+  while(list != NULL) {
+    t = list;
+    unlink_timer(t);
+    place_timer(t);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+list_min_delta(struct etimer *t, clock_time_t min)
+{
+  clock_time_t delta;
+
+  for(; t != NULL; t = t->next) {
+    delta = etimer_expiration_time(t) - wheel_time;
+    if(delta < min) {
+      min = delta;
+    }
+  }
+  return min;
+}
+/*---------------------------------------------------------------------------*/
+/* The earliest expiration time of the timers on the wheel and on the
+   overflow list, or wheel_time if there are none */
+static clock_time_t
+wheel_next(void)
+{
+  clock_time_t min;
+  int level;
+  int i;
+  int slot;
+
+  /* All pending timers expire after the wheel time. On each level,
+     the first non-empty slot after the current one holds the earliest
+     timers of that level. */
+  min = (clock_time_t)~0;
+  for(level = 0; level < WHEEL_LEVELS; level++) {
+    slot = shift_time(wheel_time, level) & WHEEL_MASK;
+    for(i = 1; i <= WHEEL_SLOTS; i++) {
+      if(wheel[level][(slot + i) & WHEEL_MASK] != NULL) {
+        min = list_min_delta(wheel[level][(slot + i) & WHEEL_MASK], min);
+        break;
+      }
+    }
+  }
+  min = list_min_delta(overflow, min);
+
+  return min == (clock_time_t)~0 ? wheel_time : wheel_time + min;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_time(void)
+{
+  if(wheel_count == 0) {
+    next_expiration = 0;
+  } else if(due != NULL) {
+    /* Expired timers are waiting to be delivered */
+    next_expiration = wheel_time;
+  } else {
+    next_expiration = wheel_next();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+advance(clock_time_t to)
+{
+  clock_time_t from;
+  int level;
+
+  from = wheel_time;
+  wheel_time = to;
+
+  /* Cascade, from the top, the slots of the levels that have entered a
+     new slot. The slots that were skipped hold no timers, since no
+     timer expires before the new wheel time. */
+  if(overflow != NULL &&
+     shift_time(from, WHEEL_LEVELS - 1) != shift_time(to, WHEEL_LEVELS - 1)) {
+    replace_list(&overflow);
+  }
+  for(level = WHEEL_LEVELS - 1; level > 0; level--) {
+    if(shift_time(from, level) != shift_time(to, level)) {
+      replace_list(&wheel[level][shift_time(to, level) & WHEEL_MASK]);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Deliver the timers that are on the due list now. A callback may set
+   a timer that is due at once, it goes on the due list again and is
+   delivered by the next call. Returns 0 if the event queue was full. */
+static int
+deliver_due(void)
+{
+  struct etimer *list;
+  struct etimer *t;
+
+  list = due;
+  due = NULL;
+  if(list != NULL) {
+    set_pprev(list, &list);
+  }
+  while(list != NULL) {
+    t = list;
+    if(t->p == &ctimer_process) {
+      unlink_timer(t);
+      t->p = PROCESS_NONE;
+      ctimer_expire(t);
+    } else if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
+      /* Reset the process ID of the event timer, to signal that the
+         etimer has expired. This is later checked in the
+         etimer_expired() function. */
+      unlink_timer(t);
+      t->p = PROCESS_NONE;
+    } else {
+      /* Retry the rest on the next poll */
+      while(list != NULL) {
+        t = list;
+        unlink_timer(t);
+        link_timer(&due, t);
+      }
+      etimer_request_poll();
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_wheel(void)
+{
+  clock_time_t now;
+  clock_time_t next;
+  struct etimer **slot;
+
+  /* Each round moves the wheel time forward, so timers that callbacks
+     set again and again cannot keep this loop going */
+  now = clock_time();
+  while(deliver_due()) {
+    next = wheel_next();
+    if(next == wheel_time ||
+       (clock_time_t)(next - wheel_time) > (clock_time_t)(now - wheel_time)) {
+      advance(now);
+      break;
+    }
+    /* Jump straight to the next expiration time and expire its slot */
+    advance(next);
+    slot = &wheel[0][wheel_time & WHEEL_MASK];
+    while(*slot != NULL) {
+      struct etimer *t = *slot;
+      unlink_timer(t);
+      link_timer(&due, t);
+    }
+  }
+  update_time();
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_process(struct etimer **head, struct process *p)
+{
+  struct etimer *t;
+  struct etimer *next;
+
+  for(t = *head; t != NULL; t = next) {
+    next = t->next;
+    if(t->p == p) {
+      unlink_timer(t);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(etimer_process, ev, data)
+{
+  int level;
+  int i;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD();
+
+    if(ev == PROCESS_EVENT_EXITED) {
+      for(level = 0; level < WHEEL_LEVELS; level++) {
+        for(i = 0; i < WHEEL_SLOTS; i++) {
+          remove_process(&wheel[level][i], data);
+        }
+      }
+      remove_process(&due, data);
+      remove_process(&overflow, data);
+      update_time();
+    } else if(ev == PROCESS_EVENT_POLL) {
+      run_wheel();
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_request_poll(void)
+{
+  process_poll(&etimer_process);
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_timer(struct etimer *timer)
+{
+  etimer_request_poll();
+
+  if(is_linked(timer)) {
+    /* Timer already on the wheel, it is placed again below since its
+       expiration time may have changed. */
+    unlink_timer(timer);
+  }
+
+  if(wheel_count == 0) {
+    wheel_time = clock_time();
+  }
+
+  timer->p = PROCESS_CURRENT();
+  place_timer(timer);
+
+  update_time();
+}
+/*---------------------------------------------------------------------------*/
+#else /* ETIMER_WHEEL */
 static struct etimer *timerlist;
 static clock_time_t next_expiration;
 
@@ -172,6 +531,7 @@ add_timer(struct etimer *timer)
 
   update_time();
 }
+#endif /* ETIMER_WHEEL */
 /*---------------------------------------------------------------------------*/
 void
 etimer_set(struct etimer *et, clock_time_t interval)
@@ -206,6 +566,12 @@ void
 etimer_adjust(struct etimer *et, int timediff)
 {
   et->timer.start += timediff;
+#if ETIMER_WHEEL
+  if(is_linked(et)) {
+    unlink_timer(et);
+    place_timer(et);
+  }
+#endif /* ETIMER_WHEEL */
   update_time();
 }
 /*---------------------------------------------------------------------------*/
@@ -230,7 +596,11 @@ etimer_start_time(struct etimer *et)
 int
 etimer_pending(void)
 {
+#if ETIMER_WHEEL
+  return wheel_count != 0;
+#else /* ETIMER_WHEEL */
   return timerlist != NULL;
+#endif /* ETIMER_WHEEL */
 }
 /*---------------------------------------------------------------------------*/
 clock_time_t
@@ -242,6 +612,16 @@ etimer_next_expiration_time(void)
 void
 etimer_stop(struct etimer *et)
 {
+#if ETIMER_WHEEL
+  if(is_linked(et)) {
+    unlink_timer(et);
+    if(etimer_expiration_time(et) == next_expiration) {
+      update_time();
+    }
+  } else {
+    clear_link(et);
+  }
+#else /* ETIMER_WHEEL */
   struct etimer *t;
 
   /* First check if et is the first event timer on the list. */
@@ -262,6 +642,7 @@ etimer_stop(struct etimer *et)
       update_time();
     }
   }
+#endif /* ETIMER_WHEEL */
 
   /* Remove the next pointer from the item to be removed. */
   et->next = NULL;
@@ -65,11 +65,38 @@ struct event_data {
   struct process *p;
 };
 
-static process_num_events_t nevents, fevent;
+/*
+ * One ring of events per priority.
+ */
+struct event_queue {
+  struct event_data *events;
+  process_num_events_t size, nevents, fevent;
+};
+
 static struct event_data events[PROCESS_CONF_NUMEVENTS];
+#if PROCESS_PRIO_LEVELS > 1
+static struct event_data events_high[PROCESS_CONF_NUMEVENTS_HIGH];
+#endif /* PROCESS_PRIO_LEVELS > 1 */
+
+static struct event_queue queues[PROCESS_PRIO_LEVELS] = {
+  { events, PROCESS_CONF_NUMEVENTS },
+#if PROCESS_PRIO_LEVELS > 1
+  { events_high, PROCESS_CONF_NUMEVENTS_HIGH },
+#endif /* PROCESS_PRIO_LEVELS > 1 */
+};
+
+/* Events in all queues */
+static process_num_events_t nevents;
+
+/* The queue of the priority of a process */
+#define queue_of(p) (&queues[(p)->prio < PROCESS_PRIO_LEVELS ?         \
+                             (p)->prio : PROCESS_PRIO_LEVELS - 1])
+
+static struct process_subscriber *subscribers;
 
 #if PROCESS_CONF_STATS
 process_num_events_t process_maxevents;
+struct process_queue_stats process_queue_stats[PROCESS_PRIO_LEVELS];
 #endif
 
 static volatile unsigned char poll_requested;
@@ -79,6 +106,8 @@ static volatile unsigned char poll_requested;
 #define PROCESS_STATE_CALLED      2
 
 static void call_process(struct process *p, process_event_t ev, process_data_t data);
+static void process_unsubscribe_all(struct process *p);
+static int is_subscribed(struct process *p, process_event_t ev);
 
 #define DEBUG 0
 #if DEBUG
@@ -157,6 +186,8 @@ exit_process(struct process *p, struct process *fromprocess)
     }
   }
 
+  process_unsubscribe_all(p);
+
   if(p == process_list) {
     process_list = process_list->next;
   } else {
@@ -207,9 +238,19 @@ process_exit(struct process *p)
 void
 process_init(void)
 {
+  unsigned char i;
+
   lastevent = PROCESS_EVENT_MAX;
 
-  nevents = fevent = 0;
+  nevents = 0;
+  for(i = 0; i < PROCESS_PRIO_LEVELS; i++) {
+    queues[i].nevents = queues[i].fevent = 0;
+#if PROCESS_CONF_STATS
+    process_queue_stats[i].maxevents = 0;
+    process_queue_stats[i].overflows = 0;
+#endif /* PROCESS_CONF_STATS */
+  }
+  subscribers = NULL;
 #if PROCESS_CONF_STATS
   process_maxevents = 0;
 #endif /* PROCESS_CONF_STATS */
@@ -249,33 +290,49 @@ do_event(void)
   process_data_t data;
   struct process *receiver;
   struct process *p;
+  struct event_queue *q;
   
   /*
-   * If there are any events in the queue, take the first one and walk
-   * through the list of processes to see if the event should be
-   * delivered to any of them. If so, we call the event handler
-   * function for the process. We only process one event at a time and
-   * call the poll handlers inbetween.
+   * If there are any events in the queues, take the first one of the
+   * highest priority and walk through the list of processes to see if
+   * the event should be delivered to any of them. If so, we call the
+   * event handler function for the process. We only process one event
+   * at a time and call the poll handlers inbetween.
    */
 
   if(nevents > 0) {
-    
+
     /* There are events that we should deliver. */
-    ev = events[fevent].ev;
+    for(q = &queues[PROCESS_PRIO_LEVELS - 1]; q->nevents == 0; q--);
+
+    ev = q->events[q->fevent].ev;
     
-    data = events[fevent].data;
-    receiver = events[fevent].p;
+    data = q->events[q->fevent].data;
+    receiver = q->events[q->fevent].p;
 
     /* Since we have seen the new event, we move pointer upwards
        and decrease the number of events. */
-    fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
+    q->fevent = (q->fevent + 1) % q->size;
+    --q->nevents;
     --nevents;
 
+    if(receiver != PROCESS_BROADCAST && receiver->spilled > 0 &&
+       q < queue_of(receiver)) {
+      receiver->spilled--;
+    }
+
     /* If this is a broadcast event, we deliver it to all events, in
        order of their priority. */
     if(receiver == PROCESS_BROADCAST) {
       for(p = process_list; p != NULL; p = p->next) {
 
+	/* A process that subscribed to broadcast events only gets
+	   those. */
+	if(PROCESS_CONF_BROADCAST_SUBSCRIBE && p->subscriptions > 0 &&
+	   !is_subscribed(p, ev)) {
+	  continue;
+	}
+
 	/* If we have been requested to poll a process, we do this in
 	   between processing the broadcast event. */
 	if(poll_requested) {
@@ -322,6 +379,7 @@ int
 process_post(struct process *p, process_event_t ev, process_data_t data)
 {
   process_num_events_t snum;
+  struct event_queue *q, *first;
 
   if(PROCESS_CURRENT() == NULL) {
     PRINTF("process_post: NULL process posts event %d to process '%s', nevents %d\n",
@@ -332,7 +390,26 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
 	   p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), nevents);
   }
   
-  if(nevents == PROCESS_CONF_NUMEVENTS) {
+  first = p == PROCESS_BROADCAST ? &queues[PROCESS_PRIO_NORMAL] : queue_of(p);
+
+  /* Once an event of the process went to a queue below, the following
+     ones go there too until it is delivered, to keep them in order */
+  q = first;
+  if(p != PROCESS_BROADCAST && p->spilled > 0) {
+    q = &queues[PROCESS_PRIO_NORMAL];
+  }
+
+  /* Fall back to the queues below when the one of the priority is full */
+  for(; q->nevents == q->size; q--) {
+#if PROCESS_CONF_STATS
+    process_queue_stats[q - queues].overflows++;
+#endif /* PROCESS_CONF_STATS */
+    if(q == queues) {
+      break;
+    }
+  }
+
+  if(q->nevents == q->size) {
 #if DEBUG
     if(p == PROCESS_BROADCAST) {
       printf("soft panic: event queue is full when broadcast event %d was posted from %s\n", ev, PROCESS_NAME_STRING(process_current));
@@ -343,13 +420,21 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
     return PROCESS_ERR_FULL;
   }
   
-  snum = (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
-  events[snum].ev = ev;
-  events[snum].data = data;
-  events[snum].p = p;
+  snum = (process_num_events_t)(q->fevent + q->nevents) % q->size;
+  q->events[snum].ev = ev;
+  q->events[snum].data = data;
+  q->events[snum].p = p;
+  ++q->nevents;
   ++nevents;
 
+  if(q < first) {
+    p->spilled++;
+  }
+
 #if PROCESS_CONF_STATS
+  if(q->nevents > process_queue_stats[q - queues].maxevents) {
+    process_queue_stats[q - queues].maxevents = q->nevents;
+  }
   if(nevents > process_maxevents) {
     process_maxevents = nevents;
   }
@@ -368,6 +453,70 @@ process_post_synch(struct process *p, process_event_t ev, process_data_t data)
 }
 /*---------------------------------------------------------------------------*/
 void
+process_set_prio(struct process *p, unsigned char prio)
+{
+  p->prio = prio;
+  p->spilled = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+process_subscribe(struct process_subscriber *s, struct process *p,
+                  process_event_t ev)
+{
+  struct process_subscriber **last;
+
+  process_unsubscribe(s);
+  s->p = p;
+  s->ev = ev;
+  s->next = NULL;
+  for(last = &subscribers; *last != NULL; last = &(*last)->next);
+  *last = s;
+  p->subscriptions++;
+}
+/*---------------------------------------------------------------------------*/
+void
+process_unsubscribe(struct process_subscriber *s)
+{
+  struct process_subscriber **prev;
+
+  for(prev = &subscribers; *prev != NULL; prev = &(*prev)->next) {
+    if(*prev == s) {
+      *prev = s->next;
+      s->p->subscriptions--;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+process_unsubscribe_all(struct process *p)
+{
+  struct process_subscriber **prev;
+
+  for(prev = &subscribers; *prev != NULL;) {
+    if((*prev)->p == p) {
+      *prev = (*prev)->next;
+    } else {
+      prev = &(*prev)->next;
+    }
+  }
+  p->subscriptions = 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_subscribed(struct process *p, process_event_t ev)
+{
+  struct process_subscriber *s;
+
+  for(s = subscribers; s != NULL; s = s->next) {
+    if(s->p == p && s->ev == ev) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
 process_poll(struct process *p)
 {
   if(p != NULL) {
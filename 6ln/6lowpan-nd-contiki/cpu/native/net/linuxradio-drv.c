@@ -33,6 +33,11 @@
  *
  */
 
+#ifdef linux
+/* recvmmsg() */
+#define _GNU_SOURCE
+#endif
+
 #include "contiki.h"
 #include "contiki-conf.h"
 
@@ -55,6 +60,7 @@
 #include <netpacket/packet.h>
 #include <net/if.h>
 #include <linux/sockios.h>
+#include <errno.h>
 
 #define DEBUG 0
 #if DEBUG
@@ -64,19 +70,48 @@
 #define PRINTF(...)
 #endif
 
+/* Number of frames read from the socket with one recvmmsg() call */
+#ifdef LINUXRADIO_CONF_RX_BATCH
+#define RX_BATCH LINUXRADIO_CONF_RX_BATCH
+#else
+#define RX_BATCH 8
+#endif
+
 static int sockfd = -1;
-static char *sockbuf;
-static int buflen;
 
 #define MAX_PACKET_SIZE 256
 
+/* Ingress ring: frames received in one batch, handed to the RDC one
+   by one */
+struct frame {
+  unsigned char data[MAX_PACKET_SIZE];
+};
+static struct frame *rx_frames;
+static struct mmsghdr rx_msgs[RX_BATCH];
+static struct iovec rx_iovecs[RX_BATCH];
+
+/* Outgoing frame. It is written when it is transmitted, so that the
+   MAC learns whether the kernel took it. */
+static struct frame *tx_frame;
+static int buflen;
+
 static int
 init(void)
 {
-  sockbuf = malloc(MAX_PACKET_SIZE);
-  if(sockbuf == 0) {
+  int i;
+
+  rx_frames = malloc(RX_BATCH * sizeof(struct frame));
+  tx_frame = malloc(sizeof(struct frame));
+  if(rx_frames == NULL || tx_frame == NULL) {
     return 1;
   }
+  memset(rx_msgs, 0, sizeof(rx_msgs));
+  for(i = 0; i < RX_BATCH; i++) {
+    rx_iovecs[i].iov_base = rx_frames[i].data;
+    rx_iovecs[i].iov_len = MAX_PACKET_SIZE;
+    rx_msgs[i].msg_hdr.msg_iov = &rx_iovecs[i];
+    rx_msgs[i].msg_hdr.msg_iovlen = 1;
+  }
   return 0;
 }
 static int
@@ -85,7 +120,7 @@ prepare(const void *payload, unsigned short payload_len)
   if(payload_len > MAX_PACKET_SIZE) {
     return 0;
   }
-  memcpy(sockbuf, payload, payload_len);
+  memcpy(tx_frame->data, payload, payload_len);
   buflen = payload_len;
 
   return 0;
@@ -93,10 +128,22 @@ prepare(const void *payload, unsigned short payload_len)
 static int
 transmit(unsigned short transmit_len)
 {
-  int sent = 0;
-  sent = send(sockfd, sockbuf, buflen, 0);
+  int sent;
+
+  if(sockfd < 0 || buflen == 0) {
+    return RADIO_TX_ERR;
+  }
+  do {
+    sent = send(sockfd, tx_frame->data, buflen, MSG_DONTWAIT);
+  } while(sent < 0 && errno == EINTR);
   if(sent < 0) {
+    if(errno == EAGAIN || errno == EWOULDBLOCK) {
+      /* Socket buffer full: the medium is busy, the MAC backs off and
+         transmits the frame again */
+      return RADIO_TX_COLLISION;
+    }
     perror("linuxradio send()");
+    buflen = 0;
     return RADIO_TX_ERR;
   }
   buflen = 0;
@@ -145,11 +192,26 @@ static void
 handle_fd(fd_set *rset, fd_set *wset)
 {
   if(FD_ISSET(sockfd, rset)) {
-    int bytes = read(sockfd, sockbuf, MAX_PACKET_SIZE);
-    buflen = bytes;
-    memcpy(packetbuf_dataptr(), sockbuf, bytes);
-    packetbuf_set_datalen(bytes);
-    NETSTACK_RDC.input();
+    int i;
+    int frames = recvmmsg(sockfd, rx_msgs, RX_BATCH, MSG_DONTWAIT, NULL);
+    if(frames < 0) {
+      if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        perror("linuxradio recvmmsg()");
+      }
+      return;
+    }
+    PRINTF("linuxradio: %d frames\n", frames);
+    /* Frames left in the socket are picked up in the next round */
+    for(i = 0; i < frames; i++) {
+      int bytes = rx_msgs[i].msg_len;
+      if(bytes > PACKETBUF_SIZE) {
+        continue;
+      }
+      packetbuf_clear();
+      memcpy(packetbuf_dataptr(), rx_frames[i].data, bytes);
+      packetbuf_set_datalen(bytes);
+      NETSTACK_RDC.input();
+    }
   }
 }
 
@@ -189,6 +251,9 @@ on(void)
 static int
 off(void)
 {
+  if(sockfd >= 0) {
+    select_set_callback(sockfd, NULL);
+  }
   close(sockfd);
   sockfd = -1;
   return 1;
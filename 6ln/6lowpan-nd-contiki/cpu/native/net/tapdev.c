@@ -171,6 +171,7 @@ tapdev_poll(void)
 
   if(ret == -1) {
     perror("tapdev_poll: read");
+    return 0;
   }
   return ret;
 }
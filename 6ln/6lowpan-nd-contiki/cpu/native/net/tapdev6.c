@@ -49,6 +49,7 @@
 #include <sys/time.h>
 #include <sys/uio.h>
 #include <sys/socket.h>
+#include <errno.h>
 
 
 #ifdef linux
@@ -111,29 +112,22 @@ tapdev_fd(void)
 uint16_t
 tapdev_poll(void)
 {
-  fd_set fdset;
-  struct timeval tv;
   int ret;
-  
-  tv.tv_sec = 0;
-  tv.tv_usec = 0;
-  
-  FD_ZERO(&fdset);
-  if(fd > 0) {
-    FD_SET(fd, &fdset);
-  }
 
-  ret = select(fd + 1, &fdset, NULL, NULL, &tv);
-
-  if(ret == 0) {
+  if(fd <= 0) {
     return 0;
   }
+
+  /* The device is non-blocking: no need to select() before each frame */
   ret = read(fd, uip_buf, UIP_BUFSIZE);
 
   PRINTF("tapdev6: read %d bytes (max %d)\n", ret, UIP_BUFSIZE);
-  
+
   if(ret == -1) {
-    perror("tapdev_poll: read");
+    if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+      perror("tapdev_poll: read");
+    }
+    return 0;
   }
   return ret;
 }
@@ -314,6 +308,10 @@ tapdev_init(void)
   }
 #endif /* Linux */
 
+  if(fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == -1) {
+    perror("tapdev: tapdev_init: fcntl");
+  }
+
 #ifdef __APPLE__
   tapdev_init_darwin_routes();
 #endif
@@ -60,6 +60,10 @@ interrupt(int sig)
 {
   signal(sig, interrupt);
   rtimer_run_next();
+#if NATIVE_CONF_EPOLL
+  /* The main loop may be about to sleep in epoll_wait() */
+  select_wakeup();
+#endif /* NATIVE_CONF_EPOLL */
 }
 /*---------------------------------------------------------------------------*/
 void
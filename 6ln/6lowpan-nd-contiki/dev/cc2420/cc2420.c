@@ -571,14 +571,26 @@ init_security(void)
   setreg(CC2420_SECCTRL1, 0);
 }
 /*---------------------------------------------------------------------------*/
+/* The key in KEY0. Link-layer security sets the key for every frame,
+   this saves the SPI transfer when it did not change. */
+static uint8_t current_key[16];
+static uint8_t current_key_valid;
+
 static void
 set_key(const uint8_t *key)
 {
+  if(current_key_valid && memcmp(current_key, key, 16) == 0) {
+    return;
+  }
+
   GET_LOCK();
   
   write_ram(key, CC2420RAM_KEY0, 16, WRITE_RAM_REVERSE);
   
   RELEASE_LOCK();
+
+  memcpy(current_key, key, 16);
+  current_key_valid = 1;
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -626,7 +638,8 @@ cc2420_init(void)
     splx(s);
   }
 
-  /* Turn on voltage regulator and reset. */
+  /* Turn on voltage regulator and reset, which clears KEY0 */
+  current_key_valid = 0;
   SET_VREG_ACTIVE();
   clock_delay(250);
   SET_RESET_ACTIVE();
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2016, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+
+/**
+ * \file
+ *         Journals a table of registrations and replays it at boot
+ *
+ *         Each boot replays the journal into the table, prints how long
+ *         that took and a checksum of the table, then applies ROUNDS
+ *         random registrations and removals, each journaled as one
+ *         record, and prints the checksum again. The next boot must
+ *         replay the same checksum.
+ *
+ *         Before closing, it also aborts one checkpoint by failing the
+ *         snapshot halfway and journals a few more changes in the old
+ *         segment, which the next boot must replay as well.
+ */
+
+#include "contiki.h"
+#include "journal.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef JOURNAL_EXAMPLE_CONF_ROUNDS
+#define ROUNDS JOURNAL_EXAMPLE_CONF_ROUNDS
+#else
+#define ROUNDS 1000
+#endif
+
+#define ENTRIES 16
+
+/* Changes journaled after the aborted checkpoint */
+#define AFTER_FAILED_CHECKPOINT 8
+
+/* Record types */
+#define REC_BOOT     1 /* uint32_t boot count */
+#define REC_SET      2 /* struct entry */
+#define REC_REMOVE   3 /* uint8_t index */
+
+struct entry {
+  uint8_t index;
+  uint8_t used;
+  uint16_t lifetime;
+  uint8_t eui64[8];
+};
+
+static struct entry table[ENTRIES];
+static uint32_t boots;
+static unsigned long replayed;
+static uint8_t fail_snapshot;
+static struct journal journal;
+/*---------------------------------------------------------------------------*/
+static void
+replay(uint8_t type, uint32_t seqno, const void *data, uint8_t len,
+       void *ptr)
+{
+  const struct entry *e;
+
+  replayed++;
+  if(type == REC_BOOT && len == sizeof(boots)) {
+    memcpy(&boots, data, sizeof(boots));
+  } else if(type == REC_SET && len == sizeof(struct entry)) {
+    e = data;
+    if(e->index < ENTRIES) {
+      table[e->index] = *e;
+    }
+  } else if(type == REC_REMOVE && len == 1) {
+    if(*(const uint8_t *)data < ENTRIES) {
+      table[*(const uint8_t *)data].used = 0;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+snapshot(struct journal *j, void *ptr)
+{
+  int i;
+
+  if(journal_append(j, REC_BOOT, &boots, sizeof(boots)) < 0 ||
+     fail_snapshot) {
+    return -1;
+  }
+  for(i = 0; i < ENTRIES; i++) {
+    if(table[i].used &&
+       journal_append(j, REC_SET, &table[i], sizeof(table[i])) < 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+checksum(void)
+{
+  unsigned sum;
+  int i;
+
+  sum = boots;
+  for(i = 0; i < ENTRIES; i++) {
+    if(table[i].used) {
+      sum = sum * 31 + table[i].index;
+      sum = sum * 31 + table[i].lifetime;
+      sum = sum * 31 + table[i].eui64[7];
+    }
+  }
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+static void
+change(void)
+{
+  struct entry *e;
+  uint8_t index;
+
+  index = random_rand() % ENTRIES;
+  e = &table[index];
+  if(e->used && (random_rand() & 3) == 0) {
+    e->used = 0;
+    journal_append(&journal, REC_REMOVE, &index, 1);
+  } else {
+    e->index = index;
+    e->used = 1;
+    e->lifetime = random_rand();
+    e->eui64[7] = index;
+    journal_append(&journal, REC_SET, e, sizeof(*e));
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(journal_example_process, "Journal example");
+AUTOSTART_PROCESSES(&journal_example_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(journal_example_process, ev, data)
+{
+  static unsigned long i;
+  static clock_time_t start;
+
+  PROCESS_BEGIN();
+
+  start = clock_time();
+  if(journal_open(&journal, "reg", replay, snapshot, NULL) < 0) {
+    printf("journal: open failed\n");
+    PROCESS_EXIT();
+  }
+  printf("journal: replayed %lu records in %lu ticks, boot %lu, checksum %u\n",
+         replayed, (unsigned long)(clock_time() - start),
+         (unsigned long)boots, checksum());
+
+  boots++;
+  journal_append(&journal, REC_BOOT, &boots, sizeof(boots));
+
+  start = clock_time();
+  for(i = 0; i < ROUNDS; i++) {
+    change();
+    if((i & 63) == 63) {
+      PROCESS_PAUSE();
+    }
+  }
+
+  /* The snapshot fails after its first record, the journal must go on
+     in the old segment */
+  fail_snapshot = 1;
+  if(journal_checkpoint(&journal) == 0) {
+    printf("journal: checkpoint did not fail\n");
+  }
+  fail_snapshot = 0;
+  for(i = 0; i < AFTER_FAILED_CHECKPOINT; i++) {
+    change();
+  }
+  journal_close(&journal);
+
+  printf("journal: %lu records in %lu ticks, checksum %u\n",
+         (unsigned long)ROUNDS + AFTER_FAILED_CHECKPOINT, (unsigned long)(clock_time() - start),
+         checksum());
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2013, Hasso-Plattner-Institut.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Measures CCM* throughput, and the cost of switching keys with
+ *         and without cached key schedules
+ */
+
+#include "contiki.h"
+#include "lib/aes-128.h"
+#include "lib/ccm-star.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef CCM_STAR_THROUGHPUT_CONF_ROUNDS
+#define ROUNDS CCM_STAR_THROUGHPUT_CONF_ROUNDS
+#else
+#define ROUNDS 20000UL
+#endif
+
+/* A frame of the size of a full 802.15.4 data frame */
+#define HDR_LEN     23
+#define PAYLOAD_LEN 96
+#define MIC_LEN     8
+
+static uint8_t keys[2][AES_128_KEY_LENGTH] = {
+  { 0x00 , 0x01 , 0x02 , 0x03 , 0x04 , 0x05 , 0x06 , 0x07 ,
+    0x08 , 0x09 , 0x0A , 0x0B , 0x0C , 0x0D , 0x0E , 0x0F },
+  { 0xC0 , 0xC1 , 0xC2 , 0xC3 , 0xC4 , 0xC5 , 0xC6 , 0xC7 ,
+    0xC8 , 0xC9 , 0xCA , 0xCB , 0xCC , 0xCD , 0xCE , 0xCF }
+};
+static struct aes_128_context contexts[2];
+static uint8_t frame[HDR_LEN + PAYLOAD_LEN + MIC_LEN];
+/*---------------------------------------------------------------------------*/
+static void
+report(const char *what, clock_time_t ticks)
+{
+  printf("%-28s %lu ns/frame\n", what,
+         (unsigned long)((unsigned long long)ticks * 1000000000ULL /
+                         CLOCK_SECOND / ROUNDS));
+}
+/*---------------------------------------------------------------------------*/
+/* mode 0: one key, mode 1: set_key per frame, mode 2: context per frame */
+static void
+run(const char *what, int mode)
+{
+  uint8_t nonce[CCM_STAR_NONCE_LENGTH];
+  clock_time_t start;
+  unsigned long i;
+
+  memset(nonce, 0, sizeof(nonce));
+  CCM_STAR.set_key(keys[0]);
+
+  start = clock_time();
+  for(i = 0; i < ROUNDS; i++) {
+    if(mode == 1) {
+      CCM_STAR.set_key(keys[i & 1]);
+    } else if(mode == 2) {
+      ccm_star_set_context(&contexts[i & 1]);
+    }
+    nonce[12] = i;
+    CCM_STAR.aead(nonce,
+        frame + HDR_LEN, PAYLOAD_LEN,
+        frame, HDR_LEN,
+        frame + HDR_LEN + PAYLOAD_LEN, MIC_LEN,
+        1);
+  }
+  report(what, clock_time() - start);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS(ccm_star_throughput_process, "CCM* throughput process");
+AUTOSTART_PROCESSES(&ccm_star_throughput_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ccm_star_throughput_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("CCM* throughput, %u byte payload, T-tables %s\n",
+         PAYLOAD_LEN, AES_128_TTABLE ? "on" : "off");
+
+  aes_128_init_context(&contexts[0], keys[0]);
+  aes_128_init_context(&contexts[1], keys[1]);
+
+  run("single key", 0);
+  PROCESS_PAUSE();
+  run("set_key() per frame", 1);
+  PROCESS_PAUSE();
+  run("cached context per frame", 2);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -39,6 +39,16 @@
 
 #include "contiki.h"
 #include "powertrace.h"
+#include "net/ipv6/nd6-stats.h"
+#if WITH_SHELL
+#include "serial-shell.h"
+#include "shell.h"
+#endif /* WITH_SHELL */
+#if WITH_TSCH
+#include "net/netstack.h"
+#include "net/mac/tsch/tsch.h"
+#include "orchestra.h"
+#endif /* WITH_TSCH */
 #include <stdio.h> /* For printf() */
 
 /*---------------------------------------------------------------------------*/
@@ -50,10 +60,23 @@ PROCESS_THREAD(ln1, ev, data)
   PROCESS_BEGIN();
 
   printf("I'm the 6LN1.\n");
+
+#if WITH_TSCH
+  orchestra_init();
+  NETSTACK_MAC.on();
+#endif /* WITH_TSCH */
   
   /* Start powertracing*/
   powertrace_start(CLOCK_SECOND * 2);
 
+  /* Report the ND registration statistics */
+  nd6_stats_start(CLOCK_SECOND * 60);
+
+#if WITH_SHELL
+  serial_shell_init();
+  shell_nd6_init();
+#endif /* WITH_SHELL */
+
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/